@@ -1,12 +1,12 @@
 /**
  * @file latinsquare.c
  * @brief Latin Square Game Implementation
- *
+ * 
  * This program implements a Latin square game where players can fill in a grid 
  * while adhering to the rules of the Latin square. Each number must appear exactly 
  * once in each row and column. The program allows users to input values, clear 
  * cells, save their progress, and check for winning conditions.
- *
+ * 
  * @details
  * The program provides the following functionalities:
  * - Reads a Latin square from a specified input file.
@@ -14,405 +14,10683 @@
  * - Accepts user commands for inserting and clearing values.
  * - Validates user input to ensure compliance with Latin square rules.
  * - Saves the current state of the game to an output file.
- *
+ * 
  * @author Constantinos Koumas
  * @date 26/09/24
  * @version 1.0
  * @bug No known bugs.
- *
+ * 
  * @par Example usage:
  * - Compile the program using a C compiler.
  * - Run the executable with the input file name as a command-line argument.
 
  */
-#define N 9
+#define _POSIX_C_SOURCE 200809L
+#define _DEFAULT_SOURCE  // SO_REUSEPORT for --serve
+#define MAX_ORDER 64
 
 #include <stdio.h>
+#include <stdarg.h>
 #include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
 
-int readLatinSquare(const char *filename, int latinSquare[N][N]);
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define VALIDATE_HAVE_X86 1
+#else
+#define VALIDATE_HAVE_X86 0
+#endif
 
-void displayLatinSquare(int arr[N][N], int size);
+// sanitizers bring their own allocator, which must not be wrapped
+#if defined(__SANITIZE_ADDRESS__) || defined(__SANITIZE_THREAD__)
+#define BENCH_SANITIZED 1
+#elif defined(__has_feature)
+#if __has_feature(address_sanitizer) || __has_feature(thread_sanitizer) || __has_feature(memory_sanitizer)
+#define BENCH_SANITIZED 1
+#endif
+#endif
 
-void displayInstructionDialogue();
+// --bench counts heap allocations only when built with -DLATINSQUARE_COUNT_ALLOCS, which wraps
+// glibc's allocator for the whole process; other builds keep the system allocator untouched
+#if defined(LATINSQUARE_COUNT_ALLOCS) && defined(__GLIBC__) && !defined(BENCH_SANITIZED)
+#define BENCH_COUNT_ALLOCS 1
+#else
+#define BENCH_COUNT_ALLOCS 0
+#endif
+
+/**
+ * @brief Session counters reported by --stats.
+ *
+ * They cost a clock read per timed section, so they are compiled out
+ * unless the game is built with -DLATINSQUARE_STATS; the STAT_* macros
+ * then expand to nothing. The --serve loops and the autosave writer
+ * update them from their own threads, so they are relaxed atomics.
+ */
+typedef enum
+{
+    STAT_MOVES,             // commands applied by play() or --script
+    STAT_REJECT_FORMAT,
+    STAT_REJECT_RANGE,
+    STAT_REJECT_OCCUPIED,
+    STAT_REJECT_GIVEN,      // attempts to clear a given cell
+    STAT_REJECT_RULE,
+    STAT_COUNTER_COUNT
+} StatCounter;
+
+typedef enum
+{
+    STAT_TIME_PARSE,        // reading and parsing commands
+    STAT_TIME_VALIDATE,     // rule checks and board updates
+    STAT_TIME_RENDER,       // drawing the board and messages
+    STAT_TIME_READ,         // loading the puzzle
+    STAT_TIME_WRITE,        // saving the game
+    STAT_TIMER_COUNT
+} StatTimer;
 
-void play(int arr[N][N], int size, int isDispNeeded, char *outFileName);
+#ifdef LATINSQUARE_STATS
+typedef struct
+{
+    _Atomic unsigned long long count[STAT_COUNTER_COUNT];
+    _Atomic unsigned long long ns[STAT_TIMER_COUNT];
+    _Atomic unsigned long long calls[STAT_TIMER_COUNT];
+} SessionStats;
+
+static SessionStats sessionStats;
+
+/** @brief Returns a monotonic timestamp in nanoseconds. */
+static inline unsigned long long statNowNs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000000ull + (unsigned long long)ts.tv_nsec;
+}
 
-void writeLatinSquare (int arr[N][N],int size, char *fileNameOut);
+#define STAT_COUNT(c) atomic_fetch_add_explicit(&sessionStats.count[(c)], 1, memory_order_relaxed)
+#define STAT_TIMER_START(var) unsigned long long var = statNowNs()
+#define STAT_TIMER_STOP(t, var) \
+    (atomic_fetch_add_explicit(&sessionStats.ns[(t)], statNowNs() - (var), memory_order_relaxed), \
+     atomic_fetch_add_explicit(&sessionStats.calls[(t)], 1, memory_order_relaxed))
+#else
+#define STAT_COUNT(c) ((void)0)
+#define STAT_TIMER_START(var) ((void)0)
+#define STAT_TIMER_STOP(t, var) ((void)0)
+#endif
 
 /**
- * @brief Writes the current state of the Latin square to a file.
- *
- * This function saves the contents of the given Latin square array 
- * to a specified output file. It writes the size of the square followed 
- * by the elements of the square in a formatted manner.
+ * @brief A Latin square of runtime order with its occupancy state.
+ * 
+ * Cells are stored row-major as one byte each (0 = empty) in a single
+ * 64-byte aligned block, together with a bitset marking the given cells
+ * (written as negative values in the file format) and the row/column
+ * occupancy masks. Bit (v-1) of rowMask[i] / colMask[j] is set when value
+ * v is present in row i / column j. filled counts the non-zero cells, so
+ * the win check is a single comparison against size*size.
+ */
+typedef struct
+{
+    int size;
+    int filled;
+    uint8_t *cells;
+    uint64_t *given;
+    uint64_t *rowMask;
+    uint64_t *colMask;
+    void *storage;
+    struct BoardPool *pool;   // pool the storage came from, NULL for the heap
+    const struct BoardKernels *kernels;  // loops specialised for size, chosen by boardInit()
+} LatinBoard;
+
+/** @brief Bytes of each slab a BoardPool carves into board storage. */
+#define BOARD_POOL_SLAB_SIZE (64 * 1024)
+
+/**
+ * @brief Slab allocator for board storage.
  *
- * @param arr The Latin square array to be written to the file.
- * @param size The size of the Latin square.
- * @param fileNameOut The name of the file where the Latin square will be saved.
+ * Storage blocks are cut from 64-byte aligned slabs and, once freed, kept
+ * on a free list per order, so a stream of boards of the same order
+ * reuses the same few blocks instead of going back to the heap. A pool
+ * made the calling thread's pool with boardPoolUseForThread() serves
+ * every boardInit() on that thread. Only a shared pool may be used by
+ * several threads; a private one must only see boards of its own thread.
  */
-void writeLatinSquare (int arr[N][N],int size, char *fileNameOut){
-    FILE *fp = fopen (fileNameOut, "w");
-    
-    if (fp==NULL) {   //CHECK IF NULL
-        printf("Error : Unable to generate file %s to save the game!\n",fileNameOut);
-        return;
-    }
+typedef struct BoardPool
+{
+    void *freeList[MAX_ORDER + 1];  // freed blocks by order, linked through their first bytes
+    uint8_t *slabs;                 // slabs so far, linked through their first bytes
+    uint8_t *bump;                  // unused tail of the newest slab
+    size_t bumpLeft;
+    int shared;                     // take the lock on every call
+    pthread_mutex_t lock;
+    unsigned long long slabCount;   // slabs taken from the heap
+    unsigned long long reused;      // blocks served from a free list
+} BoardPool;
 
-    //write the latin square size at the first line of the file
-    fprintf(fp,"%d\n",size);
+int boardPoolInit(BoardPool *pool, int shared);
 
-    //print the latin square, seperate rows with \n and colunms with space
-    for (int i = 0; i < size; i++) {
-        for (int j = 0; j < size; j++) {
-            
-            if (j == size - 1) {
-                fprintf(fp, "%d", arr[i][j]);
-            } else {
-                fprintf(fp, "%d ", arr[i][j]);
-            }
-        }
-        
-        fprintf(fp, "\n");
-    }
+void boardPoolDestroy(BoardPool *pool);
 
-    fclose(fp);
+void boardPoolUseForThread(BoardPool *pool);
 
-    printf("Saving to %s...\nDone\n",fileNameOut);
+int boardInit(LatinBoard *board, int size);
 
+void boardFree(LatinBoard *board);
 
-}
+int boardCopy(LatinBoard *dst, const LatinBoard *src);
+
+void boardAssign(LatinBoard *dst, const LatinBoard *src);
+
+void boardRebuildMasks(LatinBoard *board);
+
+int boardCheckMasks(const LatinBoard *board);
 
 /**
- * @brief Displays the instructions for user commands.
+ * @brief A board packed for keeping many of them in memory.
  *
- * This function prints a set of instructions to the console, 
- * detailing how the user can input commands to interact with 
- * the Latin square game.
+ * Cells take 4 bits up to order COMPACT_NIBBLE_MAX_ORDER and a byte
+ * above it, row-major, followed by a bitset of the given cells: 53
+ * bytes for a 9x9 board. There are no occupancy masks, so a move is
+ * checked by scanning its row and column. All boards of one order take
+ * compactBoardBytes() bytes and can be stored back to back in one block.
  */
-void displayInstructionDialogue()
+typedef struct
 {
-    printf("Enter your command in the following format:\n");
-    printf("+ i,j=val: for entering val at position (i,j)\n");
-    printf("+ i,j=0 : for clearing cell (i,j)\n");
-    printf("+ 0,0=0 : for saving and ending the game\n");
-    printf("Notice: i,j,val numbering is from [1..4]\n");
-}
+    uint8_t size;
+    uint8_t data[];   // packed cells, then the givens bitset
+} CompactBoard;
+
+/** @brief Largest order whose cells are packed two to a byte. */
+#define COMPACT_NIBBLE_MAX_ORDER 15
 
 /**
- * @brief Handles the gameplay mechanics for the Latin square game.
- *
- * This function manages user input and updates the Latin square 
- * based on the commands received. It validates input, checks for 
- * win conditions, and controls the game flow including saving the game.
+ * @brief Cell accessors of one board representation.
  *
- * @see displayLatinSquare(int (*arr)[9], int size)
- * @see displayInstructionDialogue()
- * @see writeLatinSquare(int (*arr)[9], int size, char *fileNameOut)
- * 
- * @param arr The Latin square array to be modified.
- * @param size The size of the Latin square.
- * @param isDispNeeded A flag indicating whether to display the square 
- *                     and instructions before taking input.
- * @param outFileName The name of the file to save the game state.
+ * The move rules and the text formatters are written once against this
+ * table and inlined for LatinBoard and CompactBoard, so both behave and
+ * print byte for byte the same.
  */
-void play(int arr[N][N], int size, int isDispNeeded, char *outFileName)
+typedef struct
 {
-    if (isDispNeeded == 1)
-    {
-        displayLatinSquare(arr, size);
-        displayInstructionDialogue();
-    }
+    int (*get)(const void *board, int i, int j);
+    int (*isGiven)(const void *board, int i, int j);
+    int (*canPlace)(const void *board, int i, int j, int val);
+    void (*place)(void *board, int i, int j, int val);
+    void (*clear)(void *board, int i, int j);
+} BoardAccess;
 
-    int i, j, val;
-    if (scanf("%d,%d=%d", &i, &j, &val) != 3)
-    {
-        while (getchar() != '\n')
-        {
-        };
-        printf("Error: wrong format of command\n\n");
-        play(arr, size, 0,outFileName);
-        return; // prevent further execution in case of bad input
-    }
+void compactFromBoard(CompactBoard *cb, const LatinBoard *board);
 
-    
-    
-    
-    // Check for game termination command (0,0=0)
-    if ((i == 0) && (j == 0) && (val == 0))
-    {
-        writeLatinSquare(arr,size,outFileName);
-        return;
-    }
+int compactToBoard(LatinBoard *board, const CompactBoard *cb);
 
-    // Check if i, j are within allowed range
-    if (((i < 1) || (i > size)) || ((j < 1) || (j > size)) || ((val < 0) || (val > size)))
-    {
-        printf("Error: i,j or val are outside the allowed range [1..%d]!\n\n", size);
-        play(arr, size, 0,outFileName);
-        return; // avoid continuing after invalid input
-    }
+int readLatinSquare(const char *filename, LatinBoard *board);
 
-    // Check if the cell is occupied
-    if (arr[i - 1][j - 1] != 0)
-    {
-        // Cell is occupied by a positive or negative value
-        if (arr[i - 1][j - 1] < 0)
-        {
-            // Check if trying to clear a negative value
-            if (val == 0)
-            {
-                printf("Error: illegal to clear cell!\n\n");
-                play(arr, size, 0,outFileName);
-                return;
-            }
-        }
-        else
-        {
-            // Cell is occupied by a positive value
-            if (val == 0)
-            {
-                // Clearing the cell
-                arr[i - 1][j - 1] = 0;
-                printf("\nValue Cleared!\n\n");
-                play(arr, size, 1,outFileName);
-                return;
-            }
-            else
-            {
-                // Trying to insert in an occupied cell
-                printf("Error: cell is already occupied!\n\n");
-                play(arr, size, 0,outFileName);
-                return;
-            }
-        }
-    }
+/**
+ * @brief Position of the hand-written parser inside an input buffer.
+ */
+typedef struct
+{
+    const char *pos;
+    const char *end;
+    int line;                // 1-based line of pos
+    const char *lineStart;   // first character of that line
+} ParseCursor;
 
-    // Check Latin square rules for duplicate values in row/column
-    int areRulesBroken = 0;
+/** @brief Files up to this size are read into a stack buffer; larger ones are mapped. */
+#define LOAD_READ_LIMIT 65536
 
-    // Check the row for the same value
-    for (int t = 0; t < size; t++)
-    {
-        if (arr[i - 1][t] == 0)
-        {
-            continue;
-        }
-        if (abs(arr[i - 1][t]) == val)
-        {
-            areRulesBroken = 1;
-            break;
-        }
-    }
+int parseLatinSquare(ParseCursor *cur, LatinBoard *board, char *err, size_t errSize);
 
-    // Check the column for the same value
-    for (int t = 0; t < size; t++)
-    {
-        if (arr[t][j - 1] == 0)
-        {
-            continue;
-        }
-        if (abs(arr[t][j - 1]) == val)
-        {
-            areRulesBroken = 1;
-            break;
-        }
-    }
+int loadLatinSquare(const char *filename, LatinBoard *board, char *err, size_t errSize);
 
-    //print rule violation message
-    if (areRulesBroken == 1)
-    {
-        printf("Error: Illegal value insertion!\n\n");
-        play(arr, size, 0,outFileName);
-        return;
-    }
+void displayLatinSquare(const LatinBoard *board);
 
-    // Insert or clear the value
-    arr[i - 1][j - 1] = val;
-    if (val == 0)
-    {
-        printf("\nValue Cleared!\n\n");
-    }
-    else
-    {
-        printf("\nValue Inserted!\n\n");
-    }
+void displayInstructionDialogue();
 
-    //check whether we have winning conditions
-    int isGameWon = 1;   //flag to determine if the game is won or not 1 => WON  , 0 => NOT WON YET 
-    
-    //if ANT empty cells are found it means the game has yet to be won by the player. 
-    for (int i=0;i<size;i++){
-        if (isGameWon==0) {
-            break;
-        }
-        for (int j=0;j<size;j++){
-            if (arr[i][j]==0){
-                isGameWon = 0 ;
-                break;
-            }
-        }
-    }
+/** @brief The command help shown under the grid. */
+static const char instructionText[] =
+    "Enter your command in the following format:\n"
+    "+ i,j=val: for entering val at position (i,j)\n"
+    "+ i,j=0 : for clearing cell (i,j)\n"
+    "+ 0,0=0 : for saving and ending the game\n"
+    "+ u / r : for undoing / redoing the last change\n"
+    "+ ? : for a hint\n"
+    "Notice: i,j,val numbering is from [1..4]\n";
 
-    // game not won => recursion call to play function and start over waiting for new input.
-    if (isGameWon==0){
-    play(arr, size, 1,outFileName);
-    return;
-    } else if (isGameWon==1) {    // gama is won because isGameWon = 1 !!! Ending the game and calling writeLatinsquare function to save the game
-        printf("Game completed!!!\n");
-        displayLatinSquare(arr,size);   //display winning latin square
-        writeLatinSquare(arr,size,outFileName);
-        return;
-    }
-}
+/** @brief Enough room for the ASCII grid of the largest board. */
+#define GRID_BUFFER_SIZE ((2 * MAX_ORDER + 1) * (MAX_ORDER * 7 + 2) + 16)
+
+size_t formatGrid(const LatinBoard *board, char *out);
+
+size_t formatCompactGrid(const CompactBoard *cb, char *out);
 
 /**
- * @brief Reads a Latin square from a specified file.
- *
- * This function attempts to read a Latin square from the given file 
- * and populates the provided array. It checks for file accessibility 
- * and validates the input format.
+ * @brief Incremental terminal view used by play() on a tty.
  *
- * @param filename The name of the file to read the Latin square from.
- * @param latinSquare The array to populate with the Latin square data.
- * @return The size of the Latin square if successful, or -1 on error.
+ * The grid and instructions are drawn once; after that a move only
+ * rewrites the changed cell and the status line using ANSI cursor
+ * addressing. Each frame is built in one buffer and written with a
+ * single flush.
  */
-int readLatinSquare(const char *filename, int latinSquare[N][N])
+typedef struct
 {
-    FILE *fp = fopen(filename, "r");
-    if (fp == NULL)  //check if null and return error code -1
-    {
-        printf("Error! Unable to access file %s\n", filename);
-        return -1;
-    }
+    int active;       // ANSI mode in use; 0 = plain full reprint (pipes, --plain)
+    int drawn;        // the full grid is on screen
+    int cellWidth;    // characters per grid cell including its left border
+    int statusRow;    // screen row of the message line
+    int promptRow;    // screen row where the next command is typed
+    size_t len;
+    char frame[GRID_BUFFER_SIZE + 1024];
+} TermView;
 
-    int n; // latinsquare user picked size
+void termViewInit(TermView *view, const LatinBoard *board, int enabled);
 
-    //check latin square size legitimacy
-    if (fscanf(fp, "%d", &n) != 1 || n <= 0 || n > N)
-    {
-        printf("Error: Detected invalid size of latin square in the file...\nMaximum size is %d", N);
-        fclose(fp);
-        return -1;
-    }
-    
-    // first set all values of the array to zero
-    for (int i = 0; i < N; i++)
-    {
-        for (int j = 0; j < N; j++)
-        {
-            latinSquare[i][j] = 0;
-        }
-    }
+void termViewDrawAll(TermView *view, const LatinBoard *board);
 
-    // Read,check and transfer latinSquare from file to array latinSquare[][]
+void termViewDrawCell(TermView *view, const LatinBoard *board, int k);
 
-    for (int i = 0; i < n; i++)
-    {
-        for (int j = 0; j < n; j++)
-        {
-            if (fscanf(fp, "%d", &latinSquare[i][j]) != 1)
-            { // Check if fscanf successfully reads an integer
-                printf("Error: Invalid input detected in the Latin square data...\n");
-                fclose(fp);
-                return -1;
-            }
-        }
-    }
+void termViewStatus(TermView *view, const char *msg);
 
-    fclose(fp);
-    return n;
-}
+void termViewFlush(TermView *view);
+
+void playReport(TermView *view, const char *msg);
 
 /**
- * @brief Displays the current state of the Latin square in a formatted manner.
- *
- * This function prints the Latin square to the console, showing 
- * the values in a grid format. Negative numbers are displayed 
- * within parentheses.
+ * @brief Outcome of one i,j=val command, including each rejection reason.
+ */
+typedef enum
+{
+    MOVE_INSERTED,
+    MOVE_CLEARED,
+    MOVE_SAVE,          // the 0,0=0 command
+    MOVE_ERR_FORMAT,    // not of the form i,j=val
+    MOVE_ERR_RANGE,     // i, j or val outside the board
+    MOVE_ERR_OCCUPIED,  // inserting into a cell holding a player value
+    MOVE_ERR_GIVEN,     // clearing a given cell
+    MOVE_ERR_RULE,      // value already in the row or column, or on a given cell
+    MOVE_UNDONE,
+    MOVE_REDONE,
+    MOVE_ERR_NO_UNDO,   // journal has nothing to undo
+    MOVE_ERR_NO_REDO,   // journal has nothing to redo
+    MOVE_HINT,          // a hint was asked for, the board is unchanged
+    MOVE_RESULT_COUNT
+} MoveResult;
+
+/** @brief What play() prints for each MoveResult; the range message takes the size. */
+static const char *const moveMessages[MOVE_RESULT_COUNT] = {
+    "\nValue Inserted!\n\n",
+    "\nValue Cleared!\n\n",
+    "",
+    "Error: wrong format of command\n\n",
+    "Error: i,j or val are outside the allowed range [1..%d]!\n\n",
+    "Error: cell is already occupied!\n\n",
+    "Error: illegal to clear cell!\n\n",
+    "Error: Illegal value insertion!\n\n",
+    "\nMove Undone!\n\n",
+    "\nMove Redone!\n\n",
+    "Error: nothing to undo!\n\n",
+    "Error: nothing to redo!\n\n",
+    "",
+};
+
+MoveResult applyMove(LatinBoard *board, int i, int j, int val);
+
+MoveResult compactApplyMove(CompactBoard *cb, int i, int j, int val);
+
+/** @brief Counts one applied command and, if it was rejected, its reason. */
+#define STAT_MOVE(result) \
+    do \
+    { \
+        STAT_COUNT(STAT_MOVES); \
+        if ((result) == MOVE_ERR_FORMAT) STAT_COUNT(STAT_REJECT_FORMAT); \
+        else if ((result) == MOVE_ERR_RANGE) STAT_COUNT(STAT_REJECT_RANGE); \
+        else if ((result) == MOVE_ERR_OCCUPIED) STAT_COUNT(STAT_REJECT_OCCUPIED); \
+        else if ((result) == MOVE_ERR_GIVEN) STAT_COUNT(STAT_REJECT_GIVEN); \
+        else if ((result) == MOVE_ERR_RULE) STAT_COUNT(STAT_REJECT_RULE); \
+    } while (0)
+
+void statsReport(void);
+
+/**
+ * @brief What parseCommand() found in the input.
+ */
+typedef enum
+{
+    CMD_NEED_MORE = -2,  // the command may continue past the available input
+    CMD_END = -1,        // nothing but whitespace left
+    CMD_BAD = 0,         // malformed, the rest of the line was discarded
+    CMD_MOVE = 1,        // an i,j=val command
+    CMD_UNDO = 2,        // "u" or "undo" on its own line
+    CMD_REDO = 3,        // "r" or "redo" on its own line
+    CMD_HINT = 4         // "?" on its own line
+} CommandStatus;
+
+CommandStatus commandKeyword(const char *text, size_t len);
+
+CommandStatus parseCommand(const char **pos, const char *end, int atEof, int *i, int *j, int *val);
+
+int commandSkipLine(const char **pos, const char *end);
+
+/** @brief Bytes of typed input play() buffers; a longer command is rejected as malformed. */
+#define COMMAND_READER_SIZE 4096
+
+/**
+ * @brief Commands read from a descriptor as they arrive, for play().
  *
- * @param arr The Latin square array to be displayed.
- * @param size The size of the Latin square.
+ * Input is taken with read() and split by parseCommand(), the parser of
+ * --script, --serve and --analyze, so a game reads exactly what those
+ * replay. A command is returned as soon as it is complete; the reader
+ * only blocks when the buffer ends inside one.
  */
-void displayLatinSquare(int arr[N][N], int size)
+typedef struct
 {
-    for (int i = 0; i < size; i++)
-    {
-        // Print the top border of the row
-        for (int j = 0; j < size; j++)
-        {
-            printf("+-----");
-        }
-        printf("+\n");
+    int fd;
+    size_t start;   // parse position in buf
+    size_t have;    // bytes in buf
+    int atEof;
+    int discarding; // dropping an over-long command up to its newline
+    char buf[COMMAND_READER_SIZE];
+} CommandReader;
 
-        // Print the contents of the row
-        for (int j = 0; j < size; j++)
-        {
-            if (arr[i][j] < 0)
-            {
-                // Print negative numbers inside parentheses
-                printf("| (%d) ", abs(arr[i][j]));
-            }
-            else
-            {
-                // Print zeros and positive numbers as they are
-                printf("|  %d  ", arr[i][j]);
-            }
-        }
-        printf("|\n");
-    }
+void commandReaderInit(CommandReader *reader, int fd);
 
-    // Print the bottom border of the last row
-    for (int j = 0; j < size; j++)
-    {
-        printf("+-----");
-    }
-    printf("+\n");
-}
+CommandStatus commandRead(CommandReader *reader, int *i, int *j, int *val);
 
 /**
- * @brief Main function to run the Latin square game.
+ * @brief One journaled change: the cell and its value before and after.
+ */
+typedef struct
+{
+    uint16_t cell;
+    uint8_t oldVal;
+    uint8_t newVal;
+} JournalEntry;
+
+/**
+ * @brief Undo/redo journal kept in a preallocated ring.
  *
- * This function serves as the entry point of the program. It 
- * processes command-line arguments to obtain the input file name, 
- * reads the Latin square from the file, and starts the gameplay 
- * loop.
+ * Entries are addressed logically from the oldest one kept; the first
+ * cursor of them are applied, the rest can be redone. Recording a move
+ * drops the redo tail, and once the ring is full the oldest entry is
+ * overwritten, which bounds the undo depth to the capacity.
+ */
+typedef struct
+{
+    JournalEntry *entries;
+    size_t capacity;
+    size_t head;     // ring slot of the oldest entry
+    size_t count;    // entries kept
+    size_t cursor;   // entries currently applied
+    unsigned long long dropped; // entries dropped from the front, so entry l is number dropped + l
+    unsigned long long changed; // number of the oldest entry written since journalChanges()
+} MoveJournal;
+
+/** @brief Number of moves the journal of one game can undo. */
+#define JOURNAL_CAPACITY 65536
+
+int journalInit(MoveJournal *journal, size_t capacity);
+
+void journalFree(MoveJournal *journal);
+
+void journalClear(MoveJournal *journal);
+
+unsigned long long journalChanges(MoveJournal *journal);
+
+void journalRecord(MoveJournal *journal, int cell, int oldVal, int newVal);
+
+int journalUndo(MoveJournal *journal, LatinBoard *board);
+
+int journalRedo(MoveJournal *journal, LatinBoard *board);
+
+int journalSave(const MoveJournal *journal, const LatinBoard *board, const char *fileName);
+
+int journalLoad(MoveJournal *journal, const LatinBoard *board, const char *fileName);
+
+MoveResult playCommand(LatinBoard *board, MoveJournal *journal, CommandStatus kind, int i, int j, int val, int *cell);
+
+/**
+ * @brief Candidate values of every cell, kept up to date move by move.
  *
- * @see readLatinSquare(const char *filename, int (*latinSquare)[9])
- * @see play(int (*arr)[9], int size, int isDispNeeded, char *outFileName)
- * @param argc The number of command-line arguments.
- * @param argv An array of command-line argument strings.
- * @return Exit status code: 0 on success, non-zero on error.
+ * cand[k] holds the values that may still go in cell k (0 for a filled
+ * cell). A change to one cell only affects the candidates of its row
+ * and column, so candidatesUpdate() costs O(n) per move.
  */
-int main(int argc, char *argv[])
+typedef struct
 {
-    //check if no input file was provided
-    if (argc < 2)
-    {
-        printf("Usage: %s <filename>\nError code: 1 => FileName not provided \n", argv[0]);
-        return 1;
-    }
+    int size;
+    uint64_t *cand;
+} CandidateCache;
 
-    //Initialize latin square array with 0
-    int latinSquare[N][N] = {0};
+/**
+ * @brief Why a hint's value is forced.
+ */
+typedef enum
+{
+    HINT_NAKED_SINGLE,       // the cell has no other candidate
+    HINT_HIDDEN_SINGLE_ROW,  // no other cell of the row can take the value
+    HINT_HIDDEN_SINGLE_COL   // no other cell of the column can take the value
+} HintKind;
 
-    //call function to read latin square date from file 
-    int n = readLatinSquare(argv[1], latinSquare);
+/**
+ * @brief A forced placement found by findHint().
+ */
+typedef struct
+{
+    int cell;
+    int val;
+    HintKind kind;
+} Hint;
 
-    //if -1 is returned, print message saying something went wrong while reading the file
-    if (n == -1)
-    {
-        printf("Error: Something went wrong while reading the file %s\n", argv[1]);
-        return 0;
-    }
+int candidatesInit(CandidateCache *cache, const LatinBoard *board);
 
-     // Generate the output file name dynamically
-    char outFileName[50];
-    snprintf(outFileName, sizeof(outFileName), "out-%s", argv[1]);
+void candidatesFree(CandidateCache *cache);
 
-    // start the gameplay loop
-    play(latinSquare, n, 1,outFileName);
+void candidatesUpdate(CandidateCache *cache, const LatinBoard *board, int cell);
+
+int findHint(const CandidateCache *cache, Hint *hint);
+
+/**
+ * @brief Deduction techniques of the difficulty rater, simplest first.
+ */
+typedef enum
+{
+    TECH_NAKED_SINGLE,   // a cell with one candidate left
+    TECH_HIDDEN_SINGLE,  // a value with one cell left in a row or column
+    TECH_NAKED_PAIR,     // two cells of a line with the same two candidates
+    TECH_HIDDEN_PAIR,    // two values of a line confined to the same two cells
+    TECH_X_WING,         // a value confined to the same two columns of two rows, or rows of two columns
+    TECH_COUNT
+} Technique;
+
+/**
+ * @brief Difficulty levels reported by ratePuzzle().
+ */
+typedef enum
+{
+    RATING_EASY,         // naked singles only
+    RATING_MEDIUM,       // hidden singles needed
+    RATING_HARD,         // naked or hidden pairs needed
+    RATING_EXPERT,       // X-wings needed
+    RATING_SEARCH,       // the techniques get stuck, only a search completes it
+    RATING_INVALID,      // the techniques reach a contradiction: no solution
+    RATING_LEVEL_COUNT
+} RatingLevel;
+
+/** @brief Names of the rating levels, as printed by --batch --rate. */
+static const char *const ratingNames[RATING_LEVEL_COUNT] = {
+    "easy", "medium", "hard", "expert", "search", "invalid"
+};
+
+/**
+ * @brief The difficulty of a puzzle and the techniques that found it.
+ */
+typedef struct
+{
+    RatingLevel level;
+    int left;                       // empty cells the techniques could not fill
+    unsigned score;                 // technique steps weighted by difficulty
+    unsigned uses[TECH_COUNT];      // steps that made progress, per technique
+} PuzzleRating;
+
+void ratePuzzle(const LatinBoard *board, PuzzleRating *rating);
+
+/** @brief Bytes of the command stream --script reads at a time. */
+#define SCRIPT_CHUNK_SIZE (1 << 20)
+
+int runScript(LatinBoard *board, MoveJournal *journal, const char *outFileName);
+
+void writeLatinSquare (const LatinBoard *board, char *fileNameOut);
+
+int saveLatinSquare(const LatinBoard *board, const char *fileNameOut);
+
+/** @brief A game state handed to the autosave writer. */
+typedef struct
+{
+    LatinBoard board;
+    MoveJournal journal;            // same ring layout as the game's; capacity 0 when not journaled
+    unsigned long long stale;       // number of the oldest game journal entry this copy may lack
+} AutosaveSnapshot;
+
+/**
+ * @brief Background writer that keeps out-<name> and its journal current during a game.
+ *
+ * play() hands it a snapshot after every change and goes straight back
+ * to reading input; the writer saves the newest snapshot and drops any
+ * older one it had not reached yet. Two snapshot slots are swapped
+ * under the lock, so neither thread copies while the other writes.
+ * Each slot mirrors the game's journal ring, so a snapshot copies only
+ * the entries written since that slot was last filled (journalChanges()).
+ */
+typedef struct
+{
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t wake;            // a snapshot was queued or the writer must stop
+    pthread_cond_t drained;         // the writer has nothing left to write
+    AutosaveSnapshot slots[2];
+    AutosaveSnapshot *queued;       // filled by play(), taken by the writer
+    AutosaveSnapshot *writing;      // owned by the writer
+    int pending;                    // queued holds a snapshot not written yet
+    int busy;                       // the writer is saving a snapshot
+    int stopping;
+    int failed;                     // some save failed
+    char fileName[4096];
+    char journalName[4096 + 8];
+} Autosave;
+
+int autosaveStart(Autosave *as, const LatinBoard *board, const MoveJournal *journal, const char *outFileName);
+
+void autosaveQueue(Autosave *as, const LatinBoard *board, MoveJournal *journal);
+
+int autosaveFlush(Autosave *as);
+
+int autosaveStop(Autosave *as);
+
+void play(LatinBoard *board, MoveJournal *journal, Autosave *autosave, int isDispNeeded, int incremental, char *outFileName);
+
+/** @brief Enough room for the text form of the largest board: "-64 " per cell plus the size line. */
+#define SAVE_BUFFER_SIZE (MAX_ORDER * MAX_ORDER * 4 + 16)
+
+size_t formatLatinSquare(const LatinBoard *board, char *out);
+
+size_t formatCompactSquare(const CompactBoard *cb, char *out);
+
+int saveCompactBoard(const CompactBoard *cb, const char *fileNameOut);
+
+/**
+ * @brief Counters reported by the solver.
+ */
+typedef struct
+{
+    unsigned long long nodes;  // number of search nodes (cell assignments tried)
+    double elapsedMs;          // wall clock time spent searching
+} SolveStats;
+
+int boardHasConflicts(const LatinBoard *board);
+
+/**
+ * @brief Hot loops of one board order.
+ *
+ * boardInit() picks the table for the board's order: orders 4, 8, 9 and
+ * 16 get copies compiled for that constant order, so their row and
+ * column loops unroll and cell indices divide by a constant; every
+ * other order uses the generic versions.
+ */
+typedef struct BoardKernels
+{
+    int order;                      // 0 for the generic table
+    int (*hasConflicts)(const LatinBoard *board);
+    int (*pickCell)(const LatinBoard *board, uint64_t *cands);
+    int (*solveStep)(LatinBoard *board, SolveStats *stats);
+} BoardKernels;
+
+const BoardKernels *boardKernelsFor(int order);
+
+/**
+ * @brief Outcome of validateLatinSquare().
+ */
+typedef enum
+{
+    SQUARE_VALID,          // every row and column is a permutation of 1..order
+    SQUARE_NOT_LATIN,      // some row or column misses a value
+    SQUARE_GIVEN_CHANGED   // a given of the puzzle was lost or altered
+} SquareVerdict;
+
+/** @brief Row stride, in bytes, of the zero-padded copy the validator kernels scan. */
+#define VALIDATE_STRIDE MAX_ORDER
+
+SquareVerdict validateLatinSquare(const LatinBoard *square, const LatinBoard *puzzle);
+
+/** @brief Boards a MultiBoard interleaves: one byte of each fills an AVX2 register. */
+#define MULTI_BOARD_LANES 32
+
+/** @brief Largest order the interleaved kernel checks; larger rows already fill the single-board kernels. */
+#define MULTI_BOARD_MAX_ORDER 16
+
+/**
+ * @brief Up to MULTI_BOARD_LANES boards of one order, stored cell by cell.
+ *
+ * cells[k * MULTI_BOARD_LANES + b] is cell k of board b, so one vector
+ * load holds the same cell of every board and a single pass over the
+ * cells checks all of them.
+ */
+typedef struct
+{
+    int size;
+    int count;                      // boards added so far
+    uint8_t *cells;                 // size*size*MULTI_BOARD_LANES bytes, 64-byte aligned
+} MultiBoard;
+
+int multiBoardInit(MultiBoard *mb, int size);
+
+void multiBoardFree(MultiBoard *mb);
+
+int multiBoardAdd(MultiBoard *mb, const LatinBoard *board);
+
+uint32_t multiBoardValidate(const MultiBoard *mb);
+
+int solveLatinSquare(LatinBoard *board, SolveStats *stats);
+
+int runSolve(LatinBoard *board, int threads);
+
+double monotonicMs();
+
+/**
+ * @brief Dancing-links matrix for the Latin square exact-cover problem.
+ *
+ * Columns are the constraints "cell (i,j) is filled", "row i holds v"
+ * and "column j holds v"; each matrix row is one candidate placement
+ * and owns exactly three nodes. Only placements still allowed by the
+ * occupancy masks are added, so constraints already met by filled cells
+ * never enter the header list.
+ */
+typedef struct
+{
+    int *left, *right, *up, *down;  // circular links, node 0 is the root
+    int *column;                    // header index of each node
+    int *colSize;                   // nodes currently linked under each header
+    int *rowCell;                   // cell index of each matrix row's placement
+    int *rowVal;                    // value of each matrix row's placement
+    int *nodeRow;                   // matrix row owning each node
+    int *stack;                     // matrix rows of the current partial solution
+    int numCols;
+    int nodeCount;
+    unsigned long long solutions;
+    unsigned long long limit;       // stop after this many solutions, 0 = no limit
+    unsigned long long nodes;       // search nodes visited
+    unsigned long long nodeLimit;   // give up after this many nodes, 0 = no limit
+    LatinBoard *firstSolution;      // receives the first completion found, may be NULL
+    _Atomic unsigned long long *sharedSolutions; // solution count shared between workers, may be NULL
+} DlxMatrix;
+
+int dlxBuild(DlxMatrix *m, const LatinBoard *board);
+
+void dlxFree(DlxMatrix *m);
+
+unsigned long long dlxCountSolutions(DlxMatrix *m, unsigned long long limit, LatinBoard *firstSolution);
+
+int runCountSolutions(LatinBoard *board, unsigned long long limit, int threads);
+
+/** @brief Deepest search-tree level at which the parallel solver splits work. */
+#define SPLIT_MAX_DEPTH 8
+
+/** @brief Subproblems generated per worker thread before searching. */
+#define SPLIT_TASKS_PER_THREAD 32
+
+/**
+ * @brief A subproblem of the parallel search: the root puzzle plus a
+ * prefix of placements chosen by the MRV branching rule.
+ */
+typedef struct
+{
+    int depth;
+    int cell[SPLIT_MAX_DEPTH];
+    uint8_t val[SPLIT_MAX_DEPTH];
+} SearchTask;
+
+unsigned long long parallelCountSolutions(const LatinBoard *board, int threads, unsigned long long limit,
+                                          LatinBoard *firstSolution, unsigned long long *nodes);
+
+/** @brief Refinements the canonical form search may run before it settles for the best form so far. */
+#define CANON_NODE_BUDGET 256
+
+/**
+ * @brief Canonical form of a board under isotopy.
+ *
+ * Two boards that differ only by a permutation of rows, of columns and
+ * of values have the same cells and hash whenever the search finished
+ * (exact); the positions map the board onto the form.
+ */
+typedef struct
+{
+    int size;
+    int exact;                          // 0 when the search budget ran out
+    uint64_t hash;
+    uint8_t rowPos[MAX_ORDER];          // canonical row of each row
+    uint8_t colPos[MAX_ORDER];          // canonical column of each column
+    uint8_t symbol[MAX_ORDER + 1];      // canonical value of each value, symbol[0] = 0
+    uint8_t cells[MAX_ORDER * MAX_ORDER];
+} CanonicalForm;
+
+int canonicalForm(const LatinBoard *board, CanonicalForm *form);
+
+/**
+ * @brief Solve cache file format.
+ *
+ * A 16-byte header (magic "LSQCACH1", uint32 version, uint32 zero), then
+ * one record per canonical puzzle: uint64 hash, uint8 order, uint8 solved,
+ * uint16 reserved, the order*order canonical cells and, when solved, the
+ * order*order cells of its canonical solution. Integers are little-endian;
+ * new records are appended as they are found.
+ */
+#define SOLVE_CACHE_MAGIC "LSQCACH1"
+#define SOLVE_CACHE_VERSION 1
+#define SOLVE_CACHE_HEADER_SIZE 16
+#define SOLVE_CACHE_RECORD_HEADER 12
+
+/** @brief One known result: a canonical puzzle and its canonical solution. */
+typedef struct
+{
+    uint64_t hash;
+    int size;                           // 0 for an empty table entry
+    int solved;
+    uint8_t *cells;                     // size*size puzzle cells, then size*size solution cells when solved
+} SolveCacheEntry;
+
+/**
+ * @brief Persistent results of solved puzzles, keyed by canonical form.
+ *
+ * Entries live in an open addressing table on their hash; the file is
+ * kept open for appending. Not thread-safe.
+ */
+typedef struct
+{
+    SolveCacheEntry *entries;
+    size_t capacity;                    // a power of two
+    size_t count;
+    FILE *file;
+    unsigned long long hits, misses;
+} SolveCache;
+
+int solveCacheOpen(SolveCache *cache, const char *path);
+
+void solveCacheClose(SolveCache *cache);
+
+int solveCacheLookup(SolveCache *cache, const CanonicalForm *form, LatinBoard *board);
+
+int solveCacheStore(SolveCache *cache, const CanonicalForm *form, const LatinBoard *solution);
+
+/**
+ * @brief What --batch does with each puzzle after loading and checking it.
+ */
+typedef enum
+{
+    BATCH_CHECK,   // load and check only
+    BATCH_SOLVE,   // also solve and save the solution as out-<name>
+    BATCH_COUNT,   // also count completions up to the limit
+    BATCH_VALIDATE // check for a complete Latin square that keeps its puzzle's givens
+} BatchAction;
+
+/**
+ * @brief Squares of a --batch --validate run waiting to be checked together.
+ */
+typedef struct
+{
+    MultiBoard multi;               // not allocated until the first square
+    char *names[MULTI_BOARD_LANES];
+    int givensKept[MULTI_BOARD_LANES];  // 0 if the square lost a given of its puzzle
+    double elapsed;                 // time spent on the queued squares so far, in ms
+} ValidateQueue;
+
+/**
+ * @brief Settings and running totals of one --batch run.
+ */
+typedef struct
+{
+    BatchAction action;
+    unsigned long long limit;
+    int threads;
+    int loaded, unreadable, conflicts, solved, valid;
+    SolveCache *cache;              // results of earlier solves, NULL when not used
+    ValidateQueue *queue;           // BATCH_VALIDATE squares not reported yet
+    int rate;                       // rate the difficulty of every puzzle
+    unsigned long long rated[RATING_LEVEL_COUNT];
+    double rateMs;                  // time spent rating
+} BatchRun;
+
+int runBatch(const char *path, BatchAction action, unsigned long long limit, int threads, const char *cachePath,
+             int rate);
+
+int runValidate(const LatinBoard *square, const char *path);
+
+/**
+ * @brief Variable numbering of the CNF encoding of one board.
+ *
+ * Variables 1..placements are the placements still possible: the value
+ * of each filled cell and every candidate of each empty cell, numbered
+ * in row-major cell order, then by value. The auxiliary variables of the
+ * sequential counters follow.
+ */
+typedef struct
+{
+    int size;
+    int *var;                       // size^3 entries, (cell * size + value - 1); 0 when ruled out
+    int placements;
+    int vars;
+    unsigned long long clauses;
+} CnfEncoding;
+
+/** @brief Groups up to this size get pairwise at-most-one clauses instead of a sequential counter. */
+#define CNF_PAIRWISE_MAX 4
+
+int cnfEncode(CnfEncoding *enc, const LatinBoard *board);
+
+void cnfFree(CnfEncoding *enc);
+
+int runExportCnf(const LatinBoard *board, const char *outPath);
+
+int runImportModel(LatinBoard *board, const char *modelPath, char *outFileName);
+
+/** @brief Minimum duration, in ms, of the measured round of each --bench path. */
+#define BENCH_MIN_MS 100.0
+
+/** @brief Largest order --bench times the backtracking solver on; it has no propagation and stalls on 25x25 puzzles. */
+#define BENCH_BACKTRACK_MAX_ORDER 16
+
+int runBench(char **files, int fileCount, int json);
+
+/** @brief Longest partial command a server session buffers. */
+#define SERVER_LINE_MAX 64
+
+/** @brief Events taken from epoll per wakeup. */
+#define SERVER_EVENTS 256
+
+/** @brief Per-loop buffer for composing replies: a message plus the largest grid. */
+#define SERVER_SCRATCH_SIZE (GRID_BUFFER_SIZE + 256)
+
+/**
+ * @brief State shared by every event loop of --serve.
+ */
+typedef struct
+{
+    const LatinBoard *puzzle;       // every session starts from a copy of it
+    const char *puzzleName;
+    const LatinBoard *solution;     // solution of the puzzle, NULL when unknown
+    _Atomic unsigned nextId;        // id of the next session, used in its save file name
+    _Atomic int sessions;           // sessions currently open
+} GameServer;
+
+struct ServerSaveJob;
+
+/**
+ * @brief One connected player. An idle session holds only this and its board.
+ */
+typedef struct
+{
+    int fd;
+    unsigned id;
+    int closing;                    // finished, waiting for its save and its output to drain
+    struct ServerSaveJob *saving;   // save the loop's writer has not finished, NULL when none
+    LatinBoard board;
+    char *out;                      // output the socket did not take yet, NULL when none
+    size_t outLen, outSent;
+    uint16_t inLen;
+    uint8_t discarding;             // dropping an over-long command up to its newline
+    char in[SERVER_LINE_MAX];       // start of a command not complete yet
+} ServerSession;
+
+/**
+ * @brief A finished session's board, formatted by its loop and written by the loop's writer.
+ */
+typedef struct ServerSaveJob
+{
+    struct ServerSaveJob *next;
+    ServerSession *session;         // NULL once the player hung up; only the loop touches it
+    int failed;                     // set by the writer
+    size_t len;
+    char name[4096 + 32];
+    char text[SAVE_BUFFER_SIZE];
+} ServerSaveJob;
+
+/**
+ * @brief One epoll loop and the listening socket it accepts on.
+ *
+ * Saves go to a writer thread of the loop, so one player's fdatasync
+ * never holds up the other sessions; the writer hands finished saves
+ * back through saveFd, an eventfd in the loop's epoll set.
+ */
+typedef struct
+{
+    GameServer *server;
+    pthread_t thread;
+    int epollFd;
+    int listenFd;
+    char *scratch;                  // SERVER_SCRATCH_SIZE bytes
+    pthread_t writer;
+    pthread_mutex_t saveLock;
+    pthread_cond_t saveWake;        // a save was queued
+    ServerSaveJob *saveQueue;       // waiting for the writer, newest first
+    ServerSaveJob *saveDone;        // written, waiting for the loop to reply
+    int saveStop;                   // the writer must stop once the queue is empty
+    int saveFd;
+} ServerLoop;
+
+int runServer(const LatinBoard *puzzle, const char *puzzleName, int port, int threads, const char *cachePath);
+
+/**
+ * @brief Packed corpus format.
+ *
+ * A corpus is a 64-byte header, the puzzle records, then an index with
+ * one 16-byte entry per puzzle. All integers are little-endian.
+ *
+ * Header: magic "LSQPACK1", uint32 version, uint32 puzzle count,
+ * uint64 offset of the index, zero padding.
+ * Index entry: uint64 record offset, uint16 order, uint16 reserved,
+ * uint32 record length.
+ * Record: the order*order cell values, row-major, each in the fewest
+ * bits that hold [0..order] (4 bits up to order 15), LSB first, padded
+ * to a byte; then an order*order bit "given" mask, padded to a byte.
+ */
+#define PACK_MAGIC "LSQPACK1"
+#define PACK_VERSION 1
+#define PACK_HEADER_SIZE 64
+#define PACK_INDEX_ENTRY_SIZE 16
+
+/**
+ * @brief A packed corpus mapped read-only into memory.
+ */
+typedef struct
+{
+    const uint8_t *data;
+    size_t length;
+    uint32_t count;
+    const uint8_t *index;
+} PackCorpus;
+
+int packIsCorpus(const char *path);
+
+int packOpen(PackCorpus *pc, const char *path, char *err, size_t errSize);
+
+void packClose(PackCorpus *pc);
+
+int packLoadBoard(const PackCorpus *pc, uint32_t index, LatinBoard *board, char *err, size_t errSize);
+
+int runPack(const char *outPath, const char *source);
+
+int runUnpack(const char *corpusPath, const char *outDir);
+
+/**
+ * @brief Settings and shared progress of one --generate run.
+ */
+typedef struct
+{
+    int order;
+    int targetGivens;                 // stop removing givens once this few are left
+    int count;                        // puzzles to generate
+    uint64_t seed;                    // puzzle p is generated from seed and p only
+    _Atomic int next;                 // index of the next puzzle to hand out
+    _Atomic int made;                 // puzzles written
+    _Atomic int failed;               // allocation failures
+    _Atomic long long givens;         // givens left over all puzzles
+    pthread_mutex_t outputLock;       // guards the fields below and stdout
+    pthread_cond_t emitted;           // the next puzzle in index order went out
+    int emittedCount;                 // puzzles, failed ones included, written in index order so far
+    int window;                       // puzzles that may finish ahead of the next one to write
+    char *held;                       // window records of SAVE_BUFFER_SIZE bytes, slot p % window
+    size_t *heldLength;               // their lengths, GENERATE_SLOT_EMPTY while not finished
+} GenerateRun;
+
+/** @brief Length of a --generate reorder slot whose puzzle is not finished yet. */
+#define GENERATE_SLOT_EMPTY ((size_t)-1)
+
+/** @brief Search nodes one uniqueness check of --generate may take before the given is kept. */
+#define GENERATE_NODE_BUDGET 20000
+
+/** @brief Search nodes all uniqueness checks of one puzzle may take; after that only forced removals are made. */
+#define GENERATE_PUZZLE_BUDGET 2000000ull
+
+uint64_t rngNext(uint64_t *state);
+
+int randomLatinSquare(LatinBoard *board, int8_t *cube, uint64_t *rng);
+
+int makePuzzle(LatinBoard *board, int targetGivens, uint64_t *rng);
+
+int runGenerate(int order, const char *difficulty, int count, uint64_t seed, int threads);
+
+/** @brief Records in flight between the --stream stages; also the capacity of each queue. */
+#define STREAM_SLOTS 64
+#define STREAM_QUEUE_CAPACITY STREAM_SLOTS
+
+/** @brief Bytes of input the --stream parser holds at once; no record may be larger. */
+#define STREAM_BUFFER_SIZE (1 << 20)
+
+/** @brief Queue item that tells the next stage the input is over. */
+#define STREAM_END UINT32_MAX
+
+/** @brief Times a stage polls a full or empty queue before it sleeps on it. */
+#define SPSC_SPIN_LIMIT 64
+
+/**
+ * @brief Bounded lock-free queue with one producer and one consumer thread.
+ *
+ * head and tail count every pop and push; they sit on separate cache
+ * lines so the two threads do not contend for one. A side that still
+ * finds the queue full or empty after SPSC_SPIN_LIMIT polls sleeps on
+ * wake until the other side moves. sleeping counts the sleepers, and
+ * only while it is non-zero does the other side take the lock to wake
+ * them, so the fast path never touches it.
+ */
+typedef struct
+{
+    _Alignas(64) _Atomic size_t head;
+    _Alignas(64) _Atomic size_t tail;
+    uint32_t items[STREAM_QUEUE_CAPACITY];
+    _Alignas(64) _Atomic int sleeping;
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+} SpscQueue;
+
+/** @brief What the --stream stages found out about a record. */
+typedef enum
+{
+    STREAM_CONFLICT,    // a value repeats in a row or column
+    STREAM_COMPLETE,    // a finished Latin square
+    STREAM_OPEN,        // a consistent puzzle, not solved yet
+    STREAM_SOLVED,
+    STREAM_UNSOLVABLE,
+    STREAM_ERROR        // the solver could not be set up
+} StreamStatus;
+
+/** @brief One record travelling through the --stream pipeline. */
+typedef struct
+{
+    LatinBoard board;
+    unsigned long long record;      // 1-based position in the input
+    int line;                       // line of the record's size
+    StreamStatus status;
+    unsigned long long solutions;
+    unsigned long long nodes;
+    double elapsed;                 // time spent validating and solving, in ms
+} StreamSlot;
+
+/**
+ * @brief Shared state of a --stream run.
+ *
+ * Slot indices flow parser -> validator -> solver -> reporter through
+ * parsed, checked and solved, and back to the parser through free.
+ */
+typedef struct
+{
+    int fd;
+    char *buffer;
+    unsigned long long limit;
+    unsigned long long records;     // written by the parser only
+    char error[160];                // why the parser stopped early, empty at a clean end
+    BoardPool parserPool;
+    SpscQueue free, parsed, checked, solved;
+    StreamSlot slots[STREAM_SLOTS];
+} StreamPipeline;
+
+int runStream(const char *path, unsigned long long limit);
+
+/** @brief Magic, version and layout of the columnar player table written by --analyze. */
+#define ANALYZE_MAGIC "LSQSTAT1"
+#define ANALYZE_VERSION 1
+#define ANALYZE_HEADER_SIZE 32
+#define ANALYZE_COLUMN_ENTRY_SIZE 48
+
+/** @brief Byte ranges of the move log handed out per worker; each holds the sessions starting in it. */
+#define ANALYZE_CHUNKS_PER_THREAD 64
+
+/** @brief Puzzles each --analyze worker keeps loaded, indexed by the hash of their path. */
+#define ANALYZE_PUZZLE_SLOTS 64
+
+/** @brief Totals of one player over the sessions of a move log. */
+typedef struct
+{
+    const char *name;               // points into the log, nameLen bytes
+    uint32_t nameLen;
+    uint64_t hash;
+    uint64_t sessions;
+    uint64_t solved;
+    uint64_t solveMs;               // sum of the times to solve of the solved sessions
+    uint64_t bestMs;                // fastest solve, UINT64_MAX if none
+    uint64_t activeMs;              // sum of the session lengths
+    uint64_t commands;
+    uint64_t results[MOVE_RESULT_COUNT];
+} PlayerStats;
+
+/** @brief Open-addressing table of PlayerStats keyed by player name. */
+typedef struct
+{
+    PlayerStats *slots;
+    size_t capacity;                // a power of two, 0 before the first insert
+    size_t count;
+} PlayerTable;
+
+/** @brief A puzzle loaded by an --analyze worker, with a board its sessions are replayed on. */
+typedef struct
+{
+    char *path;
+    int loaded;                     // 1 loaded, -1 unreadable
+    LatinBoard puzzle;
+    LatinBoard work;
+} AnalyzePuzzle;
+
+/** @brief The move log of one --analyze run and the chunks left to hand out. */
+typedef struct
+{
+    const char *data;
+    size_t length;
+    int chunks;
+    _Atomic int next;               // index of the next chunk to hand out
+} AnalyzeRun;
+
+/** @brief One --analyze worker with its private accumulators, merged after the run. */
+typedef struct
+{
+    AnalyzeRun *run;
+    pthread_t thread;
+    PlayerTable players;
+    AnalyzePuzzle puzzles[ANALYZE_PUZZLE_SLOTS];
+    MoveJournal journal;
+    unsigned long long sessions;
+    unsigned long long skipped;     // sessions with a bad header or an unreadable puzzle
+    unsigned long long malformed;   // lines that are neither a header nor a timed command
+    int failed;                     // out of memory
+} AnalyzeWorker;
+
+int runAnalyze(const char *logPath, const char *outPath, int threads);
+
+/** @brief Commands in one --stress batch; a batch is generated, timed and checked as a unit. */
+#define STRESS_BATCH 4096
+
+/** @brief Longest command --stress generates, newline included. */
+#define STRESS_COMMAND_MAX 32
+
+/** @brief Longest over-long line --stress puts in every batch, newline included; more than play() buffers. */
+#define STRESS_LONG_MAX (2 * COMMAND_READER_SIZE)
+
+/** @brief Commands --stress fires when no --limit is given. */
+#define STRESS_DEFAULT_COMMANDS 10000000ull
+
+/** @brief A batch this many times slower than its worker's mean so far is reported as slow. */
+#define STRESS_SLOW_FACTOR 20
+
+/** @brief Batches a worker times before it looks for slow ones. */
+#define STRESS_WARMUP_BATCHES 16
+
+/** @brief Slow batches each --stress worker keeps for the report. */
+#define STRESS_SLOW_KEEP 4
+
+/** @brief A batch of --stress that took much longer than its worker's others. */
+typedef struct
+{
+    unsigned long long batch;
+    double ms;
+} StressSlow;
+
+/**
+ * @brief One --stress worker: its own copy of the puzzle, journal and counters.
+ *
+ * Workers share nothing but the puzzle they start from, so a run with
+ * the same seed and thread count fires the same commands again.
+ */
+typedef struct
+{
+    const LatinBoard *puzzle;
+    int index;
+    uint64_t seed;
+    unsigned long long target;      // commands to fire
+    pthread_t thread;
+    unsigned long long commands;    // generated so far, counted as stressGenerate() writes them
+    unsigned long long batches;     // finished, also the index of the batch running
+    unsigned long long completions; // times the square was filled and started over
+    unsigned long long loads;       // records mutated and parsed
+    unsigned long long loadsParsed; // of those, how many the loader accepted
+    unsigned long long results[MOVE_RESULT_COUNT];
+    double engineMs;                // parsing and applying the commands
+    double loadMs;
+    double slowestMs;
+    unsigned long long slowestBatch;
+    unsigned long long slowCount;
+    StressSlow slow[STRESS_SLOW_KEEP];
+    FILE *scratch;                  // each batch is read back from here through a CommandReader
+    const char *failure;            // first broken invariant, NULL if none
+    unsigned long long failedBatch;
+    int failed;                     // out of memory
+} StressWorker;
+
+int runStress(const LatinBoard *puzzle, unsigned long long commands, int threads, uint64_t seed);
+
+#ifdef LATINSQUARE_FUZZ
+/** @brief Order of the empty board that runs the commands of a fuzz input without a puzzle. */
+#define FUZZ_DEFAULT_ORDER 9
+
+/** @brief Undo depth of the fuzzed journal, small so that inputs reach the ring's wraparound. */
+#define FUZZ_JOURNAL_CAPACITY 64
+
+/** @brief Inputs the stand-alone fuzz driver takes longer than this, in ms, on are reported as slow. */
+#define FUZZ_SLOW_MS 10.0
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+#endif
+
+/** @brief Returns the value (0 = empty) of cell (i,j), 0-based. */
+static inline int boardGet(const LatinBoard *board, int i, int j)
+{
+    return board->cells[i * board->size + j];
+}
+
+/** @brief Returns non-zero if cell (i,j), 0-based, holds a given value. */
+static inline int boardIsGiven(const LatinBoard *board, int i, int j)
+{
+    int k = i * board->size + j;
+    return (int)((board->given[k >> 6] >> (k & 63)) & 1u);
+}
+
+/** @brief Returns non-zero if val can be placed at (i,j) without a row/column clash. */
+static inline int boardCanPlace(const LatinBoard *board, int i, int j, int val)
+{
+    uint64_t bit = 1ull << (val - 1);
+    return ((board->rowMask[i] | board->colMask[j]) & bit) == 0;
+}
+
+/** @brief Returns the mask of values [1..size] representable on the board. */
+static inline uint64_t boardFullMask(const LatinBoard *board)
+{
+    return (board->size == 64) ? ~0ull : ((1ull << board->size) - 1);
+}
+
+/** @brief Returns the candidate values of the empty cell (i,j) as a bitmask. */
+static inline uint64_t boardCandidates(const LatinBoard *board, int i, int j)
+{
+    return ~(board->rowMask[i] | board->colMask[j]) & boardFullMask(board);
+}
+
+/** @brief Places val (1..size) in the empty cell (i,j) and updates the masks. */
+static inline void boardPlace(LatinBoard *board, int i, int j, int val)
+{
+    uint64_t bit = 1ull << (val - 1);
+    board->cells[i * board->size + j] = (uint8_t)val;
+    board->rowMask[i] |= bit;
+    board->colMask[j] |= bit;
+    board->filled++;
+}
+
+/**
+ * @brief Empties the non-empty cell (i,j) and updates the masks.
+ *
+ * A loaded puzzle may already hold a value twice in a line, so the bit
+ * is only dropped from row i / column j when no other copy is left.
+ */
+static inline void boardClear(LatinBoard *board, int i, int j)
+{
+    int size = board->size;
+    int val = board->cells[i * size + j];
+    uint64_t bit = 1ull << (val - 1);
+    int inRow = 0, inCol = 0;
+    board->cells[i * size + j] = 0;
+    for (int k = 0; k < size; k++)
+    {
+        inRow |= board->cells[i * size + k] == val;
+        inCol |= board->cells[k * size + j] == val;
+    }
+    if (!inRow)
+    {
+        board->rowMask[i] &= ~bit;
+    }
+    if (!inCol)
+    {
+        board->colMask[j] &= ~bit;
+    }
+    board->filled--;
+}
+
+/** @brief Returns the bytes of the packed cells of a compact board of the given order. */
+static inline size_t compactCellBytes(int order)
+{
+    size_t cells = (size_t)order * order;
+    return (order <= COMPACT_NIBBLE_MAX_ORDER) ? (cells + 1) / 2 : cells;
+}
+
+/** @brief Returns the bytes of a compact board of the given order, header included. */
+static inline size_t compactBoardBytes(int order)
+{
+    return 1 + compactCellBytes(order) + ((size_t)order * order + 7) / 8;
+}
+
+/** @brief Returns the value (0 = empty) of cell (i,j) of a compact board, 0-based. */
+static inline int compactGet(const CompactBoard *cb, int i, int j)
+{
+    int k = i * cb->size + j;
+    if (cb->size <= COMPACT_NIBBLE_MAX_ORDER)
+    {
+        return (cb->data[k >> 1] >> ((k & 1) * 4)) & 15;
+    }
+    return cb->data[k];
+}
+
+/** @brief Returns non-zero if cell (i,j) of a compact board, 0-based, holds a given value. */
+static inline int compactIsGiven(const CompactBoard *cb, int i, int j)
+{
+    int k = i * cb->size + j;
+    return (cb->data[compactCellBytes(cb->size) + (size_t)(k >> 3)] >> (k & 7)) & 1;
+}
+
+/** @brief Stores val (0 = empty) in cell (i,j) of a compact board, 0-based. */
+static inline void compactSet(CompactBoard *cb, int i, int j, int val)
+{
+    int k = i * cb->size + j;
+    if (cb->size <= COMPACT_NIBBLE_MAX_ORDER)
+    {
+        int shift = (k & 1) * 4;
+        cb->data[k >> 1] = (uint8_t)((cb->data[k >> 1] & ~(15 << shift)) | (val << shift));
+        return;
+    }
+    cb->data[k] = (uint8_t)val;
+}
+
+/** @brief Returns non-zero if val is in neither row i nor column j of a compact board. */
+static inline int compactCanPlace(const CompactBoard *cb, int i, int j, int val)
+{
+    for (int k = 0; k < cb->size; k++)
+    {
+        if (compactGet(cb, i, k) == val || compactGet(cb, k, j) == val)
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/** @brief BoardAccess of a LatinBoard. */
+static int latinAccessGet(const void *board, int i, int j)
+{
+    return boardGet(board, i, j);
+}
+
+static int latinAccessIsGiven(const void *board, int i, int j)
+{
+    return boardIsGiven(board, i, j);
+}
+
+static int latinAccessCanPlace(const void *board, int i, int j, int val)
+{
+    return boardCanPlace(board, i, j, val);
+}
+
+static void latinAccessPlace(void *board, int i, int j, int val)
+{
+    boardPlace(board, i, j, val);
+}
+
+static void latinAccessClear(void *board, int i, int j)
+{
+    boardClear(board, i, j);
+}
+
+static const BoardAccess latinAccess = {
+    latinAccessGet, latinAccessIsGiven, latinAccessCanPlace, latinAccessPlace, latinAccessClear
+};
+
+/** @brief BoardAccess of a CompactBoard. */
+static int compactAccessGet(const void *cb, int i, int j)
+{
+    return compactGet(cb, i, j);
+}
+
+static int compactAccessIsGiven(const void *cb, int i, int j)
+{
+    return compactIsGiven(cb, i, j);
+}
+
+static int compactAccessCanPlace(const void *cb, int i, int j, int val)
+{
+    return compactCanPlace(cb, i, j, val);
+}
+
+static void compactAccessPlace(void *cb, int i, int j, int val)
+{
+    compactSet(cb, i, j, val);
+}
+
+static void compactAccessClear(void *cb, int i, int j)
+{
+    compactSet(cb, i, j, 0);
+}
+
+static const BoardAccess compactAccess = {
+    compactAccessGet, compactAccessIsGiven, compactAccessCanPlace, compactAccessPlace, compactAccessClear
+};
+
+/** @brief The pool boardInit() draws from on this thread, NULL for the heap. */
+static _Thread_local BoardPool *threadBoardPool;
+
+/**
+ * @brief Prepares an empty pool.
+ *
+ * @param pool The pool to initialise.
+ * @param shared Non-zero if several threads will use the pool.
+ * @return 0 on success, or -1 on error.
+ */
+int boardPoolInit(BoardPool *pool, int shared)
+{
+    memset(pool, 0, sizeof(*pool));
+    pool->shared = shared;
+    return (shared && pthread_mutex_init(&pool->lock, NULL) != 0) ? -1 : 0;
+}
+
+/**
+ * @brief Returns every slab of a pool to the heap.
+ *
+ * @param pool The pool; none of its boards may still be in use.
+ */
+void boardPoolDestroy(BoardPool *pool)
+{
+    while (pool->slabs != NULL)
+    {
+        uint8_t *next;
+        memcpy(&next, pool->slabs, sizeof(next));
+        free(pool->slabs);
+        pool->slabs = next;
+    }
+    if (pool->shared)
+    {
+        pthread_mutex_destroy(&pool->lock);
+    }
+    if (threadBoardPool == pool)
+    {
+        threadBoardPool = NULL;
+    }
+    memset(pool, 0, sizeof(*pool));
+}
+
+/**
+ * @brief Makes boardInit() on the calling thread draw from pool.
+ *
+ * @param pool The pool, or NULL to go back to the heap.
+ */
+void boardPoolUseForThread(BoardPool *pool)
+{
+    threadBoardPool = pool;
+}
+
+/** @brief Takes a block of total bytes for a board of the given order from a pool. */
+static void *boardPoolTake(BoardPool *pool, int size, size_t total)
+{
+    void *block = NULL;
+    if (pool->shared)
+    {
+        pthread_mutex_lock(&pool->lock);
+    }
+
+    if (pool->freeList[size] != NULL)
+    {
+        block = pool->freeList[size];
+        memcpy(&pool->freeList[size], block, sizeof(void *));
+        pool->reused++;
+    }
+    else
+    {
+        if (pool->bumpLeft < total)
+        {
+            // the first 64 bytes of a slab link it to the previous one
+            size_t slabSize = (total + 64 > BOARD_POOL_SLAB_SIZE) ? total + 64 : BOARD_POOL_SLAB_SIZE;
+            uint8_t *slab = aligned_alloc(64, slabSize);
+            if (slab != NULL)
+            {
+                memcpy(slab, &pool->slabs, sizeof(pool->slabs));
+                pool->slabs = slab;
+                pool->bump = slab + 64;
+                pool->bumpLeft = slabSize - 64;
+                pool->slabCount++;
+            }
+        }
+        if (pool->bumpLeft >= total)
+        {
+            block = pool->bump;
+            pool->bump += total;
+            pool->bumpLeft -= total;
+        }
+    }
+
+    if (pool->shared)
+    {
+        pthread_mutex_unlock(&pool->lock);
+    }
+    return block;
+}
+
+/** @brief Puts the block of a board of the given order on its pool's free list. */
+static void boardPoolGive(BoardPool *pool, int size, void *block)
+{
+    if (pool->shared)
+    {
+        pthread_mutex_lock(&pool->lock);
+    }
+    memcpy(block, &pool->freeList[size], sizeof(void *));
+    pool->freeList[size] = block;
+    if (pool->shared)
+    {
+        pthread_mutex_unlock(&pool->lock);
+    }
+}
+
+/**
+ * @brief Allocates an empty board of the given order.
+ * 
+ * All arrays live in one 64-byte aligned allocation so a board occupies
+ * as few cache lines as its order allows. The block comes from the
+ * thread's pool when one is set, from the heap otherwise.
+ * 
+ * @param board The board to initialise.
+ * @param size The order of the Latin square, [1..MAX_ORDER].
+ * @return 0 on success, or -1 on error.
+ */
+int boardInit(LatinBoard *board, int size)
+{
+    memset(board, 0, sizeof(*board));
+    if (size <= 0 || size > MAX_ORDER)
+    {
+        return -1;
+    }
+
+    size_t cellBytes = ((size_t)size * size + 63) & ~(size_t)63;
+    size_t givenWords = ((size_t)size * size + 63) / 64;
+    size_t total = cellBytes + (givenWords + 2 * (size_t)size) * sizeof(uint64_t);
+    total = (total + 63) & ~(size_t)63;
+
+    BoardPool *pool = threadBoardPool;
+    uint8_t *block = (pool != NULL) ? boardPoolTake(pool, size, total) : aligned_alloc(64, total);
+    if (block == NULL)
+    {
+        return -1;
+    }
+    memset(block, 0, total);
+
+    board->size = size;
+    board->pool = pool;
+    board->kernels = boardKernelsFor(size);
+    board->storage = block;
+    board->cells = block;
+    board->given = (uint64_t *)(block + cellBytes);
+    board->rowMask = board->given + givenWords;
+    board->colMask = board->rowMask + size;
+    return 0;
+}
+
+/**
+ * @brief Releases the storage of a board.
+ * 
+ * @param board The board to release.
+ */
+void boardFree(LatinBoard *board)
+{
+    if (board->pool != NULL && board->storage != NULL)
+    {
+        boardPoolGive(board->pool, board->size, board->storage);
+    }
+    else
+    {
+        free(board->storage);
+    }
+    memset(board, 0, sizeof(*board));
+}
+
+/**
+ * @brief Makes dst an independent copy of src.
+ * 
+ * @param dst The board to initialise as a copy.
+ * @param src The board to copy.
+ * @return 0 on success, or -1 on error.
+ */
+int boardCopy(LatinBoard *dst, const LatinBoard *src)
+{
+    if (boardInit(dst, src->size) != 0)
+    {
+        return -1;
+    }
+    boardAssign(dst, src);
+    return 0;
+}
+
+/**
+ * @brief Overwrites dst with the contents of src without reallocating.
+ *
+ * @param dst A board of the same order as src.
+ * @param src The board to copy.
+ */
+void boardAssign(LatinBoard *dst, const LatinBoard *src)
+{
+    size_t total = (size_t)((uint8_t *)(src->colMask + src->size) - (uint8_t *)src->storage);
+    memcpy(dst->storage, src->storage, total);
+    dst->filled = src->filled;
+}
+
+/**
+ * @brief Recomputes the occupancy masks and filled count from the cells.
+ * 
+ * @param board The board whose masks are rebuilt.
+ */
+void boardRebuildMasks(LatinBoard *board)
+{
+    int size = board->size;
+    board->filled = 0;
+    memset(board->rowMask, 0, (size_t)size * sizeof(uint64_t));
+    memset(board->colMask, 0, (size_t)size * sizeof(uint64_t));
+
+    for (int i = 0; i < size; i++)
+    {
+        for (int j = 0; j < size; j++)
+        {
+            int v = boardGet(board, i, j);
+            if (v == 0)
+            {
+                continue;
+            }
+            board->filled++;
+            board->rowMask[i] |= 1ull << (v - 1);
+            board->colMask[j] |= 1ull << (v - 1);
+        }
+    }
+}
+
+/**
+ * @brief Checks the occupancy masks and filled count against the cells.
+ *
+ * The masks are kept move by move, so they must be exactly what
+ * boardRebuildMasks() would compute, duplicates on the board included.
+ *
+ * @param board The board to check.
+ * @return 0 if they agree and every cell is in [0..size], or -1 otherwise.
+ */
+int boardCheckMasks(const LatinBoard *board)
+{
+    int size = board->size;
+    int filled = 0;
+    uint64_t rows[MAX_ORDER] = {0}, cols[MAX_ORDER] = {0};
+
+    for (int i = 0; i < size; i++)
+    {
+        for (int j = 0; j < size; j++)
+        {
+            int v = boardGet(board, i, j);
+            if (v > size)
+            {
+                return -1;
+            }
+            if (v != 0)
+            {
+                filled++;
+                rows[i] |= 1ull << (v - 1);
+                cols[j] |= 1ull << (v - 1);
+            }
+        }
+    }
+    if (filled != board->filled || memcmp(rows, board->rowMask, (size_t)size * sizeof(uint64_t)) != 0 ||
+        memcmp(cols, board->colMask, (size_t)size * sizeof(uint64_t)) != 0)
+    {
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Packs a board into a compact board.
+ *
+ * @param cb Room for compactBoardBytes(board->size) bytes.
+ * @param board The board to pack.
+ */
+void compactFromBoard(CompactBoard *cb, const LatinBoard *board)
+{
+    int size = board->size;
+    uint8_t *given = cb->data + compactCellBytes(size);
+    memset(cb, 0, compactBoardBytes(size));
+    cb->size = (uint8_t)size;
+
+    for (int i = 0; i < size; i++)
+    {
+        for (int j = 0; j < size; j++)
+        {
+            int k = i * size + j;
+            compactSet(cb, i, j, boardGet(board, i, j));
+            given[k >> 3] |= (uint8_t)(boardIsGiven(board, i, j) << (k & 7));
+        }
+    }
+}
+
+/**
+ * @brief Unpacks a compact board into a new LatinBoard with its masks.
+ *
+ * @param board The board to initialise.
+ * @param cb The compact board.
+ * @return 0 on success, or -1 on error.
+ */
+int compactToBoard(LatinBoard *board, const CompactBoard *cb)
+{
+    int size = cb->size;
+    if (boardInit(board, size) != 0)
+    {
+        return -1;
+    }
+    for (int i = 0; i < size; i++)
+    {
+        for (int j = 0; j < size; j++)
+        {
+            int k = i * size + j;
+            board->cells[k] = (uint8_t)compactGet(cb, i, j);
+            board->given[k >> 6] |= (uint64_t)compactIsGiven(cb, i, j) << (k & 63);
+        }
+    }
+    boardRebuildMasks(board);
+    return 0;
+}
+
+/** @brief The text form of formatLatinSquare() over any board representation. */
+static inline __attribute__((always_inline)) size_t formatSquareBody(const void *board, int size,
+                                                                     const BoardAccess *access, char *out)
+{
+    char *p = out;
+
+    p += sprintf(p, "%d\n", size);
+    for (int i = 0; i < size; i++)
+    {
+        for (int j = 0; j < size; j++)
+        {
+            int v = access->get(board, i, j);
+            if (access->isGiven(board, i, j))
+            {
+                *p++ = '-';
+            }
+            if (v >= 10)
+            {
+                *p++ = (char)('0' + v / 10);
+            }
+            *p++ = (char)('0' + v % 10);
+            *p++ = (j == size - 1) ? '\n' : ' ';
+        }
+    }
+    return (size_t)(p - out);
+}
+
+/**
+ * @brief Formats the Latin square in the text file format.
+ *
+ * The size goes on the first line, then one line per row with the
+ * cells separated by spaces and given cells written as negative values.
+ *
+ * @param board The Latin square to be formatted.
+ * @param out Buffer of at least SAVE_BUFFER_SIZE bytes.
+ * @return The number of bytes written to out.
+ */
+size_t formatLatinSquare(const LatinBoard *board, char *out)
+{
+    return formatSquareBody(board, board->size, &latinAccess, out);
+}
+
+/**
+ * @brief Formats a compact board in the input file format, like formatLatinSquare().
+ *
+ * @param cb The compact board.
+ * @param out Buffer of at least SAVE_BUFFER_SIZE bytes.
+ * @return The number of bytes written to out.
+ */
+size_t formatCompactSquare(const CompactBoard *cb, char *out)
+{
+    return formatSquareBody(cb, cb->size, &compactAccess, out);
+}
+
+/** @brief Writes a formatted save through a temporary file, flushed to disk and renamed over fileNameOut. */
+static int saveText(const char *buf, size_t len, const char *fileNameOut)
+{
+    char tmpName[4096];
+    if (snprintf(tmpName, sizeof(tmpName), "%s.tmp.%ld", fileNameOut, (long)getpid()) >= (int)sizeof(tmpName))
+    {
+        return -1;
+    }
+
+    int fd = open(tmpName, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    if (fd < 0)
+    {
+        return -1;
+    }
+
+    size_t done = 0;
+    while (done < len)
+    {
+        ssize_t got = write(fd, buf + done, len - done);
+        if (got <= 0)
+        {
+            break;
+        }
+        done += (size_t)got;
+    }
+
+    int ok = (done == len) && fdatasync(fd) == 0;
+    if (close(fd) != 0 || !ok)
+    {
+        unlink(tmpName);
+        return -1;
+    }
+
+    if (rename(tmpName, fileNameOut) != 0)
+    {
+        unlink(tmpName);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Saves the Latin square to a file without printing anything.
+ *
+ * The whole board is formatted into one stack buffer and written with a
+ * single write() to a temporary file next to the target, which is then
+ * flushed to disk and renamed over it. A crash mid-save therefore
+ * leaves either the old or the new file, never a torn one.
+ *
+ * @param board The Latin square to be written to the file.
+ * @param fileNameOut The name of the file where the Latin square will be saved.
+ * @return 0 on success, or -1 if the file could not be written.
+ */
+int saveLatinSquare(const LatinBoard *board, const char *fileNameOut)
+{
+    char buf[SAVE_BUFFER_SIZE];
+    return saveText(buf, formatLatinSquare(board, buf), fileNameOut);
+}
+
+/**
+ * @brief Saves a compact board like saveLatinSquare(), without unpacking it.
+ *
+ * @param cb The compact board to be written to the file.
+ * @param fileNameOut The name of the file where it will be saved.
+ * @return 0 on success, or -1 if the file could not be written.
+ */
+int saveCompactBoard(const CompactBoard *cb, const char *fileNameOut)
+{
+    char buf[SAVE_BUFFER_SIZE];
+    return saveText(buf, formatCompactSquare(cb, buf), fileNameOut);
+}
+
+
+/**
+ * @brief Writes the current state of the Latin square to a file.
+ *
+ * This function saves the contents of the given Latin square
+ * to a specified output file and reports the result to the player.
+ *
+ * @see saveLatinSquare(const LatinBoard *board, const char *fileNameOut)
+ *
+ * @param board The Latin square to be written to the file.
+ * @param fileNameOut The name of the file where the Latin square will be saved.
+ */
+void writeLatinSquare (const LatinBoard *board, char *fileNameOut){
+    STAT_TIMER_START(writeStart);
+    int saved = saveLatinSquare(board, fileNameOut);
+    STAT_TIMER_STOP(STAT_TIME_WRITE, writeStart);
+    if (saved != 0) {
+        printf("Error : Unable to generate file %s to save the game!\n",fileNameOut);
+        return;
+    }
+
+    printf("Saving to %s...\nDone\n",fileNameOut);
+
+
+}
+
+/**
+ * @brief Displays the instructions for user commands.
+ * 
+ * This function prints a set of instructions to the console, 
+ * detailing how the user can input commands to interact with 
+ * the Latin square game.
+ */
+void displayInstructionDialogue()
+{
+    fputs(instructionText, stdout);
+}
+
+/** @brief The rules of applyMove() over any board representation. */
+static inline __attribute__((always_inline)) MoveResult applyMoveBody(void *board, int size, const BoardAccess *access,
+                                                                      int i, int j, int val)
+{
+
+    // Check for game termination command (0,0=0)
+    if ((i == 0) && (j == 0) && (val == 0))
+    {
+        return MOVE_SAVE;
+    }
+
+    // Check if i, j are within allowed range
+    if (((i < 1) || (i > size)) || ((j < 1) || (j > size)) || ((val < 0) || (val > size)))
+    {
+        return MOVE_ERR_RANGE;
+    }
+
+    // Check if the cell is occupied
+    if (access->get(board, i - 1, j - 1) != 0)
+    {
+        // Given values can be neither cleared nor overwritten; a value on a
+        // given is reported as a rule break, like play() always did
+        if (access->isGiven(board, i - 1, j - 1))
+        {
+            return (val == 0) ? MOVE_ERR_GIVEN : MOVE_ERR_RULE;
+        }
+
+        // Cell is occupied by a player value: clear it, or refuse to insert
+        if (val != 0)
+        {
+            return MOVE_ERR_OCCUPIED;
+        }
+        access->clear(board, i - 1, j - 1);
+        return MOVE_CLEARED;
+    }
+
+    // Clearing an empty cell leaves the board unchanged
+    if (val == 0)
+    {
+        return MOVE_CLEARED;
+    }
+
+    // Check Latin square rules for duplicate values in row/column
+    if (!access->canPlace(board, i - 1, j - 1, val))
+    {
+        return MOVE_ERR_RULE;
+    }
+
+    access->place(board, i - 1, j - 1, val);
+    return MOVE_INSERTED;
+}
+/**
+ * @brief Applies one i,j=val command to the board using the game rules.
+ *
+ * The checks run in the same order as the messages of play(): save
+ * command, range, occupied or given cell, then the row/column rule.
+ * A value on a given cell is refused as a rule break. Clearing an empty
+ * cell is accepted and changes nothing.
+ *
+ * @param board The Latin square to be modified.
+ * @param i Row, 1-based.
+ * @param j Column, 1-based.
+ * @param val Value to insert, or 0 to clear.
+ * @return What happened; MOVE_SAVE for the 0,0=0 command.
+ */
+MoveResult applyMove(LatinBoard *board, int i, int j, int val)
+{
+    return applyMoveBody(board, board->size, &latinAccess, i, j, val);
+}
+
+/**
+ * @brief Applies one i,j=val command to a compact board with the rules of applyMove().
+ *
+ * @param cb The compact board to be modified.
+ * @param i Row, 1-based.
+ * @param j Column, 1-based.
+ * @param val Value to insert, or 0 to clear.
+ * @return What happened; MOVE_SAVE for the 0,0=0 command.
+ */
+MoveResult compactApplyMove(CompactBoard *cb, int i, int j, int val)
+{
+    return applyMoveBody(cb, cb->size, &compactAccess, i, j, val);
+}
+
+/**
+ * @brief Allocates an empty journal.
+ *
+ * @param journal The journal to initialise.
+ * @param capacity Number of entries kept before the oldest is dropped.
+ * @return 0 on success, or -1 on allocation failure.
+ */
+int journalInit(MoveJournal *journal, size_t capacity)
+{
+    memset(journal, 0, sizeof(*journal));
+    journal->entries = malloc(capacity * sizeof(JournalEntry));
+    if (journal->entries == NULL)
+    {
+        return -1;
+    }
+    journal->capacity = capacity;
+    return 0;
+}
+
+/**
+ * @brief Releases the storage of a journal.
+ *
+ * @param journal The journal to release.
+ */
+void journalFree(MoveJournal *journal)
+{
+    free(journal->entries);
+    memset(journal, 0, sizeof(*journal));
+}
+
+/**
+ * @brief Empties a journal, keeping its storage.
+ *
+ * @param journal The journal to empty.
+ */
+void journalClear(MoveJournal *journal)
+{
+    journal->head = journal->count = journal->cursor = 0;
+    journal->dropped = journal->changed = 0;
+}
+
+/**
+ * @brief Returns the number of the oldest entry written since the last call.
+ *
+ * Entries are numbered from the first one ever recorded, so the number
+ * of logical entry l is dropped + l. Undo and redo move only the
+ * cursor; every entry numbered below the result is unchanged since the
+ * previous call. The autosave writer uses it to copy only new entries.
+ *
+ * @param journal The journal.
+ * @return The number of the oldest written entry, or dropped + count if none was.
+ */
+unsigned long long journalChanges(MoveJournal *journal)
+{
+    unsigned long long changed = journal->changed;
+    journal->changed = journal->dropped + journal->count;
+    return changed;
+}
+
+/** @brief Returns the entry at logical position l (0 = oldest kept). */
+static inline JournalEntry *journalAt(const MoveJournal *journal, size_t l)
+{
+    return &journal->entries[(journal->head + l) % journal->capacity];
+}
+
+/**
+ * @brief Appends a change after the applied entries, dropping the redo tail.
+ *
+ * @param journal The journal.
+ * @param cell Row-major index of the changed cell.
+ * @param oldVal Value of the cell before the change (0 = empty).
+ * @param newVal Value of the cell after the change (0 = empty).
+ */
+void journalRecord(MoveJournal *journal, int cell, int oldVal, int newVal)
+{
+    journal->count = journal->cursor;
+    if (journal->count == journal->capacity)
+    {
+        journal->head = (journal->head + 1) % journal->capacity;
+        journal->count--;
+        journal->cursor--;
+        journal->dropped++;
+    }
+    if (journal->dropped + journal->count < journal->changed)
+    {
+        journal->changed = journal->dropped + journal->count;
+    }
+    JournalEntry *e = journalAt(journal, journal->count);
+    e->cell = (uint16_t)cell;
+    e->oldVal = (uint8_t)oldVal;
+    e->newVal = (uint8_t)newVal;
+    journal->count++;
+    journal->cursor++;
+}
+
+/** @brief Sets a player cell to v (0 = empty) through the occupancy masks. */
+static void journalSetCell(LatinBoard *board, int cell, int v)
+{
+    int i = cell / board->size, j = cell % board->size;
+    if (board->cells[cell] != 0)
+    {
+        boardClear(board, i, j);
+    }
+    if (v != 0)
+    {
+        boardPlace(board, i, j, v);
+    }
+}
+
+/**
+ * @brief Reverts the last applied change.
+ *
+ * @param journal The journal.
+ * @param board The board the journal belongs to.
+ * @return The changed cell, or -1 if there is nothing to undo.
+ */
+int journalUndo(MoveJournal *journal, LatinBoard *board)
+{
+    if (journal->cursor == 0)
+    {
+        return -1;
+    }
+    const JournalEntry *e = journalAt(journal, journal->cursor - 1);
+    if (board->cells[e->cell] != e->newVal)
+    {
+        return -1; // the board no longer matches the journal
+    }
+    journalSetCell(board, e->cell, e->oldVal);
+    journal->cursor--;
+    return e->cell;
+}
+
+/**
+ * @brief Re-applies the last undone change.
+ *
+ * @param journal The journal.
+ * @param board The board the journal belongs to.
+ * @return The changed cell, or -1 if there is nothing to redo.
+ */
+int journalRedo(MoveJournal *journal, LatinBoard *board)
+{
+    if (journal->cursor == journal->count)
+    {
+        return -1;
+    }
+    const JournalEntry *e = journalAt(journal, journal->cursor);
+    if (board->cells[e->cell] != e->oldVal ||
+        (e->newVal != 0 && !boardCanPlace(board, e->cell / board->size, e->cell % board->size, e->newVal)))
+    {
+        return -1;
+    }
+    journalSetCell(board, e->cell, e->newVal);
+    journal->cursor++;
+    return e->cell;
+}
+
+/**
+ * @brief Saves the journal next to a saved game.
+ *
+ * The text format is a "journal 1" line, then "size count cursor", then
+ * one "cell old new" line per entry, oldest first. It is formatted in
+ * memory and written like the board by saveText(): to a temporary file,
+ * flushed to disk and renamed into place, so a crash never leaves a
+ * torn journal next to a good board.
+ *
+ * @param journal The journal to save.
+ * @param board The board it belongs to.
+ * @param fileName The journal file, conventionally out-<file>.journal.
+ * @return 0 on success, or -1 on error.
+ */
+int journalSave(const MoveJournal *journal, const LatinBoard *board, const char *fileName)
+{
+    // "cell old new\n" is at most 5 + 1 + 2 + 1 + 2 + 1 bytes
+    char *buf = malloc(64 + journal->count * 12);
+    if (buf == NULL)
+    {
+        return -1;
+    }
+    char *p = buf + sprintf(buf, "journal 1\n%d %zu %zu\n", board->size, journal->count, journal->cursor);
+    for (size_t l = 0; l < journal->count; l++)
+    {
+        const JournalEntry *e = journalAt(journal, l);
+        p += sprintf(p, "%d %d %d\n", e->cell, e->oldVal, e->newVal);
+    }
+
+    int status = saveText(buf, (size_t)(p - buf), fileName);
+    free(buf);
+    return status;
+}
+
+/**
+ * @brief Checks that a loaded journal can be walked from the board it was loaded for.
+ *
+ * Undoing the applied entries newest first, every entry must find its
+ * new value in its cell; redoing the undone ones oldest first, its old
+ * value. No entry may touch a given.
+ *
+ * @return 0 if the journal fits the board, or -1 otherwise.
+ */
+static int journalFits(const MoveJournal *journal, const LatinBoard *board)
+{
+    int size = board->size;
+    uint8_t cells[MAX_ORDER * MAX_ORDER];
+
+    for (size_t l = 0; l < journal->count; l++)
+    {
+        const JournalEntry *e = journalAt(journal, l);
+        if (boardIsGiven(board, e->cell / size, e->cell % size))
+        {
+            return -1;
+        }
+    }
+
+    memcpy(cells, board->cells, (size_t)size * size);
+    for (size_t l = journal->cursor; l-- > 0;)
+    {
+        const JournalEntry *e = journalAt(journal, l);
+        if (cells[e->cell] != e->newVal)
+        {
+            return -1;
+        }
+        cells[e->cell] = e->oldVal;
+    }
+
+    memcpy(cells, board->cells, (size_t)size * size);
+    for (size_t l = journal->cursor; l < journal->count; l++)
+    {
+        const JournalEntry *e = journalAt(journal, l);
+        if (cells[e->cell] != e->oldVal)
+        {
+            return -1;
+        }
+        cells[e->cell] = e->newVal;
+    }
+    return 0;
+}
+
+/**
+ * @brief Loads a journal saved by journalSave() for the given board.
+ *
+ * The entries must fit the board as journalFits() checks, so a stale or
+ * edited journal is refused rather than undoing onto a given or into a
+ * board the game never held.
+ *
+ * @param journal An initialised journal, replaced by the file's entries.
+ * @param board The resumed board the journal must belong to.
+ * @param fileName The journal file.
+ * @return 0 on success, or -1 if the file is missing or does not match the board.
+ */
+int journalLoad(MoveJournal *journal, const LatinBoard *board, const char *fileName)
+{
+    FILE *fp = fopen(fileName, "r");
+    int version, size;
+    size_t count, cursor;
+
+    if (fp == NULL)
+    {
+        return -1;
+    }
+    if (fscanf(fp, "journal %d %d %zu %zu", &version, &size, &count, &cursor) != 4 ||
+        version != 1 || size != board->size || cursor > count)
+    {
+        fclose(fp);
+        return -1;
+    }
+
+    journalClear(journal);
+    size_t skip = (count > journal->capacity) ? count - journal->capacity : 0;
+    for (size_t l = 0; l < count; l++)
+    {
+        int cell, oldVal, newVal;
+        if (fscanf(fp, "%d %d %d", &cell, &oldVal, &newVal) != 3 || cell < 0 || cell >= size * size ||
+            oldVal < 0 || oldVal > size || newVal < 0 || newVal > size)
+        {
+            fclose(fp);
+            journal->count = journal->cursor = 0;
+            return -1;
+        }
+        if (l >= skip)
+        {
+            JournalEntry *e = journalAt(journal, journal->count++);
+            e->cell = (uint16_t)cell;
+            e->oldVal = (uint8_t)oldVal;
+            e->newVal = (uint8_t)newVal;
+        }
+    }
+    fclose(fp);
+    journal->cursor = (cursor > skip) ? cursor - skip : 0;
+    if (journalFits(journal, board) != 0)
+    {
+        journal->count = journal->cursor = 0;
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Brings the queued snapshot up to the game state.
+ *
+ * The board is copied whole, the journal only from the oldest entry
+ * either slot may lack: after a move that is one entry, not the ring.
+ */
+static void autosaveCopy(Autosave *as, const LatinBoard *board, MoveJournal *journal)
+{
+    AutosaveSnapshot *snap = as->queued;
+    boardAssign(&snap->board, board);
+    if (journal != NULL && snap->journal.capacity != 0)
+    {
+        unsigned long long changed = journalChanges(journal);
+        for (int s = 0; s < 2; s++)
+        {
+            if (changed < as->slots[s].stale)
+            {
+                as->slots[s].stale = changed;
+            }
+        }
+
+        MoveJournal *mirror = &snap->journal;
+        mirror->head = journal->head;
+        mirror->count = journal->count;
+        mirror->cursor = journal->cursor;
+        mirror->dropped = journal->dropped;
+        size_t l = (snap->stale > journal->dropped) ? (size_t)(snap->stale - journal->dropped) : 0;
+        for (; l < journal->count; l++)
+        {
+            *journalAt(mirror, l) = *journalAt(journal, l);
+        }
+        snap->stale = journal->dropped + journal->count;
+    }
+}
+
+/** @brief Body of the autosave writer: saves the newest snapshot until told to stop. */
+static void *autosaveMain(void *arg)
+{
+    Autosave *as = arg;
+    pthread_mutex_lock(&as->lock);
+    for (;;)
+    {
+        while (!as->pending && !as->stopping)
+        {
+            pthread_cond_wait(&as->wake, &as->lock);
+        }
+        if (!as->pending)
+        {
+            break;
+        }
+
+        AutosaveSnapshot *snap = as->queued;
+        as->queued = as->writing;
+        as->writing = snap;
+        as->pending = 0;
+        as->busy = 1;
+        pthread_mutex_unlock(&as->lock);
+
+        int failed = saveLatinSquare(&snap->board, as->fileName) != 0 ||
+                     (snap->journal.capacity != 0 && journalSave(&snap->journal, &snap->board, as->journalName) != 0);
+
+        pthread_mutex_lock(&as->lock);
+        as->busy = 0;
+        as->failed |= failed;
+        if (!as->pending)
+        {
+            pthread_cond_broadcast(&as->drained);
+        }
+    }
+    pthread_mutex_unlock(&as->lock);
+    return NULL;
+}
+
+/**
+ * @brief Starts the autosave writer of a game.
+ *
+ * @param as The writer to start.
+ * @param board The board of the game; snapshots must have its order.
+ * @param journal The journal of the game, or NULL to save the board only.
+ * @param outFileName The save file; the journal goes to <outFileName>.journal.
+ * @return 0 on success, or -1 on error.
+ */
+int autosaveStart(Autosave *as, const LatinBoard *board, const MoveJournal *journal, const char *outFileName)
+{
+    memset(as, 0, sizeof(*as));
+    snprintf(as->fileName, sizeof(as->fileName), "%s", outFileName);
+    snprintf(as->journalName, sizeof(as->journalName), "%s.journal", outFileName);
+
+    for (int s = 0; s < 2; s++)
+    {
+        if (boardCopy(&as->slots[s].board, board) != 0 ||
+            (journal != NULL && journalInit(&as->slots[s].journal, journal->capacity) != 0))
+        {
+            for (int f = 0; f <= s; f++)
+            {
+                boardFree(&as->slots[f].board);
+                journalFree(&as->slots[f].journal);
+            }
+            return -1;
+        }
+    }
+    as->queued = &as->slots[0];
+    as->writing = &as->slots[1];
+
+    if (pthread_mutex_init(&as->lock, NULL) != 0 || pthread_cond_init(&as->wake, NULL) != 0 ||
+        pthread_cond_init(&as->drained, NULL) != 0 || pthread_create(&as->thread, NULL, autosaveMain, as) != 0)
+    {
+        for (int s = 0; s < 2; s++)
+        {
+            boardFree(&as->slots[s].board);
+            journalFree(&as->slots[s].journal);
+        }
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Hands the current game state to the writer without waiting for the disk.
+ *
+ * A snapshot the writer has not started on yet is replaced.
+ *
+ * @param as The writer.
+ * @param board The board of the game.
+ * @param journal The journal of the game, or NULL.
+ */
+void autosaveQueue(Autosave *as, const LatinBoard *board, MoveJournal *journal)
+{
+    pthread_mutex_lock(&as->lock);
+    autosaveCopy(as, board, journal);
+    as->pending = 1;
+    pthread_cond_signal(&as->wake);
+    pthread_mutex_unlock(&as->lock);
+}
+
+/**
+ * @brief Waits until every queued snapshot is on disk.
+ *
+ * play() calls it before the final save of 0,0=0 or a win, so no
+ * autosave can land after that save.
+ *
+ * @param as The writer.
+ * @return 0 if every autosave so far succeeded, -1 otherwise.
+ */
+int autosaveFlush(Autosave *as)
+{
+    pthread_mutex_lock(&as->lock);
+    while (as->pending || as->busy)
+    {
+        pthread_cond_wait(&as->drained, &as->lock);
+    }
+    int failed = as->failed;
+    pthread_mutex_unlock(&as->lock);
+    return failed ? -1 : 0;
+}
+
+/**
+ * @brief Flushes the writer, stops its thread and releases its snapshots.
+ *
+ * @param as The writer.
+ * @return 0 if every autosave succeeded, -1 otherwise.
+ */
+int autosaveStop(Autosave *as)
+{
+    int status = autosaveFlush(as);
+    pthread_mutex_lock(&as->lock);
+    as->stopping = 1;
+    pthread_cond_signal(&as->wake);
+    pthread_mutex_unlock(&as->lock);
+    pthread_join(as->thread, NULL);
+
+    pthread_mutex_destroy(&as->lock);
+    pthread_cond_destroy(&as->wake);
+    pthread_cond_destroy(&as->drained);
+    for (int s = 0; s < 2; s++)
+    {
+        boardFree(&as->slots[s].board);
+        journalFree(&as->slots[s].journal);
+    }
+    return status;
+}
+
+/**
+ * @brief Applies one parsed command, journaling every change it makes.
+ *
+ * @param board The Latin square to be modified.
+ * @param journal The game's journal, or NULL to play without undo.
+ * @param kind CMD_MOVE, CMD_UNDO, CMD_REDO or CMD_HINT.
+ * @param i Row of a move, 1-based.
+ * @param j Column of a move, 1-based.
+ * @param val Value of a move, 0 to clear.
+ * @param cell Receives the changed cell, or -1 if nothing changed.
+ * @return What happened.
+ */
+MoveResult playCommand(LatinBoard *board, MoveJournal *journal, CommandStatus kind, int i, int j, int val, int *cell)
+{
+    *cell = -1;
+    if (kind == CMD_HINT)
+    {
+        return MOVE_HINT;
+    }
+    if (kind == CMD_UNDO || kind == CMD_REDO)
+    {
+        if (journal != NULL)
+        {
+            *cell = (kind == CMD_UNDO) ? journalUndo(journal, board) : journalRedo(journal, board);
+        }
+        if (*cell < 0)
+        {
+            return (kind == CMD_UNDO) ? MOVE_ERR_NO_UNDO : MOVE_ERR_NO_REDO;
+        }
+        return (kind == CMD_UNDO) ? MOVE_UNDONE : MOVE_REDONE;
+    }
+    if (kind != CMD_MOVE)
+    {
+        return MOVE_ERR_FORMAT;
+    }
+
+    int size = board->size;
+    int inside = i >= 1 && i <= size && j >= 1 && j <= size;
+    int before = inside ? boardGet(board, i - 1, j - 1) : 0;
+    MoveResult result = applyMove(board, i, j, val);
+
+    if (result == MOVE_INSERTED || result == MOVE_CLEARED)
+    {
+        *cell = (i - 1) * size + (j - 1);
+        if (journal != NULL && before != val)
+        {
+            journalRecord(journal, *cell, before, val);
+        }
+    }
+    return result;
+}
+
+/**
+ * @brief Computes the candidates of every cell from the occupancy masks.
+ *
+ * @param cache The cache to initialise.
+ * @param board The Latin square.
+ * @return 0 on success, or -1 on allocation failure.
+ */
+int candidatesInit(CandidateCache *cache, const LatinBoard *board)
+{
+    int size = board->size;
+    cache->size = size;
+    cache->cand = malloc((size_t)size * size * sizeof(uint64_t));
+    if (cache->cand == NULL)
+    {
+        return -1;
+    }
+    for (int k = 0; k < size * size; k++)
+    {
+        cache->cand[k] = board->cells[k] ? 0 : boardCandidates(board, k / size, k % size);
+    }
+    return 0;
+}
+
+/**
+ * @brief Releases the storage of a candidate cache.
+ *
+ * @param cache The cache to release.
+ */
+void candidatesFree(CandidateCache *cache)
+{
+    free(cache->cand);
+    cache->cand = NULL;
+}
+
+/**
+ * @brief Refreshes the candidates after cell changed (insert, clear, undo or redo).
+ *
+ * Only the row and the column of the cell are touched.
+ *
+ * @param cache The cache to update.
+ * @param board The Latin square, already changed.
+ * @param cell Row-major index of the changed cell.
+ */
+void candidatesUpdate(CandidateCache *cache, const LatinBoard *board, int cell)
+{
+    int size = board->size;
+    int i = cell / size, j = cell % size;
+    uint64_t full = boardFullMask(board);
+    uint64_t row = board->rowMask[i];
+    uint64_t col = board->colMask[j];
+
+    for (int t = 0; t < size; t++)
+    {
+        int kr = i * size + t, kc = t * size + j;
+        cache->cand[kr] = board->cells[kr] ? 0 : ~(row | board->colMask[t]) & full;
+        cache->cand[kc] = board->cells[kc] ? 0 : ~(board->rowMask[t] | col) & full;
+    }
+}
+
+/**
+ * @brief Looks for a forced placement: a naked single, else a hidden single.
+ *
+ * Hidden singles are found per line with the once/twice mask trick, so
+ * each row and column costs O(n) mask operations.
+ *
+ * @param cache The up-to-date candidate cache.
+ * @param hint Receives the placement.
+ * @return 1 if a hint was found, 0 otherwise.
+ */
+int findHint(const CandidateCache *cache, Hint *hint)
+{
+    int size = cache->size;
+
+    for (int k = 0; k < size * size; k++)
+    {
+        uint64_t c = cache->cand[k];
+        if (c != 0 && (c & (c - 1)) == 0)
+        {
+            hint->cell = k;
+            hint->val = __builtin_ctzll(c) + 1;
+            hint->kind = HINT_NAKED_SINGLE;
+            return 1;
+        }
+    }
+
+    for (int line = 0; line < 2 * size; line++)
+    {
+        int isRow = line < size, t = isRow ? line : line - size;
+        uint64_t once = 0, twice = 0;
+        for (int u = 0; u < size; u++)
+        {
+            uint64_t c = cache->cand[isRow ? t * size + u : u * size + t];
+            twice |= once & c;
+            once |= c;
+        }
+        uint64_t single = once & ~twice;
+        if (single == 0)
+        {
+            continue;
+        }
+        uint64_t bit = single & (~single + 1);
+        for (int u = 0; u < size; u++)
+        {
+            int k = isRow ? t * size + u : u * size + t;
+            if (cache->cand[k] & bit)
+            {
+                hint->cell = k;
+                hint->val = __builtin_ctzll(bit) + 1;
+                hint->kind = isRow ? HINT_HIDDEN_SINGLE_ROW : HINT_HIDDEN_SINGLE_COL;
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Formats the answer to the ? command.
+ */
+static void formatHint(const CandidateCache *cache, char *msg, size_t msgSize)
+{
+    Hint hint;
+    if (!findHint(cache, &hint))
+    {
+        snprintf(msg, msgSize, "Hint: no naked or hidden single on this board\n\n");
+        return;
+    }
+
+    int i = hint.cell / cache->size + 1, j = hint.cell % cache->size + 1;
+    const char *why = (hint.kind == HINT_NAKED_SINGLE) ? "it is the only candidate of the cell"
+                    : (hint.kind == HINT_HIDDEN_SINGLE_ROW) ? "no other cell of the row can take it"
+                    : "no other cell of the column can take it";
+    snprintf(msg, msgSize, "Hint: %d,%d=%d (%s)\n\n", i, j, hint.val, why);
+}
+
+/**
+ * @brief Working state of ratePuzzle().
+ *
+ * The candidates are kept twice: per cell, and per value as the columns
+ * of each row (rowPos) and the rows of each column (colPos) that can
+ * still take it, so the line techniques read a line without gathering
+ * it. Unlike CandidateCache the candidates are only ever narrowed:
+ * eliminations made by the pair and X-wing techniques stay made. Every
+ * elimination that leaves a cell, or a value of a line, with a single
+ * place queues it, so the singles cost nothing when there are none.
+ */
+typedef struct
+{
+    int size;
+    int left;                               // empty cells
+    int broken;                             // a cell or a value of a line has no place left
+    int nakedCount, hiddenCount;
+    uint16_t naked[MAX_ORDER * MAX_ORDER];  // cells left with one candidate
+    uint16_t hidden[2 * MAX_ORDER * MAX_ORDER]; // v * 2 * size + line: values left with one place in a line
+    uint64_t rowDone[MAX_ORDER];            // values placed in each row
+    uint64_t colDone[MAX_ORDER];            // values placed in each column
+    uint8_t value[MAX_ORDER * MAX_ORDER];   // 0 = empty
+    uint64_t cand[MAX_ORDER * MAX_ORDER];   // candidates of each empty cell
+    uint64_t rowPos[MAX_ORDER * MAX_ORDER]; // [v * size + i]: columns of row i that can take v
+    uint64_t colPos[MAX_ORDER * MAX_ORDER]; // [v * size + j]: rows of column j that can take v
+} RateState;
+
+/** @brief Queues line (rows 0..n-1, then columns) of value v if v has one place left in it, or flags it if none. */
+static inline void rateCheckLine(RateState *rs, int v, int line, uint64_t pos, uint64_t done)
+{
+    if (pos == 0)
+    {
+        rs->broken |= !(done & (1ull << v));
+    }
+    else if ((pos & (pos - 1)) == 0)
+    {
+        rs->hidden[rs->hiddenCount++] = (uint16_t)(v * 2 * rs->size + line);
+    }
+}
+
+/** @brief Removes the values in mask from the candidates of cell k; returns non-zero if any were there. */
+static int rateEliminate(RateState *rs, int k, uint64_t mask)
+{
+    int n = rs->size, i = k / n, j = k % n;
+    uint64_t gone = rs->cand[k] & mask;
+    uint64_t left = rs->cand[k] &= ~mask;
+    for (uint64_t g = gone; g != 0; g &= g - 1)
+    {
+        int v = __builtin_ctzll(g);
+        rateCheckLine(rs, v, i, rs->rowPos[v * n + i] &= ~(1ull << j), rs->rowDone[i]);
+        rateCheckLine(rs, v, n + j, rs->colPos[v * n + j] &= ~(1ull << i), rs->colDone[j]);
+    }
+    if (gone != 0 && rs->value[k] == 0)
+    {
+        if (left == 0)
+        {
+            rs->broken = 1;
+        }
+        else if ((left & (left - 1)) == 0)
+        {
+            rs->naked[rs->nakedCount++] = (uint16_t)k;
+        }
+    }
+    return gone != 0;
+}
+
+/** @brief Places value v (0-based) in empty cell k and clears it from the row and column. */
+static void ratePlace(RateState *rs, int k, int v)
+{
+    int n = rs->size, i = k / n, j = k % n;
+    uint64_t bit = 1ull << v;
+    rs->value[k] = (uint8_t)(v + 1);
+    rs->rowDone[i] |= bit;
+    rs->colDone[j] |= bit;
+    rateEliminate(rs, k, ~0ull);
+    for (uint64_t cols = rs->rowPos[v * n + i]; cols != 0; cols &= cols - 1)
+    {
+        rateEliminate(rs, i * n + __builtin_ctzll(cols), bit);
+    }
+    for (uint64_t rows = rs->colPos[v * n + j]; rows != 0; rows &= rows - 1)
+    {
+        rateEliminate(rs, __builtin_ctzll(rows) * n + j, bit);
+    }
+    rs->left--;
+}
+
+/** @brief Fills the queued cells that have a single candidate, and the cells that fills leave with one. */
+static int rateNakedSingles(RateState *rs)
+{
+    int placed = 0;
+    while (rs->nakedCount > 0 && !rs->broken)
+    {
+        int k = rs->naked[--rs->nakedCount];
+        if (rs->value[k] == 0)
+        {
+            ratePlace(rs, k, __builtin_ctzll(rs->cand[k]));
+            placed++;
+        }
+    }
+    return placed;
+}
+
+/** @brief Places the queued values that have one cell left in a row or column. */
+static int rateHiddenSingles(RateState *rs)
+{
+    int n = rs->size, placed = 0;
+    while (rs->hiddenCount > 0 && !rs->broken)
+    {
+        int entry = rs->hidden[--rs->hiddenCount];
+        int v = entry / (2 * n), line = entry % (2 * n);
+        uint64_t pos = (line < n) ? rs->rowPos[v * n + line] : rs->colPos[v * n + line - n];
+        if (pos != 0)
+        {
+            int u = __builtin_ctzll(pos);
+            ratePlace(rs, (line < n) ? line * n + u : u * n + line - n, v);
+            placed++;
+        }
+    }
+    return placed;
+}
+
+/** @brief Cell u of line: rows 0..n-1, then columns. */
+static inline int rateCell(int n, int line, int u)
+{
+    return (line < n) ? line * n + u : u * n + (line - n);
+}
+
+/** @brief Removes the values of every naked pair from the rest of its line. */
+static int rateNakedPairs(RateState *rs)
+{
+    int n = rs->size, steps = 0;
+    int pairs[MAX_ORDER];
+    for (int line = 0; line < 2 * n; line++)
+    {
+        int count = 0;
+        for (int u = 0; u < n; u++)
+        {
+            if (__builtin_popcountll(rs->cand[rateCell(n, line, u)]) == 2)
+            {
+                pairs[count++] = u;
+            }
+        }
+        for (int a = 0; a < count; a++)
+        {
+            for (int b = a + 1; b < count; b++)
+            {
+                uint64_t pair = rs->cand[rateCell(n, line, pairs[a])];
+                if (rs->cand[rateCell(n, line, pairs[b])] != pair || __builtin_popcountll(pair) != 2)
+                {
+                    continue;
+                }
+                int removed = 0;
+                for (int t = 0; t < n; t++)
+                {
+                    if (t != pairs[a] && t != pairs[b])
+                    {
+                        removed |= rateEliminate(rs, rateCell(n, line, t), pair);
+                    }
+                }
+                steps += removed;
+            }
+        }
+    }
+    return steps;
+}
+
+/** @brief Removes the other candidates from the two cells of every hidden pair. */
+static int rateHiddenPairs(RateState *rs)
+{
+    int n = rs->size, steps = 0;
+    int pairs[MAX_ORDER];
+    for (int line = 0; line < 2 * n; line++)
+    {
+        const uint64_t *pos = (line < n) ? rs->rowPos + line : rs->colPos + (line - n);  // pos[v * n]
+        int count = 0;
+        for (int v = 0; v < n; v++)
+        {
+            if (__builtin_popcountll(pos[v * n]) == 2)
+            {
+                pairs[count++] = v;
+            }
+        }
+        for (int a = 0; a < count; a++)
+        {
+            for (int b = a + 1; b < count; b++)
+            {
+                uint64_t cells = pos[pairs[a] * n];
+                if (pos[pairs[b] * n] != cells || __builtin_popcountll(cells) != 2)
+                {
+                    continue;
+                }
+                uint64_t keep = (1ull << pairs[a]) | (1ull << pairs[b]);
+                int removed = 0;
+                for (; cells != 0; cells &= cells - 1)
+                {
+                    removed |= rateEliminate(rs, rateCell(n, line, __builtin_ctzll(cells)), ~keep);
+                }
+                steps += removed;
+            }
+        }
+    }
+    return steps;
+}
+
+/** @brief Removes a value from the crossing lines of every X-wing on it. */
+static int rateXWings(RateState *rs)
+{
+    int n = rs->size, steps = 0;
+    int pairs[MAX_ORDER];
+    for (int v = 0; v < n; v++)
+    {
+        uint64_t bit = 1ull << v;
+        for (int dir = 0; dir < 2; dir++)
+        {
+            // dir 0: pos[i] holds the columns of row i, dir 1: pos[j] the rows of column j
+            const uint64_t *pos = (dir == 0 ? rs->rowPos : rs->colPos) + v * n;
+            int count = 0;
+            for (int a = 0; a < n; a++)
+            {
+                if (__builtin_popcountll(pos[a]) == 2)
+                {
+                    pairs[count++] = a;
+                }
+            }
+            for (int a = 0; a < count; a++)
+            {
+                for (int b = a + 1; b < count; b++)
+                {
+                    uint64_t cross = pos[pairs[a]];
+                    if (pos[pairs[b]] != cross || __builtin_popcountll(cross) != 2)
+                    {
+                        continue;
+                    }
+                    uint64_t keep = (1ull << pairs[a]) | (1ull << pairs[b]);
+                    int removed = 0;
+                    for (; cross != 0; cross &= cross - 1)
+                    {
+                        int c = __builtin_ctzll(cross);
+                        // the lines crossing the wing, other than the wing's own two
+                        for (uint64_t other = (dir == 0 ? rs->colPos : rs->rowPos)[v * n + c] & ~keep; other != 0;
+                             other &= other - 1)
+                        {
+                            int o = __builtin_ctzll(other);
+                            removed |= rateEliminate(rs, dir == 0 ? o * n + c : c * n + o, bit);
+                        }
+                    }
+                    steps += removed;
+                }
+            }
+        }
+    }
+    return steps;
+}
+
+/** @brief The techniques in the order they are tried, and the score of one step of each. */
+static int (*const rateTechniques[TECH_COUNT])(RateState *rs) = {
+    rateNakedSingles, rateHiddenSingles, rateNakedPairs, rateHiddenPairs, rateXWings
+};
+static const unsigned techniqueWeights[TECH_COUNT] = {1, 2, 6, 8, 12};
+
+/**
+ * @brief Rates how hard a puzzle is for a player working by deduction.
+ *
+ * Starting from the candidates of the puzzle, the simplest technique
+ * that makes progress is applied, then the ladder starts over; the
+ * level is set by the hardest technique needed. No search is run, so
+ * a puzzle the techniques cannot finish is rated RATING_SEARCH.
+ *
+ * @param board The puzzle; it must not have clashing values.
+ * @param rating Receives the rating.
+ */
+void ratePuzzle(const LatinBoard *board, PuzzleRating *rating)
+{
+    RateState rs;
+    int n = board->size;
+    int hardest = -1;
+
+    memset(rating, 0, sizeof(*rating));
+    rs.size = n;
+    rs.left = 0;
+    rs.broken = 0;
+    rs.nakedCount = rs.hiddenCount = 0;
+    memcpy(rs.rowDone, board->rowMask, (size_t)n * sizeof(uint64_t));
+    memcpy(rs.colDone, board->colMask, (size_t)n * sizeof(uint64_t));
+    memset(rs.rowPos, 0, (size_t)n * n * sizeof(uint64_t));
+    memset(rs.colPos, 0, (size_t)n * n * sizeof(uint64_t));
+    for (int k = 0; k < n * n; k++)
+    {
+        int i = k / n, j = k % n;
+        rs.value[k] = board->cells[k];
+        rs.cand[k] = board->cells[k] ? 0 : boardCandidates(board, i, j);
+        rs.left += board->cells[k] == 0;
+        for (uint64_t c = rs.cand[k]; c != 0; c &= c - 1)
+        {
+            int v = __builtin_ctzll(c);
+            rs.rowPos[v * n + i] |= 1ull << j;
+            rs.colPos[v * n + j] |= 1ull << i;
+        }
+        uint64_t c = rs.cand[k];
+        if (rs.value[k] == 0 && (c & (c - 1)) == 0)
+        {
+            rs.broken |= (c == 0);
+            rs.naked[rs.nakedCount++] = (uint16_t)k;
+        }
+    }
+    for (int v = 0; v < n; v++)
+    {
+        for (int line = 0; line < n; line++)
+        {
+            rateCheckLine(&rs, v, line, rs.rowPos[v * n + line], rs.rowDone[line]);
+            rateCheckLine(&rs, v, n + line, rs.colPos[v * n + line], rs.colDone[line]);
+        }
+    }
+
+    int stuck = 0;
+    while (rs.left > 0 && !stuck && !rs.broken)
+    {
+        stuck = 1;
+        for (int t = 0; t < TECH_COUNT && !rs.broken; t++)
+        {
+            int steps = rateTechniques[t](&rs);
+            if (steps > 0)
+            {
+                rating->uses[t] += (unsigned)steps;
+                rating->score += (unsigned)steps * techniqueWeights[t];
+                hardest = (t > hardest) ? t : hardest;
+                stuck = 0;
+                break;
+            }
+        }
+    }
+
+    rating->left = rs.left;
+    rating->level = rs.broken ? RATING_INVALID
+                  : stuck ? RATING_SEARCH
+                  : hardest >= TECH_X_WING ? RATING_EXPERT
+                  : hardest >= TECH_NAKED_PAIR ? RATING_HARD
+                  : hardest >= TECH_HIDDEN_SINGLE ? RATING_MEDIUM : RATING_EASY;
+}
+
+/**
+ * @brief Handles the gameplay mechanics for the Latin square game.
+ * 
+ * This function manages user input and updates the Latin square 
+ * based on the commands received. It validates input, checks for 
+ * win conditions, and controls the game flow including saving the game.
+ * 
+ * @see displayLatinSquare(const LatinBoard *board)
+ * @see displayInstructionDialogue()
+ * @see writeLatinSquare(const LatinBoard *board, char *fileNameOut)
+ * 
+ * @param board The Latin square to be modified.
+ * @param journal The undo/redo journal of the game, or NULL.
+ * @param autosave The background writer saving after every change, or NULL.
+ * @param isDispNeeded A flag indicating whether to display the square 
+ *                     and instructions before taking input.
+ * @param incremental A flag selecting the ANSI terminal view, which
+ *                    redraws only the changed cell after each move.
+ * @param outFileName The name of the file to save the game state.
+ */
+void play(LatinBoard *board, MoveJournal *journal, Autosave *autosave, int isDispNeeded, int incremental, char *outFileName)
+{
+    int size = board->size;
+    int changed = -1;   // cell changed by the last move, for the incremental view
+    TermView view;
+    termViewInit(&view, board, incremental);
+    CommandReader reader;
+    commandReaderInit(&reader, STDIN_FILENO);
+
+    // candidates are cached for the ? command and refreshed after every change
+    CandidateCache cache;
+    int haveCache = (candidatesInit(&cache, board) == 0);
+
+    // Each command sets isDispNeeded for the next iteration instead of
+    // recursing, so sessions of any length run in constant stack space.
+    for (;;)
+    {
+        STAT_TIMER_START(renderStart);
+        if (isDispNeeded == 1 && view.active)
+        {
+            if (view.drawn && changed >= 0)
+            {
+                termViewDrawCell(&view, board, changed);
+            }
+            else if (!view.drawn)
+            {
+                termViewDrawAll(&view, board);
+            }
+        }
+        else if (isDispNeeded == 1)
+        {
+            displayLatinSquare(board);
+            displayInstructionDialogue();
+        }
+        if (view.active)
+        {
+            termViewFlush(&view);
+        }
+        STAT_TIMER_STOP(STAT_TIME_RENDER, renderStart);
+        changed = -1;
+
+        int i = 0, j = 0, val = 0;
+        STAT_TIMER_START(parseStart);
+        CommandStatus kind = commandRead(&reader, &i, &j, &val);
+        if (kind == CMD_END)
+        {
+            break; // input stream closed, nothing more to read
+        }
+        STAT_TIMER_STOP(STAT_TIME_PARSE, parseStart);
+
+        STAT_TIMER_START(validateStart);
+        MoveResult result = playCommand(board, journal, kind, i, j, val, &changed);
+        STAT_TIMER_STOP(STAT_TIME_VALIDATE, validateStart);
+        STAT_MOVE(result);
+        if (result == MOVE_SAVE)
+        {
+            if (view.active)
+            {
+                termViewFlush(&view);
+            }
+            if (autosave != NULL)
+            {
+                autosaveFlush(autosave);
+            }
+            writeLatinSquare(board,outFileName);
+            if (journal != NULL)
+            {
+                char journalName[4096];
+                snprintf(journalName, sizeof(journalName), "%s.journal", outFileName);
+                journalSave(journal, board, journalName);
+            }
+            break;
+        }
+
+        if (changed >= 0 && haveCache)
+        {
+            candidatesUpdate(&cache, board, changed);
+        }
+
+        STAT_TIMER_START(reportStart);
+        if (result == MOVE_HINT)
+        {
+            char msg[160] = "Hint: not available\n\n";
+            if (haveCache)
+            {
+                formatHint(&cache, msg, sizeof(msg));
+            }
+            playReport(&view, msg);
+        }
+        else if (result == MOVE_ERR_RANGE)
+        {
+            char msg[96];
+            snprintf(msg, sizeof(msg), moveMessages[MOVE_ERR_RANGE], size);
+            playReport(&view, msg);
+        }
+        else
+        {
+            playReport(&view, moveMessages[result]);
+        }
+        STAT_TIMER_STOP(STAT_TIME_RENDER, reportStart);
+
+        // only successful moves redraw the board
+        if (result != MOVE_INSERTED && result != MOVE_CLEARED && result != MOVE_UNDONE && result != MOVE_REDONE)
+        {
+            isDispNeeded = 0;
+            continue;
+        }
+
+        //check whether we have winning conditions: 1 => WON  , 0 => NOT WON YET
+        int isGameWon = (board->filled == size * size);
+
+        // game not won => loop back to the top and wait for new input.
+        if (isGameWon==0){
+            if (autosave != NULL)
+            {
+                autosaveQueue(autosave, board, journal);
+            }
+            isDispNeeded = 1;
+            continue;
+        }
+
+        // gama is won because isGameWon = 1 !!! Ending the game and calling writeLatinsquare function to save the game
+        if (view.active)
+        {
+            // the winning latin square is already on screen, only finish the frame
+            termViewDrawCell(&view, board, changed);
+            termViewStatus(&view, "Game completed!!!");
+            termViewFlush(&view);
+        }
+        else
+        {
+            printf("Game completed!!!\n");
+            displayLatinSquare(board);   //display winning latin square
+        }
+        if (autosave != NULL)
+        {
+            autosaveFlush(autosave);
+        }
+        writeLatinSquare(board,outFileName);
+        if (journal != NULL)
+        {
+            char journalName[4096];
+            snprintf(journalName, sizeof(journalName), "%s.journal", outFileName);
+            journalSave(journal, board, journalName);
+        }
+        break;
+    }
+
+    if (haveCache)
+    {
+        candidatesFree(&cache);
+    }
+}
+
+/**
+ * @brief Recognises the keyword commands ("u", "undo", "r", "redo", "?").
+ *
+ * @param text The command text, surrounding whitespace allowed.
+ * @param len Length of text.
+ * @return CMD_UNDO, CMD_REDO, CMD_HINT, or CMD_BAD for anything else.
+ */
+CommandStatus commandKeyword(const char *text, size_t len)
+{
+    while (len > 0 && (*text == ' ' || *text == '\t'))
+    {
+        text++;
+        len--;
+    }
+    while (len > 0 && (text[len - 1] == ' ' || text[len - 1] == '\t' || text[len - 1] == '\r'))
+    {
+        len--;
+    }
+
+    if ((len == 1 && text[0] == 'u') || (len == 4 && memcmp(text, "undo", 4) == 0))
+    {
+        return CMD_UNDO;
+    }
+    if ((len == 1 && text[0] == 'r') || (len == 4 && memcmp(text, "redo", 4) == 0))
+    {
+        return CMD_REDO;
+    }
+    if (len == 1 && text[0] == '?')
+    {
+        return CMD_HINT;
+    }
+    return CMD_BAD;
+}
+
+/**
+ * @brief Parses one command with the rules of scanf("%d,%d=%d").
+ *
+ * Whitespace (newlines included) is skipped before each number but not
+ * before the ',' and '=' separators. On a malformed command the rest of
+ * the line is discarded, unless it is a keyword command. Numbers too
+ * large for an int saturate instead of overflowing.
+ *
+ * @param pos Parse position, advanced past the command or the discarded line.
+ * @param end End of the available input.
+ * @param atEof Non-zero if no more input will follow end.
+ * @param i Receives the row.
+ * @param j Receives the column.
+ * @param val Receives the value.
+ * @return What was found; on CMD_NEED_MORE pos only moves past leading whitespace.
+ */
+CommandStatus parseCommand(const char **pos, const char *end, int atEof, int *i, int *j, int *val)
+{
+    const char *p = *pos;
+    int *fields[3] = {i, j, val};
+    const char separators[2] = {',', '='};
+    int f;
+
+    for (f = 0; f < 3; f++)
+    {
+        while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r' || *p == '\v' || *p == '\f'))
+        {
+            p++;
+        }
+        if (f == 0)
+        {
+            // leading blanks are consumed even when more input is needed, so they never fill a buffer
+            *pos = p;
+            if (p == end)
+            {
+                return atEof ? CMD_END : CMD_NEED_MORE;
+            }
+        }
+
+        const char *start = p;
+        if (p < end && (*p == '-' || *p == '+'))
+        {
+            p++;
+        }
+        long v = 0;
+        const char *digits = p;
+        while (p < end && (unsigned)(*p - '0') < 10)
+        {
+            v = (v < 100000000L) ? v * 10 + (*p - '0') : v; // saturate, range check rejects it anyway
+            p++;
+        }
+        if (p == end && !atEof)
+        {
+            return CMD_NEED_MORE;
+        }
+        if (p == digits)
+        {
+            p = start;
+            break;
+        }
+        *fields[f] = (int)((*start == '-') ? -v : v);
+
+        if (f == 2)
+        {
+            *pos = p;
+            return CMD_MOVE;
+        }
+        if (p == end || *p != separators[f])
+        {
+            f++; // count the number read, as scanf() does: only a line without one can be a keyword
+            break;
+        }
+        p++;
+    }
+
+    // discard the remainder of the line
+    const char *rest = p;
+    while (p < end && *p != '\n')
+    {
+        p++;
+    }
+    if (p == end && !atEof)
+    {
+        return CMD_NEED_MORE;
+    }
+    *pos = (p < end) ? p + 1 : p;
+    return (f == 0) ? commandKeyword(rest, (size_t)(p - rest)) : CMD_BAD;
+}
+
+/**
+ * @brief Skips input up to and including the next newline.
+ *
+ * Used to drop a command too long for the caller's buffer: it is skipped
+ * like a malformed line, as parseCommand() would with the whole line.
+ *
+ * @param pos Position, advanced past the newline or to end.
+ * @param end End of the available input.
+ * @return 1 if the newline was found, 0 if the line goes on past end.
+ */
+int commandSkipLine(const char **pos, const char *end)
+{
+    const char *newline = memchr(*pos, '\n', (size_t)(end - *pos));
+    *pos = (newline != NULL) ? newline + 1 : end;
+    return newline != NULL;
+}
+
+/**
+ * @brief Starts reading commands from a descriptor.
+ *
+ * @param reader The reader to initialise.
+ * @param fd The descriptor, STDIN_FILENO for a game.
+ */
+void commandReaderInit(CommandReader *reader, int fd)
+{
+    reader->fd = fd;
+    reader->start = 0;
+    reader->have = 0;
+    reader->atEof = 0;
+    reader->discarding = 0;
+}
+
+/**
+ * @brief Returns the next command, reading more input only when needed.
+ *
+ * Pending output is flushed before blocking, as stdio does before it
+ * reads a terminal, so the prompt is on screen while the player types.
+ *
+ * @param reader The reader.
+ * @param i Receives the row of a move.
+ * @param j Receives the column of a move.
+ * @param val Receives the value of a move.
+ * @return What was read; CMD_END once the input is closed. Never CMD_NEED_MORE.
+ */
+CommandStatus commandRead(CommandReader *reader, int *i, int *j, int *val)
+{
+    for (;;)
+    {
+        const char *pos = reader->buf + reader->start, *end = reader->buf + reader->have;
+        if (reader->discarding)
+        {
+            int found = commandSkipLine(&pos, end);
+            reader->start = (size_t)(pos - reader->buf);
+            if (found || reader->atEof)
+            {
+                reader->discarding = 0;
+                return CMD_BAD;
+            }
+        }
+        else
+        {
+            CommandStatus status = parseCommand(&pos, end, reader->atEof, i, j, val);
+            reader->start = (size_t)(pos - reader->buf);
+            if (status != CMD_NEED_MORE)
+            {
+                return status;
+            }
+        }
+
+        // keep the partial command and read more after it
+        reader->have -= reader->start;
+        memmove(reader->buf, reader->buf + reader->start, reader->have);
+        reader->start = 0;
+        if (reader->have == sizeof(reader->buf))
+        {
+            // one command filling the whole buffer can only be garbage: drop it up to its newline
+            reader->have = 0;
+            reader->discarding = 1;
+            continue;
+        }
+
+        fflush(stdout);
+        ssize_t got = read(reader->fd, reader->buf + reader->have, sizeof(reader->buf) - reader->have);
+        if (got > 0)
+        {
+            reader->have += (size_t)got;
+        }
+        else if (got == 0 || errno != EINTR)
+        {
+            reader->atEof = 1;
+        }
+    }
+}
+
+/**
+ * @brief Runs --script mode: replays a command stream without any echo.
+ *
+ * Commands are read from standard input in SCRIPT_CHUNK_SIZE chunks and
+ * applied in a tight loop with the same rules as play(). Nothing is
+ * printed per move; a summary of the outcome and of every rejection
+ * reason is printed at the end. The game is saved, as in play(), on
+ * 0,0=0 or when the square is completed.
+ *
+ * @param board The Latin square to be played.
+ * @param outFileName The name of the file to save the game state.
+ * @return Exit status code: 0 on success, 1 if the save failed.
+ */
+int runScript(LatinBoard *board, MoveJournal *journal, const char *outFileName)
+{
+    static char buf[SCRIPT_CHUNK_SIZE];
+    unsigned long long counts[MOVE_RESULT_COUNT] = {0};
+    unsigned long long commands = 0;
+    size_t have = 0;
+    int atEof = 0, finished = 0, saved = 0, discarding = 0;
+    const char *outcome = "input ended";
+    double start = monotonicMs();
+
+    while (!finished)
+    {
+        if (!atEof)
+        {
+            ssize_t got = read(STDIN_FILENO, buf + have, sizeof(buf) - have);
+            if (got <= 0)
+            {
+                atEof = 1;
+            }
+            else
+            {
+                have += (size_t)got;
+            }
+        }
+
+        const char *pos = buf, *end = buf + have;
+        for (;;)
+        {
+            int i = 0, j = 0, val = 0, cell;
+            CommandStatus status;
+            if (discarding)
+            {
+                if (!commandSkipLine(&pos, end) && !atEof)
+                {
+                    break;
+                }
+                discarding = 0;
+                status = CMD_BAD;
+            }
+            else
+            {
+                STAT_TIMER_START(parseStart);
+                status = parseCommand(&pos, end, atEof, &i, &j, &val);
+                STAT_TIMER_STOP(STAT_TIME_PARSE, parseStart);
+            }
+            if (status == CMD_END)
+            {
+                finished = 1;
+                break;
+            }
+            if (status == CMD_NEED_MORE)
+            {
+                if (pos == buf && have == sizeof(buf))
+                {
+                    // one command filling the whole chunk can only be garbage: drop it up to its newline
+                    discarding = 1;
+                    continue;
+                }
+                break;
+            }
+
+            commands++;
+            STAT_TIMER_START(validateStart);
+            MoveResult result = playCommand(board, journal, status, i, j, val, &cell);
+            STAT_TIMER_STOP(STAT_TIME_VALIDATE, validateStart);
+            STAT_MOVE(result);
+            counts[result]++;
+
+            if (result == MOVE_SAVE)
+            {
+                outcome = "saved";
+                saved = finished = 1;
+                break;
+            }
+            // undo and redo can complete the square too, as in play()
+            if ((result == MOVE_INSERTED || result == MOVE_CLEARED || result == MOVE_UNDONE || result == MOVE_REDONE) &&
+                board->filled == board->size * board->size)
+            {
+                outcome = "completed";
+                saved = finished = 1;
+                break;
+            }
+        }
+
+        // keep the unparsed tail for the next chunk
+        have = (size_t)(end - pos);
+        memmove(buf, pos, have);
+        if (atEof && !finished && have == 0)
+        {
+            finished = 1;
+        }
+    }
+
+    int status = 0;
+    STAT_TIMER_START(writeStart);
+    if (saved && saveLatinSquare(board, outFileName) != 0)
+    {
+        status = 1;
+    }
+    STAT_TIMER_STOP(STAT_TIME_WRITE, writeStart);
+    if (saved && journal != NULL)
+    {
+        char journalName[4096];
+        snprintf(journalName, sizeof(journalName), "%s.journal", outFileName);
+        journalSave(journal, board, journalName);
+    }
+    double elapsed = monotonicMs() - start;
+    unsigned long long rejected = counts[MOVE_ERR_FORMAT] + counts[MOVE_ERR_RANGE] + counts[MOVE_ERR_OCCUPIED] +
+                                  counts[MOVE_ERR_GIVEN] + counts[MOVE_ERR_RULE];
+
+    printf("Commands: %llu (%llu inserted, %llu cleared, %llu rejected)\n",
+           commands, counts[MOVE_INSERTED], counts[MOVE_CLEARED], rejected);
+    printf("Rejected: %llu format, %llu range, %llu occupied, %llu given, %llu rule\n",
+           counts[MOVE_ERR_FORMAT], counts[MOVE_ERR_RANGE], counts[MOVE_ERR_OCCUPIED],
+           counts[MOVE_ERR_GIVEN], counts[MOVE_ERR_RULE]);
+    printf("Journal: %llu undone, %llu redone, %llu refused\n", counts[MOVE_UNDONE], counts[MOVE_REDONE],
+           counts[MOVE_ERR_NO_UNDO] + counts[MOVE_ERR_NO_REDO]);
+    printf("Outcome: %s, %d of %d cells filled", outcome, board->filled, board->size * board->size);
+    if (saved)
+    {
+        printf(", %s %s", status == 0 ? "saved to" : "unable to save", outFileName);
+    }
+    printf("\nTime: %.3f ms\n", elapsed);
+    return status;
+}
+
+/**
+ * @brief Reads a Latin square from a specified file.
+ *
+ * This function attempts to read a Latin square from the given file
+ * and initialises the provided board with it. It checks for file
+ * accessibility and validates the input format, reporting the line
+ * and column of the first problem. Negative values are stored as
+ * given cells.
+ *
+ * @see loadLatinSquare(const char *filename, LatinBoard *board, char *err, size_t errSize)
+ *
+ * @param filename The name of the file to read the Latin square from.
+ * @param board The board to initialise with the Latin square data.
+ * @return The size of the Latin square if successful, or -1 on error.
+ */
+int readLatinSquare(const char *filename, LatinBoard *board)
+{
+    char err[256];
+    STAT_TIMER_START(readStart);
+    int n = loadLatinSquare(filename, board, err, sizeof(err));
+    STAT_TIMER_STOP(STAT_TIME_READ, readStart);
+    if (n == -1)
+    {
+        printf("Error: %s\n", err);
+    }
+    return n;
+}
+
+/**
+ * @brief Reads the next whitespace separated signed integer.
+ *
+ * @param cur The parse position, advanced past the token.
+ * @param value Receives the integer.
+ * @param line Receives the 1-based line of the token.
+ * @param col Receives the 1-based column of the token.
+ * @return 1 on success, 0 at end of input, -1 if the token is not an
+ *         integer or does not fit in 7 digits.
+ */
+static int parseNextInt(ParseCursor *cur, int *value, int *line, int *col)
+{
+    const char *p = cur->pos, *end = cur->end;
+
+    for (; p < end; p++)
+    {
+        if (*p == '\n')
+        {
+            cur->line++;
+            cur->lineStart = p + 1;
+        }
+        else if (*p != ' ' && *p != '\t' && *p != '\r' && *p != '\v' && *p != '\f')
+        {
+            break;
+        }
+    }
+    *line = cur->line;
+    *col = (int)(p - cur->lineStart) + 1;
+    if (p == end)
+    {
+        cur->pos = p;
+        return 0;
+    }
+
+    int negative = 0;
+    if (*p == '-' || *p == '+')
+    {
+        negative = (*p == '-');
+        p++;
+    }
+
+    const char *digits = p;
+    int v = 0;
+    while (p < end && (unsigned)(*p - '0') < 10 && p - digits < 7)
+    {
+        v = v * 10 + (*p - '0');
+        p++;
+    }
+    cur->pos = p;
+
+    // the token must be all digits and end at whitespace or end of input
+    if (p == digits || (p < end && *p != ' ' && *p != '\t' && *p != '\n' &&
+                        *p != '\r' && *p != '\v' && *p != '\f'))
+    {
+        return -1;
+    }
+    *value = negative ? -v : v;
+    return 1;
+}
+
+/**
+ * @brief Parses one Latin square record (size, then size*size cells).
+ *
+ * Parsing stops right after the last cell, so records can be read back
+ * to back from one buffer.
+ *
+ * @param cur The parse position, advanced past the record.
+ * @param board The board to initialise with the Latin square data.
+ * @param err Receives a message with the line and column of the first problem.
+ * @param errSize Size of err.
+ * @return The size of the Latin square if successful, 0 if the input
+ *         held nothing but whitespace, or -1 on error.
+ */
+int parseLatinSquare(ParseCursor *cur, LatinBoard *board, char *err, size_t errSize)
+{
+    int n, line, col;
+    int status = parseNextInt(cur, &n, &line, &col);
+
+    if (status == 0)
+    {
+        snprintf(err, errSize, "line %d, column %d: empty input", line, col);
+        return 0;
+    }
+
+    //check latin square size legitimacy
+    if (status < 0 || n <= 0 || n > MAX_ORDER)
+    {
+        snprintf(err, errSize, "line %d, column %d: invalid size of latin square (maximum size is %d)",
+                 line, col, MAX_ORDER);
+        return -1;
+    }
+
+    // allocate a zeroed board of the requested order
+    if (boardInit(board, n) != 0)
+    {
+        snprintf(err, errSize, "unable to allocate a latin square of size %d", n);
+        return -1;
+    }
+
+    // Read,check and transfer the cells to the board
+    for (int k = 0; k < n * n; k++)
+    {
+        int v;
+        status = parseNextInt(cur, &v, &line, &col);
+        if (status <= 0 || v < -n || v > n)
+        {
+            snprintf(err, errSize, "line %d, column %d: invalid input detected in the Latin square data (%s)",
+                     line, col, status == 0 ? "unexpected end of file"
+                                : status < 0 ? "expected an integer" : "value outside [-n..n]");
+            boardFree(board);
+            return -1;
+        }
+        board->cells[k] = (uint8_t)abs(v);
+        if (v < 0)
+        {
+            board->given[k >> 6] |= 1ull << (k & 63);
+        }
+    }
+
+    boardRebuildMasks(board);
+    return n;
+}
+
+/**
+ * @brief Loads a Latin square file without printing anything.
+ *
+ * The whole file is read with a single read() (or mapped when it is
+ * large) and parsed in one pass, instead of one fscanf() per cell.
+ *
+ * @param filename The name of the file to read the Latin square from.
+ * @param board The board to initialise with the Latin square data.
+ * @param err Receives the error message on failure.
+ * @param errSize Size of err.
+ * @return The size of the Latin square if successful, or -1 on error.
+ */
+int loadLatinSquare(const char *filename, LatinBoard *board, char *err, size_t errSize)
+{
+    char small[LOAD_READ_LIMIT];
+    struct stat st;
+    const char *data = small;
+    size_t len = 0;
+    int mapped = 0;
+
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0 || fstat(fd, &st) != 0)  //check the file can be read and return error code -1
+    {
+        snprintf(err, errSize, "Unable to access file %s", filename);
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+        return -1;
+    }
+
+    if (S_ISREG(st.st_mode) && st.st_size > LOAD_READ_LIMIT)
+    {
+        void *map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map == MAP_FAILED)
+        {
+            snprintf(err, errSize, "Unable to access file %s", filename);
+            close(fd);
+            return -1;
+        }
+        data = map;
+        len = (size_t)st.st_size;
+        mapped = 1;
+    }
+    else
+    {
+        // small files and pipes: a puzzle of any supported order fits in the buffer
+        ssize_t got;
+        while (len < sizeof(small) && (got = read(fd, small + len, sizeof(small) - len)) > 0)
+        {
+            len += (size_t)got;
+        }
+    }
+    close(fd);
+
+    ParseCursor cur = {data, data + len, 1, data};
+    int n = parseLatinSquare(&cur, board, err, errSize);
+    if (n == 0)
+    {
+        n = -1; // an empty file is an error here, err already says where it ended
+    }
+
+    if (mapped)
+    {
+        munmap((void *)data, len);
+    }
+    return n;
+}
+
+/**
+ * @brief Formats the text of cell (i,j) as shown inside the grid.
+ *
+ * @param board The board, of the representation access reads.
+ * @param size The order of the board.
+ * @param access The accessors of the board.
+ * @param i Row, 0-based.
+ * @param j Column, 0-based.
+ * @param out Receives 5 characters (6 for orders above 9), not terminated.
+ * @return The number of characters written.
+ */
+static inline __attribute__((always_inline)) int formatCellBody(const void *board, int size,
+                                                                const BoardAccess *access, int i, int j, char *out)
+{
+    int v = access->get(board, i, j);
+    int wide = size > 9;
+    char text[16];
+
+    if (access->isGiven(board, i, j))
+    {
+        // given numbers go inside parentheses
+        snprintf(text, sizeof(text), wide ? " (%2d) " : " (%d) ", v);
+    }
+    else
+    {
+        // zeros and player numbers as they are
+        snprintf(text, sizeof(text), wide ? "  %2d  " : "  %d  ", v);
+    }
+    int len = wide ? 6 : 5;
+    memcpy(out, text, (size_t)len);
+    return len;
+}
+
+/** @brief formatCellBody() for a LatinBoard, as redrawn by the incremental view. */
+static int formatCellText(const LatinBoard *board, int i, int j, char *out)
+{
+    return formatCellBody(board, board->size, &latinAccess, i, j, out);
+}
+
+/** @brief The ASCII grid of formatGrid() over any board representation. */
+static inline __attribute__((always_inline)) size_t formatGridBody(const void *board, int size,
+                                                                   const BoardAccess *access, char *out)
+{
+    const char *border = (size > 9) ? "+------" : "+-----";
+    size_t borderLen = strlen(border);
+    char *p = out;
+
+    for (int i = 0; i <= size; i++)
+    {
+        // the top border of the row (or the bottom border of the last row)
+        for (int j = 0; j < size; j++)
+        {
+            memcpy(p, border, borderLen);
+            p += borderLen;
+        }
+        *p++ = '+';
+        *p++ = '\n';
+        if (i == size)
+        {
+            break;
+        }
+
+        // the contents of the row
+        for (int j = 0; j < size; j++)
+        {
+            *p++ = '|';
+            p += formatCellBody(board, size, access, i, j, p);
+        }
+        *p++ = '|';
+        *p++ = '\n';
+    }
+    return (size_t)(p - out);
+}
+
+/**
+ * @brief Formats the whole ASCII grid of the Latin square.
+ *
+ * @param board The Latin square to be formatted.
+ * @param out Buffer of at least GRID_BUFFER_SIZE bytes.
+ * @return The number of bytes written.
+ */
+size_t formatGrid(const LatinBoard *board, char *out)
+{
+    return formatGridBody(board, board->size, &latinAccess, out);
+}
+
+/**
+ * @brief Formats the ASCII grid of a compact board, like formatGrid().
+ *
+ * @param cb The compact board to be formatted.
+ * @param out Buffer of at least GRID_BUFFER_SIZE bytes.
+ * @return The number of bytes written.
+ */
+size_t formatCompactGrid(const CompactBoard *cb, char *out)
+{
+    return formatGridBody(cb, cb->size, &compactAccess, out);
+}
+
+/**
+ * @brief Displays the current state of the Latin square in a formatted manner.
+ *
+ * This function prints the Latin square to the console, showing
+ * the values in a grid format. Given values are displayed
+ * within parentheses. Orders above 9 use wider cells to fit two digits.
+ * The grid is formatted into one buffer and written at once.
+ *
+ * @param board The Latin square to be displayed.
+ */
+void displayLatinSquare(const LatinBoard *board)
+{
+    char buf[GRID_BUFFER_SIZE];
+    fwrite(buf, 1, formatGrid(board, buf), stdout);
+}
+
+/**
+ * @brief Sets up the incremental terminal view of a game.
+ *
+ * @param view The view to initialise.
+ * @param board The Latin square being played.
+ * @param enabled Whether to use ANSI cursor addressing at all.
+ */
+void termViewInit(TermView *view, const LatinBoard *board, int enabled)
+{
+    view->active = enabled;
+    view->drawn = 0;
+    view->len = 0;
+    view->cellWidth = (board->size > 9) ? 7 : 6;
+
+    // the grid takes 2n + 1 rows, then the instructions, one spacer line and the status line
+    int instructionLines = 0;
+    for (const char *c = instructionText; *c != '\0'; c++)
+    {
+        instructionLines += (*c == '\n');
+    }
+    view->statusRow = 2 * board->size + 1 + instructionLines + 2;
+    view->promptRow = view->statusRow + 1;
+}
+
+/** @brief Appends formatted text to the frame being built. */
+static void termViewAppend(TermView *view, const char *fmt, ...)
+{
+    va_list args;
+    va_start(args, fmt);
+    int n = vsnprintf(view->frame + view->len, sizeof(view->frame) - view->len, fmt, args);
+    va_end(args);
+    if (n > 0)
+    {
+        view->len += ((size_t)n < sizeof(view->frame) - view->len) ? (size_t)n : sizeof(view->frame) - view->len - 1;
+    }
+}
+
+/**
+ * @brief Queues a full redraw: clear screen, grid and instructions.
+ */
+void termViewDrawAll(TermView *view, const LatinBoard *board)
+{
+    termViewAppend(view, "\033[H\033[2J");
+    view->len += formatGrid(board, view->frame + view->len);
+    termViewAppend(view, "%s", instructionText);
+    view->drawn = 1;
+}
+
+/**
+ * @brief Queues a redraw of cell k only.
+ */
+void termViewDrawCell(TermView *view, const LatinBoard *board, int k)
+{
+    int i = k / board->size, j = k % board->size;
+    termViewAppend(view, "\033[%d;%dH", 2 * i + 2, j * view->cellWidth + 2);
+    view->len += (size_t)formatCellText(board, i, j, view->frame + view->len);
+}
+
+/**
+ * @brief Queues a message on the status line, replacing the previous one.
+ */
+void termViewStatus(TermView *view, const char *msg)
+{
+    // messages are shared with the plain mode, drop their blank lines
+    while (*msg == '\n')
+    {
+        msg++;
+    }
+    int len = (int)strcspn(msg, "\n");
+    termViewAppend(view, "\033[%d;1H\033[2K%.*s", view->statusRow, len, msg);
+}
+
+/**
+ * @brief Parks the cursor on a cleared prompt line and writes the frame at once.
+ */
+void termViewFlush(TermView *view)
+{
+    termViewAppend(view, "\033[%d;1H\033[J", view->promptRow);
+    fwrite(view->frame, 1, view->len, stdout);
+    fflush(stdout);
+    view->len = 0;
+}
+
+/**
+ * @brief Reports a play() message, on the status line or as plain text.
+ */
+void playReport(TermView *view, const char *msg)
+{
+    if (view->active)
+    {
+        termViewStatus(view, msg);
+    }
+    else
+    {
+        fputs(msg, stdout);
+    }
+}
+
+/**
+ * @brief Returns a monotonic timestamp in milliseconds.
+ */
+double monotonicMs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+/**
+ * @brief Checks whether a value appears twice in some row or column, for a board of order size.
+ *
+ * The occupancy masks record each value only once, so a row or column
+ * whose mask has fewer bits than filled cells contains a duplicate.
+ */
+static inline __attribute__((always_inline)) int hasConflictsBody(const LatinBoard *board, int size)
+{
+    const uint8_t *cells = board->cells;
+    for (int t = 0; t < size; t++)
+    {
+        int rowFilled = 0, colFilled = 0;
+        for (int k = 0; k < size; k++)
+        {
+            rowFilled += cells[t * size + k] != 0;
+            colFilled += cells[k * size + t] != 0;
+        }
+        if (__builtin_popcountll(board->rowMask[t]) != rowFilled ||
+            __builtin_popcountll(board->colMask[t]) != colFilled)
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Finds the empty cell with the fewest candidates (minimum remaining values).
+ *
+ * Cells are scanned in row-major order and the first cell with one or
+ * no candidate ends the scan, since none can do better.
+ *
+ * @param board A board of order size with at least one empty cell.
+ * @param cands Receives the candidate mask of the chosen cell; 0 means
+ *              some cell has no candidate left and the board is dead.
+ * @return The row-major index of the chosen cell.
+ */
+static inline __attribute__((always_inline)) int pickCellBody(const LatinBoard *board, uint64_t *cands, int size)
+{
+    uint64_t full = (size == 64) ? ~0ull : (1ull << size) - 1;
+    int bestCell = -1, bestCount = size + 1;
+    uint64_t bestCands = 0;
+    for (int i = 0; i < size; i++)
+    {
+        uint64_t rowFree = ~board->rowMask[i] & full;
+        for (int j = 0; j < size; j++)
+        {
+            if (board->cells[i * size + j] != 0)
+            {
+                continue;
+            }
+            uint64_t c = rowFree & ~board->colMask[j];
+            int count = __builtin_popcountll(c);
+            if (count < bestCount)
+            {
+                bestCell = i * size + j;
+                bestCount = count;
+                bestCands = c;
+                if (count <= 1)
+                {
+                    *cands = bestCands;
+                    return bestCell;
+                }
+            }
+        }
+    }
+    *cands = bestCands;
+    return bestCell;
+}
+
+/**
+ * @brief Depth-first search step of the backtracking solver, for a board of order size.
+ *
+ * Picks the empty cell with the fewest candidates (minimum remaining
+ * values) and tries each of them in turn. A cell without candidates
+ * prunes the branch immediately. self is the specialised step the
+ * recursion continues in.
+ *
+ * @return 1 once the board is complete, 0 if this branch has no solution.
+ */
+static inline __attribute__((always_inline)) int solveStepBody(LatinBoard *board, SolveStats *stats, int size,
+                                                               int (*self)(LatinBoard *, SolveStats *))
+{
+    if (board->filled == size * size)
+    {
+        return 1;
+    }
+
+    uint64_t bestCands;
+    int cell = pickCellBody(board, &bestCands, size);
+    if (bestCands == 0)
+    {
+        return 0;
+    }
+
+    int i = cell / size, j = cell % size;
+    while (bestCands != 0)
+    {
+        uint64_t bit = bestCands & -bestCands;
+        bestCands &= bestCands - 1;
+
+        stats->nodes++;
+        board->cells[cell] = (uint8_t)(__builtin_ctzll(bit) + 1);
+        board->rowMask[i] |= bit;
+        board->colMask[j] |= bit;
+        board->filled++;
+        if (self(board, stats))
+        {
+            return 1;
+        }
+        board->cells[cell] = 0;
+        board->rowMask[i] &= ~bit;
+        board->colMask[j] &= ~bit;
+        board->filled--;
+    }
+    return 0;
+}
+
+static int hasConflictsAny(const LatinBoard *board)
+{
+    return hasConflictsBody(board, board->size);
+}
+
+static int pickCellAny(const LatinBoard *board, uint64_t *cands)
+{
+    return pickCellBody(board, cands, board->size);
+}
+
+static int solveStepAny(LatinBoard *board, SolveStats *stats)
+{
+    return solveStepBody(board, stats, board->size, solveStepAny);
+}
+
+/** @brief Stamps out the kernels of one constant order. */
+#define BOARD_KERNELS(N)                                                                  \
+    static int hasConflicts##N(const LatinBoard *board)                                  \
+    {                                                                                     \
+        return hasConflictsBody(board, N);                                                \
+    }                                                                                     \
+    static int pickCell##N(const LatinBoard *board, uint64_t *cands)                     \
+    {                                                                                     \
+        return pickCellBody(board, cands, N);                                             \
+    }                                                                                     \
+    static int solveStep##N(LatinBoard *board, SolveStats *stats)                        \
+    {                                                                                     \
+        return solveStepBody(board, stats, N, solveStep##N);                              \
+    }
+
+BOARD_KERNELS(4)
+BOARD_KERNELS(8)
+BOARD_KERNELS(9)
+BOARD_KERNELS(16)
+
+/** @brief The kernel tables, generic first. */
+static const BoardKernels boardKernelTable[] = {
+    {0, hasConflictsAny, pickCellAny, solveStepAny},
+    {4, hasConflicts4, pickCell4, solveStep4},
+    {8, hasConflicts8, pickCell8, solveStep8},
+    {9, hasConflicts9, pickCell9, solveStep9},
+    {16, hasConflicts16, pickCell16, solveStep16},
+};
+
+/**
+ * @brief Returns the kernels for boards of the given order.
+ *
+ * @param order The order of the board.
+ * @return The table specialised for order, or the generic one.
+ */
+const BoardKernels *boardKernelsFor(int order)
+{
+    for (size_t t = 1; t < sizeof(boardKernelTable) / sizeof(boardKernelTable[0]); t++)
+    {
+        if (boardKernelTable[t].order == order)
+        {
+            return &boardKernelTable[t];
+        }
+    }
+    return &boardKernelTable[0];
+}
+
+/**
+ * @brief Checks whether a value appears twice in some row or column.
+ *
+ * @param board The Latin square to be checked.
+ * @return 1 if a duplicate is found, 0 otherwise.
+ */
+int boardHasConflicts(const LatinBoard *board)
+{
+    return board->kernels->hasConflicts(board);
+}
+
+/**
+ * @brief Checks that every row of a padded copy of a full board holds each value once (portable version).
+ *
+ * @param rows The cells, VALIDATE_STRIDE bytes per row, padding zeroed.
+ * @param size The order of the board.
+ * @return 1 if every row and column is a permutation of 1..size, 0 otherwise.
+ */
+static int validateRowsScalar(const uint8_t *rows, int size)
+{
+    uint64_t full = (size == 64) ? ~0ull : (1ull << size) - 1;
+    uint64_t col[MAX_ORDER] = {0};
+
+    for (int i = 0; i < size; i++)
+    {
+        uint64_t row = 0;
+        for (int j = 0; j < size; j++)
+        {
+            unsigned v = rows[i * VALIDATE_STRIDE + j] - 1u;
+            uint64_t bit = (v < (unsigned)size) ? 1ull << v : 0;
+            row |= bit;
+            col[j] |= bit;
+        }
+        if (row != full)
+        {
+            return 0;
+        }
+    }
+    for (int j = 0; j < size; j++)
+    {
+        if (col[j] != full)
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+#if VALIDATE_HAVE_X86
+/**
+ * @brief SSE4.1 version of validateRowsScalar() for orders up to 16.
+ *
+ * A row fits in one register. Two byte shuffles look up the low and
+ * high byte of 1 << (v - 1) for all 16 cells at once (0 and out of
+ * range values map to nothing); the halves are ORed into per-column
+ * masks and folded into the row mask.
+ */
+__attribute__((target("sse4.1")))
+static int validateRowsSse4(const uint8_t *rows, int size)
+{
+    const __m128i lowBits = _mm_setr_epi8(1, 2, 4, 8, 16, 32, 64, (char)128, 0, 0, 0, 0, 0, 0, 0, 0);
+    const __m128i highBits = _mm_setr_epi8(0, 0, 0, 0, 0, 0, 0, 0, 1, 2, 4, 8, 16, 32, 64, (char)128);
+    const __m128i one = _mm_set1_epi8(1);
+    const __m128i fifteen = _mm_set1_epi8(15);
+    unsigned full = (1u << size) - 1;
+    __m128i colLow = _mm_setzero_si128(), colHigh = _mm_setzero_si128();
+
+    for (int i = 0; i < size; i++)
+    {
+        __m128i cells = _mm_load_si128((const __m128i *)(rows + i * VALIDATE_STRIDE));
+        // index v - 1, with bit 7 set (shuffle result 0) for 0 and for values above 16
+        __m128i idx = _mm_sub_epi8(cells, one);
+        idx = _mm_or_si128(idx, _mm_cmpgt_epi8(idx, fifteen));
+        __m128i low = _mm_shuffle_epi8(lowBits, idx);
+        __m128i high = _mm_shuffle_epi8(highBits, idx);
+        colLow = _mm_or_si128(colLow, low);
+        colHigh = _mm_or_si128(colHigh, high);
+
+        __m128i r = _mm_or_si128(_mm_unpacklo_epi8(low, high), _mm_unpackhi_epi8(low, high));
+        r = _mm_or_si128(r, _mm_srli_si128(r, 8));
+        r = _mm_or_si128(r, _mm_srli_si128(r, 4));
+        r = _mm_or_si128(r, _mm_srli_si128(r, 2));
+        if ((unsigned)_mm_extract_epi16(r, 0) != full)
+        {
+            return 0;
+        }
+    }
+
+    uint8_t expectLow[16] = {0}, expectHigh[16] = {0};
+    for (int j = 0; j < size; j++)
+    {
+        expectLow[j] = (uint8_t)full;
+        expectHigh[j] = (uint8_t)(full >> 8);
+    }
+    __m128i eq = _mm_and_si128(_mm_cmpeq_epi8(colLow, _mm_loadu_si128((const __m128i *)expectLow)),
+                               _mm_cmpeq_epi8(colHigh, _mm_loadu_si128((const __m128i *)expectHigh)));
+    return _mm_movemask_epi8(eq) == 0xFFFF;
+}
+
+/**
+ * @brief AVX2 version of validateRowsScalar() for orders above 32.
+ *
+ * Widens 4 cells to 64-bit lanes and turns each value v into the bit
+ * 1 << (v - 1) with a variable shift (0 and out of range values shift
+ * the bit out); the lanes are ORed into per-column masks and reduced
+ * into the row mask.
+ */
+__attribute__((target("avx2")))
+static int validateRowsAvx2Wide(const uint8_t *rows, int size)
+{
+    int chunks = (size + 3) / 4;
+    uint64_t full = (size == 64) ? ~0ull : (1ull << size) - 1;
+    __m256i one = _mm256_set1_epi64x(1);
+    __m256i cols[MAX_ORDER / 4];
+
+    for (int c = 0; c < chunks; c++)
+    {
+        cols[c] = _mm256_setzero_si256();
+    }
+
+    for (int i = 0; i < size; i++)
+    {
+        __m256i row = _mm256_setzero_si256();
+        for (int c = 0; c < chunks; c++)
+        {
+            int32_t four;
+            memcpy(&four, rows + i * VALIDATE_STRIDE + 4 * c, sizeof(four));
+            __m256i v = _mm256_cvtepu8_epi64(_mm_cvtsi32_si128(four));
+            __m256i bits = _mm256_sllv_epi64(one, _mm256_sub_epi64(v, one));
+            cols[c] = _mm256_or_si256(cols[c], bits);
+            row = _mm256_or_si256(row, bits);
+        }
+        __m128i r = _mm_or_si128(_mm256_castsi256_si128(row), _mm256_extracti128_si256(row, 1));
+        r = _mm_or_si128(r, _mm_unpackhi_epi64(r, r));
+        if ((uint64_t)_mm_cvtsi128_si64(r) != full)
+        {
+            return 0;
+        }
+    }
+
+    for (int c = 0; c < chunks; c++)
+    {
+        uint64_t lanes[4];
+        _mm256_storeu_si256((__m256i *)lanes, cols[c]);
+        for (int l = 0; l < 4; l++)
+        {
+            if (lanes[l] != (4 * c + l < size ? full : 0))
+            {
+                return 0;
+            }
+        }
+    }
+    return 1;
+}
+
+/**
+ * @brief AVX2 version of validateRowsScalar().
+ *
+ * Same scheme as validateRowsAvx2Wide() with 32-bit masks, so 8 cells
+ * are handled per instruction; orders above 32 use the wide version.
+ */
+__attribute__((target("avx2")))
+static int validateRowsAvx2(const uint8_t *rows, int size)
+{
+    if (size > 32)
+    {
+        return validateRowsAvx2Wide(rows, size);
+    }
+
+    int chunks = (size + 7) / 8;
+    uint32_t full = (size == 32) ? ~0u : (1u << size) - 1;
+    uint32_t lanes[MAX_ORDER / 2] = {0};
+    __m256i one = _mm256_set1_epi32(1);
+    __m256i cols[MAX_ORDER / 16];
+
+    for (int c = 0; c < chunks; c++)
+    {
+        cols[c] = _mm256_setzero_si256();
+    }
+
+    for (int i = 0; i < size; i++)
+    {
+        __m256i row = _mm256_setzero_si256();
+        for (int c = 0; c < chunks; c++)
+        {
+            __m128i cells = _mm_loadl_epi64((const __m128i *)(rows + i * VALIDATE_STRIDE + 8 * c));
+            __m256i v = _mm256_cvtepu8_epi32(cells);
+            __m256i bits = _mm256_sllv_epi32(one, _mm256_sub_epi32(v, one));
+            cols[c] = _mm256_or_si256(cols[c], bits);
+            row = _mm256_or_si256(row, bits);
+        }
+        __m128i r = _mm_or_si128(_mm256_castsi256_si128(row), _mm256_extracti128_si256(row, 1));
+        r = _mm_or_si128(r, _mm_unpackhi_epi64(r, r));
+        r = _mm_or_si128(r, _mm_srli_epi64(r, 32));
+        if ((uint32_t)_mm_cvtsi128_si32(r) != full)
+        {
+            return 0;
+        }
+    }
+
+    for (int j = 0; j < size; j++)
+    {
+        lanes[j] = full;
+    }
+    for (int c = 0; c < chunks; c++)
+    {
+        __m256i expect = _mm256_loadu_si256((const __m256i *)(lanes + 8 * c));
+        if (_mm256_movemask_epi8(_mm256_cmpeq_epi32(cols[c], expect)) != -1)
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+#endif
+
+/** @brief Runs the best row kernel the CPU supports; returns 1 if every row and column is a permutation. */
+static int validateRows(const uint8_t *rows, int size)
+{
+#if VALIDATE_HAVE_X86
+    // one shuffle per row beats widening to 32-bit lanes while a row fits in 16 bytes
+    if (size <= 16 && __builtin_cpu_supports("sse4.1"))
+    {
+        return validateRowsSse4(rows, size);
+    }
+    if (__builtin_cpu_supports("avx2"))
+    {
+        return validateRowsAvx2(rows, size);
+    }
+#endif
+    return validateRowsScalar(rows, size);
+}
+
+/** @brief Returns non-zero if square has the order of puzzle and every given of puzzle, unchanged and still given. */
+static int givensKept(const LatinBoard *square, const LatinBoard *puzzle)
+{
+    int size = square->size;
+    if (puzzle->size != size)
+    {
+        return 0;
+    }
+    for (int w = 0; w < (size * size + 63) / 64; w++)
+    {
+        uint64_t g = puzzle->given[w];
+        if ((square->given[w] & g) != g)
+        {
+            return 0;
+        }
+        for (; g != 0; g &= g - 1)
+        {
+            int k = w * 64 + __builtin_ctzll(g);
+            if (square->cells[k] != puzzle->cells[k])
+            {
+                return 0;
+            }
+        }
+    }
+    return 1;
+}
+
+/**
+ * @brief Checks that a board is a complete Latin square and keeps the givens of its puzzle.
+ *
+ * The cells are copied into a zero-padded buffer with a fixed row
+ * stride, then every row and column is checked to be a permutation of
+ * 1..order with the SSE4.1 kernel (orders up to 16), the AVX2 one or a
+ * portable one, depending on what the CPU supports. An empty or out of range cell fails the check.
+ *
+ * @param square The board to check.
+ * @param puzzle The puzzle the square was completed from, or NULL to
+ *               skip the givens check. Every given of the puzzle must
+ *               still be a given of square with the same value.
+ * @return SQUARE_VALID, SQUARE_NOT_LATIN or SQUARE_GIVEN_CHANGED.
+ */
+SquareVerdict validateLatinSquare(const LatinBoard *square, const LatinBoard *puzzle)
+{
+    int size = square->size;
+    _Alignas(32) uint8_t rows[MAX_ORDER * VALIDATE_STRIDE];
+
+    if (puzzle != NULL && !givensKept(square, puzzle))
+    {
+        return SQUARE_GIVEN_CHANGED;
+    }
+
+    memset(rows, 0, (size_t)size * VALIDATE_STRIDE);
+    for (int i = 0; i < size; i++)
+    {
+        memcpy(rows + i * VALIDATE_STRIDE, square->cells + i * size, (size_t)size);
+    }
+
+    return validateRows(rows, size) ? SQUARE_VALID : SQUARE_NOT_LATIN;
+}
+
+/**
+ * @brief Prepares an empty set of interleaved boards.
+ *
+ * @param mb The set to initialise.
+ * @param size The order of every board it will hold.
+ * @return 0 on success, or -1 on error.
+ */
+int multiBoardInit(MultiBoard *mb, int size)
+{
+    size_t bytes = ((size_t)size * size * MULTI_BOARD_LANES + 63) & ~(size_t)63;
+    mb->size = size;
+    mb->count = 0;
+    mb->cells = aligned_alloc(64, bytes);
+    if (mb->cells == NULL)
+    {
+        return -1;
+    }
+    memset(mb->cells, 0, bytes);
+    return 0;
+}
+
+/**
+ * @brief Releases the storage of a set of interleaved boards.
+ *
+ * @param mb The set.
+ */
+void multiBoardFree(MultiBoard *mb)
+{
+    free(mb->cells);
+    memset(mb, 0, sizeof(*mb));
+}
+
+/**
+ * @brief Copies a board into the next free lane.
+ *
+ * @param mb The set; reset count to 0 to reuse it.
+ * @param board A board of the set's order.
+ * @return The lane of the board, or -1 if the set is full or the order differs.
+ */
+int multiBoardAdd(MultiBoard *mb, const LatinBoard *board)
+{
+    if (mb->count == MULTI_BOARD_LANES || board->size != mb->size)
+    {
+        return -1;
+    }
+    int lane = mb->count++;
+    for (int k = 0; k < mb->size * mb->size; k++)
+    {
+        mb->cells[k * MULTI_BOARD_LANES + lane] = board->cells[k];
+    }
+    return lane;
+}
+
+/**
+ * @brief Checks the lanes one by one with the single-board row kernels; any order.
+ *
+ * Used above MULTI_BOARD_MAX_ORDER, where the value masks no longer fit
+ * two shuffle tables, and on CPUs without AVX2.
+ */
+static uint32_t multiValidateEach(const MultiBoard *mb)
+{
+    int size = mb->size;
+    _Alignas(32) uint8_t rows[MAX_ORDER * VALIDATE_STRIDE];
+    uint32_t valid = 0;
+
+    memset(rows, 0, (size_t)size * VALIDATE_STRIDE);
+    for (int b = 0; b < mb->count; b++)
+    {
+        for (int i = 0; i < size; i++)
+        {
+            for (int j = 0; j < size; j++)
+            {
+                rows[i * VALIDATE_STRIDE + j] = mb->cells[(i * size + j) * MULTI_BOARD_LANES + b];
+            }
+        }
+        valid |= (uint32_t)validateRows(rows, size) << b;
+    }
+    return valid;
+}
+
+#if VALIDATE_HAVE_X86
+/**
+ * @brief Checks all 32 lanes at once, for orders up to MULTI_BOARD_MAX_ORDER.
+ *
+ * Each cell vector is turned into value bits with two shuffles, low
+ * values (1..8) and high values (9..16) in separate byte vectors, and
+ * OR-ed into the masks of its row and of its column. A lane stays valid
+ * while every row and column mask holds all size values.
+ */
+__attribute__((target("avx2")))
+static uint32_t multiValidateAvx2(const MultiBoard *mb)
+{
+    int size = mb->size;
+    const __m256i lowBits = _mm256_setr_epi8(1, 2, 4, 8, 16, 32, 64, (char)128, 0, 0, 0, 0, 0, 0, 0, 0,
+                                             1, 2, 4, 8, 16, 32, 64, (char)128, 0, 0, 0, 0, 0, 0, 0, 0);
+    const __m256i highBits = _mm256_setr_epi8(0, 0, 0, 0, 0, 0, 0, 0, 1, 2, 4, 8, 16, 32, 64, (char)128,
+                                              0, 0, 0, 0, 0, 0, 0, 0, 1, 2, 4, 8, 16, 32, 64, (char)128);
+    const __m256i one = _mm256_set1_epi8(1);
+    const __m256i fullLow = _mm256_set1_epi8((char)((1u << size) - 1));
+    const __m256i fullHigh = _mm256_set1_epi8((char)(((1u << size) - 1) >> 8));
+    __m256i colLow[16], colHigh[16];
+    __m256i valid = _mm256_set1_epi8(-1);
+
+    for (int j = 0; j < size; j++)
+    {
+        colLow[j] = colHigh[j] = _mm256_setzero_si256();
+    }
+    for (int i = 0; i < size; i++)
+    {
+        __m256i rowLow = _mm256_setzero_si256(), rowHigh = _mm256_setzero_si256();
+        for (int j = 0; j < size; j++)
+        {
+            // index v - 1: an empty cell becomes 255, which shuffles to 0
+            __m256i idx = _mm256_sub_epi8(
+                _mm256_load_si256((const __m256i *)(mb->cells + (i * size + j) * MULTI_BOARD_LANES)), one);
+            __m256i low = _mm256_shuffle_epi8(lowBits, idx);
+            __m256i high = _mm256_shuffle_epi8(highBits, idx);
+            rowLow = _mm256_or_si256(rowLow, low);
+            rowHigh = _mm256_or_si256(rowHigh, high);
+            colLow[j] = _mm256_or_si256(colLow[j], low);
+            colHigh[j] = _mm256_or_si256(colHigh[j], high);
+        }
+        valid = _mm256_and_si256(valid, _mm256_and_si256(_mm256_cmpeq_epi8(rowLow, fullLow),
+                                                         _mm256_cmpeq_epi8(rowHigh, fullHigh)));
+    }
+    for (int j = 0; j < size; j++)
+    {
+        valid = _mm256_and_si256(valid, _mm256_and_si256(_mm256_cmpeq_epi8(colLow[j], fullLow),
+                                                         _mm256_cmpeq_epi8(colHigh[j], fullHigh)));
+    }
+
+    uint32_t used = (mb->count == 32) ? ~0u : (1u << mb->count) - 1;
+    return (uint32_t)_mm256_movemask_epi8(valid) & used;
+}
+#endif
+
+/**
+ * @brief Checks which boards of a set are complete Latin squares.
+ *
+ * A board passes exactly when play() would report it won: every cell
+ * filled and no value repeated in a row or column.
+ *
+ * @param mb The set.
+ * @return A mask with bit b set when board b is a complete Latin square.
+ */
+uint32_t multiBoardValidate(const MultiBoard *mb)
+{
+#if VALIDATE_HAVE_X86
+    if (mb->size <= MULTI_BOARD_MAX_ORDER && __builtin_cpu_supports("avx2"))
+    {
+        return multiValidateAvx2(mb);
+    }
+#endif
+    return multiValidateEach(mb);
+}
+
+/**
+ * @brief Completes a partially filled Latin square by backtracking.
+ *
+ * On success the board holds the solution; on failure it is left as
+ * it was passed in.
+ *
+ * @param board The Latin square to be solved in place.
+ * @param stats Receives the node count and elapsed time.
+ * @return 1 if a solution was found, 0 otherwise.
+ */
+int solveLatinSquare(LatinBoard *board, SolveStats *stats)
+{
+    stats->nodes = 0;
+    double start = monotonicMs();
+    int solved = !boardHasConflicts(board) && board->kernels->solveStep(board, stats);
+    stats->elapsedMs = monotonicMs() - start;
+    return solved;
+}
+
+/**
+ * @brief A worker's share of the task list, stolen from by idle workers.
+ *
+ * The owner takes tasks from the tail; thieves take from the head, so
+ * contention only happens once a deque is nearly empty.
+ */
+typedef struct
+{
+    pthread_mutex_t lock;
+    int head, tail;
+} TaskDeque;
+
+/**
+ * @brief Shared state of one parallel search.
+ */
+typedef struct
+{
+    const LatinBoard *root;
+    const SearchTask *tasks;
+    TaskDeque *deques;
+    int threads;
+    unsigned long long limit;
+    _Atomic unsigned long long solutions;
+} ParallelSearch;
+
+/**
+ * @brief Per-thread state: its own board copies and counters.
+ */
+typedef struct
+{
+    ParallelSearch *search;
+    int id;
+    int failed;
+    int haveSolution;
+    unsigned long long nodes;
+    LatinBoard work;
+    LatinBoard solution;
+    pthread_t thread;
+} SearchWorker;
+
+/**
+ * @brief Expands the search tree breadth first into independent subproblems.
+ *
+ * Each round replaces every open task by one child per candidate of its
+ * MRV cell, until there are enough tasks or SPLIT_MAX_DEPTH is reached.
+ * Dead branches are dropped and complete boards are kept as they are.
+ *
+ * @param root The puzzle to split, free of conflicts.
+ * @param target Stop splitting once at least this many tasks exist.
+ * @param count Receives the number of tasks.
+ * @return The task array (to be freed by the caller), or NULL on allocation failure.
+ */
+static SearchTask *splitSearch(const LatinBoard *root, int target, int *count)
+{
+    int size = root->size;
+    int n = 1;
+    SearchTask *tasks = calloc(1, sizeof(SearchTask));
+    LatinBoard scratch;
+
+    if (tasks == NULL || boardCopy(&scratch, root) != 0)
+    {
+        free(tasks);
+        return NULL;
+    }
+
+    for (int depth = 0; depth < SPLIT_MAX_DEPTH && n < target; depth++)
+    {
+        int next = 0, nextCap = n * size;
+        SearchTask *children = malloc((size_t)nextCap * sizeof(SearchTask));
+        if (children == NULL)
+        {
+            free(tasks);
+            boardFree(&scratch);
+            return NULL;
+        }
+
+        int expanded = 0;
+        for (int t = 0; t < n; t++)
+        {
+            boardAssign(&scratch, root);
+            for (int d = 0; d < tasks[t].depth; d++)
+            {
+                boardPlace(&scratch, tasks[t].cell[d] / size, tasks[t].cell[d] % size, tasks[t].val[d]);
+            }
+            if (scratch.filled == size * size)
+            {
+                children[next++] = tasks[t];
+                continue;
+            }
+
+            uint64_t cands;
+            int cell = scratch.kernels->pickCell(&scratch, &cands);
+            while (cands != 0)
+            {
+                SearchTask child = tasks[t];
+                child.cell[child.depth] = cell;
+                child.val[child.depth] = (uint8_t)(__builtin_ctzll(cands) + 1);
+                child.depth++;
+                cands &= cands - 1;
+                children[next++] = child;
+            }
+            expanded = 1;
+        }
+
+        free(tasks);
+        tasks = children;
+        n = next;
+        if (!expanded || n == 0)
+        {
+            break;
+        }
+    }
+    boardFree(&scratch);
+    *count = n;
+    return tasks;
+}
+
+/** @brief Takes the next task from the worker's own deque, or steals one; returns -1 when all are empty. */
+static int nextTask(ParallelSearch *ps, int self)
+{
+    TaskDeque *own = &ps->deques[self];
+    pthread_mutex_lock(&own->lock);
+    int task = (own->head < own->tail) ? --own->tail : -1;
+    pthread_mutex_unlock(&own->lock);
+
+    for (int k = 1; task < 0 && k < ps->threads; k++)
+    {
+        TaskDeque *victim = &ps->deques[(self + k) % ps->threads];
+        pthread_mutex_lock(&victim->lock);
+        if (victim->head < victim->tail)
+        {
+            task = victim->head++;
+        }
+        pthread_mutex_unlock(&victim->lock);
+    }
+    return task;
+}
+
+/** @brief Thread body: solves tasks with the DLX engine until none are left or the limit is hit. */
+static void *searchWorkerMain(void *arg)
+{
+    SearchWorker *w = arg;
+    ParallelSearch *ps = w->search;
+    int size = ps->root->size;
+
+    for (;;)
+    {
+        if (ps->limit != 0 && atomic_load(&ps->solutions) >= ps->limit)
+        {
+            break;
+        }
+        int t = nextTask(ps, w->id);
+        if (t < 0)
+        {
+            break;
+        }
+
+        boardAssign(&w->work, ps->root);
+        for (int d = 0; d < ps->tasks[t].depth; d++)
+        {
+            boardPlace(&w->work, ps->tasks[t].cell[d] / size, ps->tasks[t].cell[d] % size, ps->tasks[t].val[d]);
+        }
+        w->nodes += (unsigned long long)ps->tasks[t].depth;
+
+        DlxMatrix m;
+        if (dlxBuild(&m, &w->work) != 0)
+        {
+            w->failed = 1;
+            break;
+        }
+        m.sharedSolutions = &ps->solutions;
+        unsigned long long found = dlxCountSolutions(&m, ps->limit, w->haveSolution ? NULL : &w->work);
+        w->nodes += m.nodes;
+        dlxFree(&m);
+
+        if (found > 0 && !w->haveSolution)
+        {
+            boardAssign(&w->solution, &w->work);
+            w->haveSolution = 1;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Counts completions on a pool of work-stealing threads.
+ *
+ * The search tree is split into subproblems at a shallow depth; each
+ * worker searches its share on its own copy of the board, steals from
+ * the others when it runs dry, and adds its solutions to one atomic
+ * counter so the limit stops every worker.
+ *
+ * @param board The puzzle, free of conflicts.
+ * @param threads Number of worker threads.
+ * @param limit Stop once this many solutions are found, 0 for no limit.
+ * @param firstSolution Board of the same order that receives a
+ *                      completion if one is found, or NULL.
+ * @param nodes Receives the total number of search nodes.
+ * @return The number of solutions found (capped at limit), or
+ *         (unsigned long long)-1 on allocation failure.
+ */
+unsigned long long parallelCountSolutions(const LatinBoard *board, int threads, unsigned long long limit,
+                                          LatinBoard *firstSolution, unsigned long long *nodes)
+{
+    int taskCount = 0;
+    SearchTask *tasks = splitSearch(board, threads * SPLIT_TASKS_PER_THREAD, &taskCount);
+    SearchWorker *workers = calloc((size_t)threads, sizeof(SearchWorker));
+    TaskDeque *deques = calloc((size_t)threads, sizeof(TaskDeque));
+    ParallelSearch ps = {board, tasks, deques, threads, limit, 0};
+    unsigned long long result = (unsigned long long)-1;
+    int started = 0, failed = 0;
+
+    // a thread that fails to start is not fatal: the others steal its tasks
+    *nodes = 0;
+    if (tasks == NULL || workers == NULL || deques == NULL)
+    {
+        goto done;
+    }
+
+    for (int w = 0; w < threads; w++)
+    {
+        pthread_mutex_init(&deques[w].lock, NULL);
+        deques[w].head = (int)((long long)taskCount * w / threads);
+        deques[w].tail = (int)((long long)taskCount * (w + 1) / threads);
+        workers[w].search = &ps;
+        workers[w].id = w;
+    }
+
+    for (started = 0; started < threads; started++)
+    {
+        SearchWorker *w = &workers[started];
+        if (boardCopy(&w->work, board) != 0 || boardCopy(&w->solution, board) != 0 ||
+            pthread_create(&w->thread, NULL, searchWorkerMain, w) != 0)
+        {
+            boardFree(&w->work);
+            boardFree(&w->solution);
+            break;
+        }
+    }
+
+    for (int w = 0; w < started; w++)
+    {
+        pthread_join(workers[w].thread, NULL);
+        *nodes += workers[w].nodes;
+        failed |= workers[w].failed;
+        if (workers[w].haveSolution && firstSolution != NULL)
+        {
+            boardAssign(firstSolution, &workers[w].solution);
+            firstSolution = NULL;
+        }
+        boardFree(&workers[w].work);
+        boardFree(&workers[w].solution);
+    }
+    for (int w = 0; w < threads; w++)
+    {
+        pthread_mutex_destroy(&deques[w].lock);
+    }
+
+    // a worker that could not allocate its matrix dropped a task, so the count is incomplete
+    if (!failed && started > 0)
+    {
+        result = atomic_load(&ps.solutions);
+        if (limit != 0 && result > limit)
+        {
+            result = limit;
+        }
+    }
+
+done:
+    free(tasks);
+    free(workers);
+    free(deques);
+    return result;
+}
+
+/**
+ * @brief Runs --solve mode: solves the board and reports the result.
+ *
+ * @param board The Latin square to be solved.
+ * @param threads Number of worker threads, 1 to use the backtracking solver.
+ * @return Exit status code: 0 if solved, 2 if the puzzle has no solution.
+ */
+int runSolve(LatinBoard *board, int threads)
+{
+    SolveStats stats;
+    int solved;
+
+    if (threads > 1)
+    {
+        // split the search over the pool and stop at the first completion
+        double start = monotonicMs();
+        stats.nodes = 0;
+        LatinBoard solution;
+        if (boardCopy(&solution, board) != 0)
+        {
+            printf("Error: Unable to allocate memory for the solver\n");
+            return 1;
+        }
+        unsigned long long count = boardHasConflicts(board) ? 0
+            : parallelCountSolutions(board, threads, 1, &solution, &stats.nodes);
+        if (count == (unsigned long long)-1)
+        {
+            printf("Error: Unable to allocate memory for the solver\n");
+            boardFree(&solution);
+            return 1;
+        }
+        solved = count > 0;
+        if (solved)
+        {
+            boardAssign(board, &solution);
+        }
+        boardFree(&solution);
+        stats.elapsedMs = monotonicMs() - start;
+    }
+    else
+    {
+        solved = solveLatinSquare(board, &stats);
+    }
+
+    if (solved)
+    {
+        printf("Solution found!\n");
+        displayLatinSquare(board);
+    }
+    else
+    {
+        printf("No solution exists for this latin square!\n");
+    }
+    printf("Nodes: %llu\nTime: %.3f ms\n", stats.nodes, stats.elapsedMs);
+    return solved ? 0 : 2;
+}
+
+/**
+ * @brief Builds the exact-cover matrix of the remaining empty cells.
+ *
+ * @param m The matrix to initialise.
+ * @param board The partially filled Latin square.
+ * @return 0 on success, or -1 on allocation failure.
+ */
+int dlxBuild(DlxMatrix *m, const LatinBoard *board)
+{
+    memset(m, 0, sizeof(*m));
+    int size = board->size;
+    int cells = size * size;
+    int numCols = 3 * cells;
+
+    // count candidate placements first so everything fits in one allocation
+    int numRows = 0;
+    for (int k = 0; k < cells; k++)
+    {
+        if (board->cells[k] == 0)
+        {
+            numRows += __builtin_popcountll(boardCandidates(board, k / size, k % size));
+        }
+    }
+
+    int numNodes = 1 + numCols + 3 * numRows;
+    size_t ints = 6 * (size_t)numNodes + (size_t)numCols + 1 + 2 * (size_t)numRows + (size_t)cells;
+    int *block = malloc(ints * sizeof(int));
+    if (block == NULL)
+    {
+        return -1;
+    }
+
+    m->left = block;
+    m->right = m->left + numNodes;
+    m->up = m->right + numNodes;
+    m->down = m->up + numNodes;
+    m->column = m->down + numNodes;
+    m->nodeRow = m->column + numNodes;
+    m->colSize = m->nodeRow + numNodes;
+    m->rowCell = m->colSize + numCols + 1;
+    m->rowVal = m->rowCell + numRows;
+    m->stack = m->rowVal + numRows;
+    m->numCols = numCols;
+
+    // headers: each starts as an empty vertical list
+    for (int c = 0; c <= numCols; c++)
+    {
+        m->up[c] = m->down[c] = c;
+        m->column[c] = c;
+        m->colSize[c] = 0;
+        m->left[c] = m->right[c] = c;
+    }
+
+    // link into the root list only the constraints some placement must meet,
+    // i.e. empty cells and symbols missing from a row or column
+    uint64_t full = boardFullMask(board);
+    for (int c = 1; c <= numCols; c++)
+    {
+        int kind = (c - 1) / cells, rest = (c - 1) % cells;
+        int open = (kind == 0) ? board->cells[rest] == 0
+                 : (kind == 1) ? ((~board->rowMask[rest / size] & full) >> (rest % size)) & 1u
+                 : ((~board->colMask[rest / size] & full) >> (rest % size)) & 1u;
+        if (open)
+        {
+            m->left[c] = m->left[0];
+            m->right[c] = 0;
+            m->right[m->left[0]] = c;
+            m->left[0] = c;
+        }
+    }
+
+    int node = numCols + 1, row = 0;
+    for (int k = 0; k < cells; k++)
+    {
+        if (board->cells[k] != 0)
+        {
+            continue;
+        }
+        int i = k / size, j = k % size;
+        uint64_t cands = boardCandidates(board, i, j);
+        while (cands != 0)
+        {
+            int v = __builtin_ctzll(cands);
+            cands &= cands - 1;
+
+            int cols[3] = {1 + k, 1 + cells + i * size + v, 1 + 2 * cells + j * size + v};
+            for (int t = 0; t < 3; t++)
+            {
+                int c = cols[t], x = node + t;
+                m->column[x] = c;
+                m->nodeRow[x] = row;
+                m->up[x] = m->up[c];
+                m->down[x] = c;
+                m->down[m->up[c]] = x;
+                m->up[c] = x;
+                m->colSize[c]++;
+                m->left[x] = node + (t + 2) % 3;
+                m->right[x] = node + (t + 1) % 3;
+            }
+            m->rowCell[row] = k;
+            m->rowVal[row] = v + 1;
+            node += 3;
+            row++;
+        }
+    }
+    m->nodeCount = node;
+    return 0;
+}
+
+/**
+ * @brief Releases the storage of a dancing-links matrix.
+ *
+ * @param m The matrix to release.
+ */
+void dlxFree(DlxMatrix *m)
+{
+    free(m->left);
+    memset(m, 0, sizeof(*m));
+}
+
+/** @brief Removes column c from the header list and its rows from the other columns. */
+static void dlxCover(DlxMatrix *m, int c)
+{
+    m->right[m->left[c]] = m->right[c];
+    m->left[m->right[c]] = m->left[c];
+    for (int r = m->down[c]; r != c; r = m->down[r])
+    {
+        for (int x = m->right[r]; x != r; x = m->right[x])
+        {
+            m->down[m->up[x]] = m->down[x];
+            m->up[m->down[x]] = m->up[x];
+            m->colSize[m->column[x]]--;
+        }
+    }
+}
+
+/** @brief Reverses dlxCover(m, c). */
+static void dlxUncover(DlxMatrix *m, int c)
+{
+    for (int r = m->up[c]; r != c; r = m->up[r])
+    {
+        for (int x = m->left[r]; x != r; x = m->left[x])
+        {
+            m->colSize[m->column[x]]++;
+            m->down[m->up[x]] = x;
+            m->up[m->down[x]] = x;
+        }
+    }
+    m->right[m->left[c]] = c;
+    m->left[m->right[c]] = c;
+}
+
+/** @brief Returns non-zero once the solution or node limit is reached, counting other workers' solutions too. */
+static inline int dlxLimitReached(const DlxMatrix *m)
+{
+    if (m->nodeLimit != 0 && m->nodes >= m->nodeLimit)
+    {
+        return 1;
+    }
+    if (m->limit == 0)
+    {
+        return 0;
+    }
+    unsigned long long found = (m->sharedSolutions != NULL)
+        ? atomic_load_explicit(m->sharedSolutions, memory_order_relaxed)
+        : m->solutions;
+    return found >= m->limit;
+}
+
+/**
+ * @brief Algorithm X search step: branch on the column with fewest rows.
+ *
+ * @param m The matrix being searched.
+ * @param depth Number of rows in the current partial solution.
+ */
+static void dlxSearch(DlxMatrix *m, int depth)
+{
+    if (m->right[0] == 0)
+    {
+        if (m->sharedSolutions != NULL)
+        {
+            atomic_fetch_add_explicit(m->sharedSolutions, 1, memory_order_relaxed);
+        }
+        if (m->solutions++ == 0 && m->firstSolution != NULL)
+        {
+            for (int d = 0; d < depth; d++)
+            {
+                int k = m->rowCell[m->stack[d]];
+                boardPlace(m->firstSolution, k / m->firstSolution->size,
+                           k % m->firstSolution->size, m->rowVal[m->stack[d]]);
+            }
+        }
+        return;
+    }
+
+    // a column with at most one row cannot be beaten, so the scan stops there
+    int best = m->right[0];
+    for (int c = m->right[best]; c != 0 && m->colSize[best] > 1; c = m->right[c])
+    {
+        if (m->colSize[c] < m->colSize[best])
+        {
+            best = c;
+        }
+    }
+    if (m->colSize[best] == 0)
+    {
+        return;
+    }
+
+    dlxCover(m, best);
+    for (int r = m->down[best]; r != best; r = m->down[r])
+    {
+        m->nodes++;
+        m->stack[depth] = m->nodeRow[r];
+        for (int x = m->right[r]; x != r; x = m->right[x])
+        {
+            dlxCover(m, m->column[x]);
+        }
+        dlxSearch(m, depth + 1);
+        for (int x = m->left[r]; x != r; x = m->left[x])
+        {
+            dlxUncover(m, m->column[x]);
+        }
+        if (dlxLimitReached(m))
+        {
+            break;
+        }
+    }
+    dlxUncover(m, best);
+}
+
+/**
+ * @brief Counts the completions of the puzzle the matrix was built from.
+ *
+ * @param m The matrix built by dlxBuild().
+ * @param limit Stop once this many solutions are found, 0 for no limit.
+ * @param firstSolution Board (a copy of the puzzle) that receives the
+ *                      first completion found, or NULL.
+ * @return The number of solutions found, at most limit when limit != 0.
+ */
+unsigned long long dlxCountSolutions(DlxMatrix *m, unsigned long long limit, LatinBoard *firstSolution)
+{
+    m->solutions = 0;
+    m->nodes = 0;
+    m->limit = limit;
+    m->firstSolution = firstSolution;
+    dlxSearch(m, 0);
+    return m->solutions;
+}
+
+/**
+ * @brief Runs --count-solutions mode and reports the result.
+ *
+ * @param board The Latin square whose completions are counted.
+ * @param limit Stop once this many solutions are found, 0 for no limit.
+ * @param threads Number of worker threads, 1 to search on the calling thread.
+ * @return Exit status code: 0 if at least one solution exists, 2 otherwise.
+ */
+int runCountSolutions(LatinBoard *board, unsigned long long limit, int threads)
+{
+    double start = monotonicMs();
+    unsigned long long count = 0, nodes = 0;
+    LatinBoard solution;
+
+    if (boardCopy(&solution, board) != 0)
+    {
+        printf("Error: Unable to allocate memory for the solver\n");
+        return 1;
+    }
+
+    if (threads > 1 && !boardHasConflicts(board))
+    {
+        count = parallelCountSolutions(board, threads, limit, &solution, &nodes);
+        if (count == (unsigned long long)-1)
+        {
+            printf("Error: Unable to allocate memory for the solver\n");
+            boardFree(&solution);
+            return 1;
+        }
+    }
+    else if (!boardHasConflicts(board))
+    {
+        DlxMatrix m;
+        if (dlxBuild(&m, board) != 0)
+        {
+            printf("Error: Unable to allocate memory for the solver\n");
+            boardFree(&solution);
+            return 1;
+        }
+        count = dlxCountSolutions(&m, limit, &solution);
+        nodes = m.nodes;
+        dlxFree(&m);
+    }
+    double elapsed = monotonicMs() - start;
+
+    if (count > 0)
+    {
+        printf("First solution:\n");
+        displayLatinSquare(&solution);
+    }
+    if (limit != 0 && count >= limit)
+    {
+        printf("Solutions: %llu (limit reached)\n", count);
+    }
+    else
+    {
+        printf("Solutions: %llu\n", count);
+    }
+    printf("Nodes: %llu\nTime: %.3f ms\n", nodes, elapsed);
+
+    boardFree(&solution);
+    return count > 0 ? 0 : 2;
+}
+
+/** @brief qsort comparator for an array of C strings. */
+static int compareNames(const void *a, const void *b)
+{
+    return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+/**
+ * @brief Collects the puzzle paths named by a --batch argument.
+ *
+ * A directory contributes every regular file in it except hidden files
+ * and earlier out-* results, in name order, or only the out-* results
+ * when results is set. Anything else is a list file with one path per
+ * line, "-" meaning standard input.
+ *
+ * @param path The directory or list file.
+ * @param results Non-zero to collect the out-* files of a directory instead of the puzzles.
+ * @param count Receives the number of paths.
+ * @return A malloc'd array of malloc'd paths, or NULL on error.
+ */
+static char **collectBatchPaths(const char *path, int results, int *count)
+{
+    int n = 0, cap = 64;
+    char **paths = malloc((size_t)cap * sizeof(char *));
+    struct stat st;
+    char line[4096];
+
+    if (paths == NULL)
+    {
+        return NULL;
+    }
+
+    if (stat(path, &st) == 0 && S_ISDIR(st.st_mode))
+    {
+        DIR *dir = opendir(path);
+        struct dirent *entry;
+        if (dir == NULL)
+        {
+            free(paths);
+            return NULL;
+        }
+        while ((entry = readdir(dir)) != NULL)
+        {
+            if (entry->d_name[0] == '.' || (strncmp(entry->d_name, "out-", 4) == 0) != (results != 0))
+            {
+                continue;
+            }
+            snprintf(line, sizeof(line), "%s/%s", path, entry->d_name);
+            if (stat(line, &st) != 0 || !S_ISREG(st.st_mode))
+            {
+                continue;
+            }
+            if (n == cap)
+            {
+                char **grown = realloc(paths, (size_t)(cap *= 2) * sizeof(char *));
+                if (grown == NULL)
+                {
+                    break;
+                }
+                paths = grown;
+            }
+            paths[n++] = strdup(line);
+        }
+        closedir(dir);
+        qsort(paths, (size_t)n, sizeof(char *), compareNames);
+    }
+    else
+    {
+        FILE *fp = (strcmp(path, "-") == 0) ? stdin : fopen(path, "r");
+        if (fp == NULL)
+        {
+            free(paths);
+            return NULL;
+        }
+        while (fgets(line, sizeof(line), fp) != NULL)
+        {
+            line[strcspn(line, "\r\n")] = '\0';
+            if (line[0] == '\0')
+            {
+                continue;
+            }
+            if (n == cap)
+            {
+                char **grown = realloc(paths, (size_t)(cap *= 2) * sizeof(char *));
+                if (grown == NULL)
+                {
+                    break;
+                }
+                paths = grown;
+            }
+            paths[n++] = strdup(line);
+        }
+        if (fp != stdin)
+        {
+            fclose(fp);
+        }
+    }
+
+    *count = n;
+    return paths;
+}
+
+/**
+ * @brief Builds the out-<name> path next to a puzzle file.
+ */
+static void batchOutputPath(const char *path, char *out, size_t outSize)
+{
+    const char *base = strrchr(path, '/');
+    if (base == NULL)
+    {
+        snprintf(out, outSize, "out-%s", path);
+    }
+    else
+    {
+        snprintf(out, outSize, "%.*s/out-%s", (int)(base - path), path, base + 1);
+    }
+}
+
+/** @brief Stores v at p as little-endian bytes. */
+static void packPutLE(uint8_t *p, uint64_t v, int bytes)
+{
+    for (int b = 0; b < bytes; b++)
+    {
+        p[b] = (uint8_t)(v >> (8 * b));
+    }
+}
+
+/** @brief Reads a little-endian integer of the given width from p. */
+static uint64_t packGetLE(const uint8_t *p, int bytes)
+{
+    uint64_t v = 0;
+    for (int b = 0; b < bytes; b++)
+    {
+        v |= (uint64_t)p[b] << (8 * b);
+    }
+    return v;
+}
+
+/** @brief Bits needed to store a cell value in [0..order]. */
+static int packCellBits(int order)
+{
+    int bits = 1;
+    while ((1 << bits) <= order)
+    {
+        bits++;
+    }
+    return bits;
+}
+
+/** @brief Size in bytes of the packed record of a board of the given order. */
+static size_t packRecordSize(int order)
+{
+    size_t cells = (size_t)order * order;
+    return (cells * (size_t)packCellBits(order) + 7) / 8 + (cells + 7) / 8;
+}
+
+/**
+ * @brief Encodes a board as a packed record.
+ *
+ * @param board The board to encode.
+ * @param out Buffer of packRecordSize(board->size) bytes.
+ */
+static void packEncodeBoard(const LatinBoard *board, uint8_t *out)
+{
+    int cells = board->size * board->size;
+    int bits = packCellBits(board->size);
+    size_t valueBytes = ((size_t)cells * (size_t)bits + 7) / 8;
+
+    memset(out, 0, packRecordSize(board->size));
+    for (int k = 0; k < cells; k++)
+    {
+        size_t bit = (size_t)k * (size_t)bits;
+        unsigned v = board->cells[k];
+        for (int b = 0; b < bits; b++, bit++)
+        {
+            out[bit >> 3] |= (uint8_t)(((v >> b) & 1u) << (bit & 7));
+        }
+        if ((board->given[k >> 6] >> (k & 63)) & 1u)
+        {
+            out[valueBytes + (k >> 3)] |= (uint8_t)(1u << (k & 7));
+        }
+    }
+}
+
+/**
+ * @brief Checks whether a file starts with the packed corpus magic.
+ */
+int packIsCorpus(const char *path)
+{
+    char magic[8];
+    FILE *fp = fopen(path, "rb");
+    if (fp == NULL)
+    {
+        return 0;
+    }
+    int isPack = fread(magic, 1, sizeof(magic), fp) == sizeof(magic) &&
+                 memcmp(magic, PACK_MAGIC, sizeof(magic)) == 0;
+    fclose(fp);
+    return isPack;
+}
+
+/**
+ * @brief Maps a packed corpus into memory and checks its header and index.
+ *
+ * @param pc The corpus to open.
+ * @param path The corpus file.
+ * @param err Receives the error message on failure.
+ * @param errSize Size of err.
+ * @return 0 on success, or -1 on error.
+ */
+int packOpen(PackCorpus *pc, const char *path, char *err, size_t errSize)
+{
+    struct stat st;
+    memset(pc, 0, sizeof(*pc));
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0 || fstat(fd, &st) != 0 || st.st_size < PACK_HEADER_SIZE)
+    {
+        snprintf(err, errSize, "Unable to access packed corpus %s", path);
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+        return -1;
+    }
+
+    void *map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+    {
+        snprintf(err, errSize, "Unable to map packed corpus %s", path);
+        return -1;
+    }
+
+    pc->data = map;
+    pc->length = (size_t)st.st_size;
+    pc->count = (uint32_t)packGetLE(pc->data + 12, 4);
+    uint64_t indexOffset = packGetLE(pc->data + 16, 8);
+
+    if (memcmp(pc->data, PACK_MAGIC, 8) != 0 || packGetLE(pc->data + 8, 4) != PACK_VERSION ||
+        indexOffset > pc->length || (pc->length - indexOffset) / PACK_INDEX_ENTRY_SIZE < pc->count)
+    {
+        snprintf(err, errSize, "%s is not a valid packed corpus (version %d)", path, PACK_VERSION);
+        packClose(pc);
+        return -1;
+    }
+    pc->index = pc->data + indexOffset;
+    return 0;
+}
+
+/**
+ * @brief Unmaps a packed corpus.
+ *
+ * @param pc The corpus to close.
+ */
+void packClose(PackCorpus *pc)
+{
+    if (pc->data != NULL)
+    {
+        munmap((void *)pc->data, pc->length);
+    }
+    memset(pc, 0, sizeof(*pc));
+}
+
+/**
+ * @brief Decodes one puzzle of a packed corpus into a board.
+ *
+ * @param pc The open corpus.
+ * @param index Position of the puzzle in the corpus.
+ * @param board The board to initialise.
+ * @param err Receives the error message on failure.
+ * @param errSize Size of err.
+ * @return 0 on success, or -1 if the record is out of range or corrupt.
+ */
+int packLoadBoard(const PackCorpus *pc, uint32_t index, LatinBoard *board, char *err, size_t errSize)
+{
+    if (index >= pc->count)
+    {
+        snprintf(err, errSize, "puzzle %u is out of range (corpus has %u)", index, pc->count);
+        return -1;
+    }
+
+    const uint8_t *entry = pc->index + (size_t)index * PACK_INDEX_ENTRY_SIZE;
+    uint64_t offset = packGetLE(entry, 8);
+    int order = (int)packGetLE(entry + 8, 2);
+
+    if (order <= 0 || order > MAX_ORDER || offset > pc->length ||
+        pc->length - offset < packRecordSize(order))
+    {
+        snprintf(err, errSize, "puzzle %u has a corrupt index entry", index);
+        return -1;
+    }
+    if (boardInit(board, order) != 0)
+    {
+        snprintf(err, errSize, "unable to allocate a latin square of size %d", order);
+        return -1;
+    }
+
+    const uint8_t *rec = pc->data + offset;
+    int cells = order * order;
+    int bits = packCellBits(order);
+    size_t valueBytes = ((size_t)cells * (size_t)bits + 7) / 8;
+
+    for (int k = 0; k < cells; k++)
+    {
+        size_t bit = (size_t)k * (size_t)bits;
+        unsigned v = 0;
+        for (int b = 0; b < bits; b++, bit++)
+        {
+            v |= (unsigned)((rec[bit >> 3] >> (bit & 7)) & 1u) << b;
+        }
+        int given = (rec[valueBytes + (k >> 3)] >> (k & 7)) & 1u;
+        if (v > (unsigned)order || (given && v == 0))
+        {
+            snprintf(err, errSize, "puzzle %u has a corrupt cell %d", index, k);
+            boardFree(board);
+            return -1;
+        }
+        board->cells[k] = (uint8_t)v;
+        if (given)
+        {
+            board->given[k >> 6] |= 1ull << (k & 63);
+        }
+    }
+
+    boardRebuildMasks(board);
+    return 0;
+}
+
+/**
+ * @brief Runs --pack mode: converts text puzzles into one packed corpus.
+ *
+ * Records are written first, then the index, then the header is filled
+ * in, so the corpus is built in a single pass over the inputs.
+ *
+ * @param outPath The corpus file to create.
+ * @param source A directory or list file of text puzzles, as for --batch.
+ * @return Exit status code: 0 on success, 1 on error.
+ */
+int runPack(const char *outPath, const char *source)
+{
+    int count = 0, packed = 0;
+    char **paths = collectBatchPaths(source, 0, &count);
+    uint8_t *index = calloc((size_t)(count > 0 ? count : 1), PACK_INDEX_ENTRY_SIZE);
+    uint8_t header[PACK_HEADER_SIZE] = {0};
+    uint8_t record[(MAX_ORDER * MAX_ORDER * 7 + 7) / 8 + (MAX_ORDER * MAX_ORDER + 7) / 8];
+    char err[256];
+    FILE *fp = NULL;
+    int status = 1;
+
+    if (paths == NULL || index == NULL)
+    {
+        printf("Error: Unable to read batch %s\n", source);
+        goto done;
+    }
+    fp = fopen(outPath, "wb");
+    if (fp == NULL)
+    {
+        printf("Error : Unable to generate file %s!\n", outPath);
+        goto done;
+    }
+
+    uint64_t offset = PACK_HEADER_SIZE;
+    fwrite(header, 1, sizeof(header), fp);
+    for (int p = 0; p < count; p++)
+    {
+        LatinBoard board;
+        if (paths[p] == NULL || loadLatinSquare(paths[p], &board, err, sizeof(err)) == -1)
+        {
+            printf("Skipping %s: %s\n", paths[p] ? paths[p] : "?", paths[p] ? err : "out of memory");
+            continue;
+        }
+        size_t len = packRecordSize(board.size);
+        packEncodeBoard(&board, record);
+        fwrite(record, 1, len, fp);
+
+        uint8_t *entry = index + (size_t)packed * PACK_INDEX_ENTRY_SIZE;
+        packPutLE(entry, offset, 8);
+        packPutLE(entry + 8, (uint64_t)board.size, 2);
+        packPutLE(entry + 12, len, 4);
+        offset += len;
+        packed++;
+        boardFree(&board);
+    }
+
+    fwrite(index, PACK_INDEX_ENTRY_SIZE, (size_t)packed, fp);
+    memcpy(header, PACK_MAGIC, 8);
+    packPutLE(header + 8, PACK_VERSION, 4);
+    packPutLE(header + 12, (uint64_t)packed, 4);
+    packPutLE(header + 16, offset, 8);
+    if (fseek(fp, 0, SEEK_SET) != 0 || fwrite(header, 1, sizeof(header), fp) != sizeof(header) || ferror(fp))
+    {
+        printf("Error : Unable to write file %s!\n", outPath);
+        goto done;
+    }
+
+    printf("Packed %d of %d puzzles into %s (%llu bytes)\n", packed, count, outPath,
+           (unsigned long long)(offset + (uint64_t)packed * PACK_INDEX_ENTRY_SIZE));
+    status = 0;
+
+done:
+    if (fp != NULL && fclose(fp) != 0)
+    {
+        status = 1;
+    }
+    if (paths != NULL)
+    {
+        for (int p = 0; p < count; p++)
+        {
+            free(paths[p]);
+        }
+    }
+    free(paths);
+    free(index);
+    return status;
+}
+
+/**
+ * @brief Runs --unpack mode: writes every puzzle of a corpus as a text file.
+ *
+ * @param corpusPath The packed corpus to read.
+ * @param outDir Existing directory that receives puzzle-NNNNNN.txt files.
+ * @return Exit status code: 0 on success, 1 on error.
+ */
+int runUnpack(const char *corpusPath, const char *outDir)
+{
+    PackCorpus pack;
+    char err[256];
+    int status = 0;
+    uint32_t unpacked = 0;
+
+    if (packOpen(&pack, corpusPath, err, sizeof(err)) != 0)
+    {
+        printf("Error: %s\n", err);
+        return 1;
+    }
+
+    for (uint32_t p = 0; p < pack.count; p++)
+    {
+        LatinBoard board;
+        char outPath[4096 + 32];
+        if (packLoadBoard(&pack, p, &board, err, sizeof(err)) != 0)
+        {
+            printf("Skipping puzzle %u: %s\n", p, err);
+            status = 1;
+            continue;
+        }
+        snprintf(outPath, sizeof(outPath), "%s/puzzle-%06u.txt", outDir, p);
+        if (saveLatinSquare(&board, outPath) != 0)
+        {
+            printf("Error : Unable to generate file %s!\n", outPath);
+            status = 1;
+        }
+        else
+        {
+            unpacked++;
+        }
+        boardFree(&board);
+    }
+
+    printf("Unpacked %u of %u puzzles into %s (%u skipped)\n", unpacked, pack.count, outDir, pack.count - unpacked);
+    packClose(&pack);
+    return status;
+}
+
+/**
+ * @brief Finds the puzzle an out-<name> file was saved from.
+ *
+ * @return 1 if the base name of path starts with "out-" (out receives
+ *         the path without that prefix), 0 otherwise.
+ */
+static int batchPuzzlePath(const char *path, char *out, size_t outSize)
+{
+    const char *slash = strrchr(path, '/');
+    const char *base = (slash == NULL) ? path : slash + 1;
+    if (strncmp(base, "out-", 4) != 0 || base[4] == '\0')
+    {
+        return 0;
+    }
+    snprintf(out, outSize, "%.*s%s", (int)(base - path), path, base + 4);
+    return 1;
+}
+
+static const char *const batchVerdicts[] = {"valid", "not-latin", "givens-changed"};
+
+/**
+ * @brief Validates the queued squares of a --batch --validate run together and prints their lines.
+ *
+ * The time of the shared check is split evenly between the squares.
+ */
+static void batchFlushSquares(BatchRun *run)
+{
+    ValidateQueue *q = run->queue;
+    double start = monotonicMs();
+    uint32_t valid = multiBoardValidate(&q->multi);
+    double each = (q->elapsed + monotonicMs() - start) / q->multi.count;
+
+    for (int b = 0; b < q->multi.count; b++)
+    {
+        SquareVerdict verdict = !q->givensKept[b] ? SQUARE_GIVEN_CHANGED
+                              : (valid >> b & 1) ? SQUARE_VALID : SQUARE_NOT_LATIN;
+        run->loaded++;
+        run->valid += verdict == SQUARE_VALID;
+        printf("%s\t%d\t%s\t-\t-\t%.3f\n", q->names[b] ? q->names[b] : "?", q->multi.size,
+               batchVerdicts[verdict], each);
+        free(q->names[b]);
+    }
+    q->multi.count = 0;
+    q->elapsed = 0;
+}
+
+/**
+ * @brief Queues a completed square of a --batch --validate run.
+ *
+ * Squares of one order up to MULTI_BOARD_MAX_ORDER are packed into a
+ * MultiBoard and validated MULTI_BOARD_LANES at a time; the givens are
+ * compared right away.
+ */
+static void batchQueueSquare(BatchRun *run, const char *name, const LatinBoard *square, const LatinBoard *puzzle)
+{
+    ValidateQueue *q = run->queue;
+    if (q->multi.count > 0 && (q->multi.count == MULTI_BOARD_LANES || q->multi.size != square->size))
+    {
+        batchFlushSquares(run);
+    }
+    if (q->multi.cells != NULL && q->multi.size != square->size)
+    {
+        multiBoardFree(&q->multi);
+    }
+    if (square->size > MULTI_BOARD_MAX_ORDER ||
+        (q->multi.cells == NULL && multiBoardInit(&q->multi, square->size) != 0))
+    {
+        // large orders gain nothing from interleaving; without memory for it, check alone too
+        double start = monotonicMs();
+        SquareVerdict verdict = validateLatinSquare(square, puzzle);
+        double elapsed = monotonicMs() - start;
+        run->loaded++;
+        run->valid += verdict == SQUARE_VALID;
+        printf("%s\t%d\t%s\t-\t-\t%.3f\n", name, square->size, batchVerdicts[verdict], elapsed);
+        return;
+    }
+
+    double start = monotonicMs();
+    int lane = multiBoardAdd(&q->multi, square);
+    q->givensKept[lane] = puzzle == NULL || givensKept(square, puzzle);
+    q->names[lane] = strdup(name);
+    q->elapsed += monotonicMs() - start;
+}
+
+/**
+ * @brief Checks one loaded puzzle for --batch and prints its result line.
+ *
+ * @param run The batch settings and running totals.
+ * @param name The name printed in the result line.
+ * @param board The loaded puzzle; solved in place for BATCH_SOLVE.
+ * @param outPath Where to save a solution, or NULL to not save it.
+ * @param puzzle For BATCH_VALIDATE, the puzzle whose givens board must
+ *               keep, or NULL.
+ */
+static void batchProcessBoard(BatchRun *run, const char *name, LatinBoard *board, const char *outPath,
+                              const LatinBoard *puzzle)
+{
+    int size = board->size;
+
+    if (run->action == BATCH_VALIDATE)
+    {
+        batchQueueSquare(run, name, board, puzzle);
+        return;
+    }
+
+    int clash = boardHasConflicts(board);
+    const char *status = clash ? "conflict" : (board->filled == size * size) ? "complete" : "open";
+
+    run->loaded++;
+    run->conflicts += clash;
+
+    // the rating goes in an extra column, rated before the board is solved in place
+    char rating[48] = "";
+    if (run->rate)
+    {
+        snprintf(rating, sizeof(rating), "\t-");
+    }
+    if (run->rate && !clash)
+    {
+        PuzzleRating r;
+        double rateStart = monotonicMs();
+        ratePuzzle(board, &r);
+        run->rateMs += monotonicMs() - rateStart;
+        run->rated[r.level]++;
+        snprintf(rating, sizeof(rating), "\t%s:%u", ratingNames[r.level], r.score);
+    }
+
+    if (run->action == BATCH_CHECK || clash)
+    {
+        printf("%s\t%d\t%s\t-\t-\t-%s\n", name, size, status, rating);
+        return;
+    }
+
+    double start = monotonicMs();
+    unsigned long long found = 0, nodes = 0;
+    CanonicalForm form;
+    int cached = -1;
+    int haveForm = run->cache != NULL && run->action == BATCH_SOLVE && canonicalForm(board, &form) == 0;
+    if (haveForm)
+    {
+        cached = solveCacheLookup(run->cache, &form, board);
+    }
+
+    if (cached >= 0)
+    {
+        found = (unsigned long long)cached;
+    }
+    else if (run->action == BATCH_SOLVE && run->threads <= 1)
+    {
+        SolveStats stats;
+        found = (unsigned long long)solveLatinSquare(board, &stats);
+        nodes = stats.nodes;
+    }
+    else if (run->threads > 1)
+    {
+        found = parallelCountSolutions(board, run->threads, run->action == BATCH_SOLVE ? 1 : run->limit,
+                                       board, &nodes);
+    }
+    else
+    {
+        DlxMatrix m;
+        found = (unsigned long long)-1;
+        if (dlxBuild(&m, board) == 0)
+        {
+            found = dlxCountSolutions(&m, run->limit, NULL);
+            nodes = m.nodes;
+            dlxFree(&m);
+        }
+    }
+    double elapsed = monotonicMs() - start;
+
+    if (found == (unsigned long long)-1)
+    {
+        printf("%s\t%d\terror\t-\t-\t-%s\n", name, size, rating);
+        return;
+    }
+    if (haveForm && cached < 0 && solveCacheStore(run->cache, &form, found > 0 ? board : NULL) != 0)
+    {
+        printf("Error: Unable to write the solve cache\n");
+    }
+
+    if (run->action == BATCH_SOLVE && found > 0)
+    {
+        status = (outPath != NULL && saveLatinSquare(board, outPath) != 0) ? "unsaved"
+               : cached > 0 ? "cached" : "solved";
+    }
+    else if (run->action == BATCH_SOLVE)
+    {
+        status = "unsolvable";
+    }
+    run->solved += found > 0;
+
+    printf("%s\t%d\t%s\t%llu\t%llu\t%.3f%s\n", name, size, status, found, nodes, elapsed, rating);
+}
+
+/** @brief The body of runBatch(), run with the thread's board pool in place. */
+static int batchRunAll(const char *path, BatchAction action, unsigned long long limit, int threads,
+                       SolveCache *cache, int rate)
+{
+    ValidateQueue queue = {0};
+    BatchRun run = {action, limit, threads, 0, 0, 0, 0, 0, cache, &queue, rate && action != BATCH_VALIDATE, {0}, 0};
+    const char *noRating = run.rate ? "\t-" : "";
+    int count = 0;
+    double batchStart = monotonicMs();
+    PackCorpus pack;
+    char err[256] = "out of memory";
+
+    if (packIsCorpus(path))
+    {
+        if (packOpen(&pack, path, err, sizeof(err)) != 0)
+        {
+            printf("Error: %s\n", err);
+            return 1;
+        }
+
+        count = (int)pack.count;
+        printf("# file\torder\tstatus\tsolutions\tnodes\tms%s\n", run.rate ? "\trating" : "");
+        for (int p = 0; p < count; p++)
+        {
+            char name[4096 + 16];
+            LatinBoard board;
+            snprintf(name, sizeof(name), "%s#%d", path, p);
+            if (packLoadBoard(&pack, (uint32_t)p, &board, err, sizeof(err)) != 0)
+            {
+                if (queue.multi.count > 0)
+                {
+                    batchFlushSquares(&run);
+                }
+                printf("%s\t-\tunreadable: %s\t-\t-\t-%s\n", name, err, noRating);
+                run.unreadable++;
+                continue;
+            }
+            batchProcessBoard(&run, name, &board, NULL, NULL);
+            boardFree(&board);
+        }
+        packClose(&pack);
+    }
+    else
+    {
+        char **paths = collectBatchPaths(path, action == BATCH_VALIDATE, &count);
+        if (paths == NULL)
+        {
+            printf("Error: Unable to read batch %s\n", path);
+            return 1;
+        }
+
+        printf("# file\torder\tstatus\tsolutions\tnodes\tms%s\n", run.rate ? "\trating" : "");
+        for (int p = 0; p < count; p++)
+        {
+            LatinBoard board;
+            if (paths[p] == NULL || loadLatinSquare(paths[p], &board, err, sizeof(err)) == -1)
+            {
+                if (queue.multi.count > 0)
+                {
+                    batchFlushSquares(&run);
+                }
+                printf("%s\t-\tunreadable: %s\t-\t-\t-%s\n", paths[p] ? paths[p] : "?", err, noRating);
+                run.unreadable++;
+                free(paths[p]);
+                continue;
+            }
+
+            // an out-<name> solution is validated against the givens of <name> when it exists
+            char outPath[4096 + 8];
+            LatinBoard puzzle;
+            int havePuzzle = action == BATCH_VALIDATE && batchPuzzlePath(paths[p], outPath, sizeof(outPath)) &&
+                             loadLatinSquare(outPath, &puzzle, err, sizeof(err)) != -1;
+            batchOutputPath(paths[p], outPath, sizeof(outPath));
+            batchProcessBoard(&run, paths[p], &board, outPath, havePuzzle ? &puzzle : NULL);
+            if (havePuzzle)
+            {
+                boardFree(&puzzle);
+            }
+            boardFree(&board);
+            free(paths[p]);
+        }
+        free(paths);
+    }
+
+    if (action == BATCH_VALIDATE)
+    {
+        if (queue.multi.count > 0)
+        {
+            batchFlushSquares(&run);
+        }
+        multiBoardFree(&queue.multi);
+        printf("# %d squares: %d loaded, %d unreadable, %d valid (%.3f ms)\n",
+               count, run.loaded, run.unreadable, run.valid, monotonicMs() - batchStart);
+        return (run.unreadable == 0 && run.valid == run.loaded) ? 0 : 1;
+    }
+    printf("# %d puzzles: %d loaded, %d unreadable, %d with conflicts, %d solvable (%.3f ms)\n",
+           count, run.loaded, run.unreadable, run.conflicts, run.solved, monotonicMs() - batchStart);
+    if (run.rate)
+    {
+        unsigned long long rated = 0;
+        printf("# ratings:");
+        for (int l = 0; l < RATING_LEVEL_COUNT; l++)
+        {
+            printf(" %llu %s%s", run.rated[l], ratingNames[l], l + 1 < RATING_LEVEL_COUNT ? "," : "");
+            rated += run.rated[l];
+        }
+        printf(" (%.1f us per puzzle)\n", rated > 0 ? run.rateMs * 1000.0 / (double)rated : 0.0);
+    }
+    if (cache != NULL)
+    {
+        printf("# solve cache: %llu hits, %llu misses, %zu entries\n", cache->hits, cache->misses, cache->count);
+    }
+    return run.unreadable == 0 ? 0 : 1;
+}
+
+/**
+ * @brief Runs --batch mode over many puzzles in one process.
+ *
+ * The puzzles come from a packed corpus, a directory or a list file.
+ * Every puzzle is checked for clashing values; depending on action it
+ * is then solved or its completions are counted. Solutions of text
+ * puzzles are saved as out-<name> next to them. BATCH_VALIDATE instead
+ * audits completed squares, checking each out-<name> file against the
+ * givens of <name> when that file exists. One tab separated result line
+ * is printed per puzzle, followed by a summary. No input is read from
+ * the player. Boards come from a private pool, so a run of same-order
+ * puzzles reuses one storage block. With a solve cache, BATCH_SOLVE
+ * takes the solution of any puzzle equivalent, up to row, column and
+ * value permutations, to one solved before, and records new ones.
+ *
+ * @param path A packed corpus, a directory of puzzles or a list file of paths ("-" = stdin).
+ * @param action What to do with each valid puzzle.
+ * @param limit Solution limit for BATCH_COUNT, 0 for no limit.
+ * @param threads Number of worker threads used by the solver.
+ * @param cachePath The solve cache file, or NULL for none.
+ * @return Exit status code: 0 if every puzzle loaded (and, for
+ *         BATCH_VALIDATE, is valid), 1 otherwise.
+ */
+int runBatch(const char *path, BatchAction action, unsigned long long limit, int threads, const char *cachePath,
+             int rate)
+{
+    BoardPool pool;
+    SolveCache cache;
+    if (cachePath != NULL && solveCacheOpen(&cache, cachePath) != 0)
+    {
+        printf("Error: Unable to open the solve cache %s\n", cachePath);
+        return 1;
+    }
+
+    int pooled = (boardPoolInit(&pool, 0) == 0);
+    if (pooled)
+    {
+        boardPoolUseForThread(&pool);
+    }
+    int status = batchRunAll(path, action, limit, threads, cachePath != NULL ? &cache : NULL, rate);
+    if (pooled)
+    {
+        boardPoolDestroy(&pool);
+    }
+    if (cachePath != NULL)
+    {
+        solveCacheClose(&cache);
+    }
+    return status;
+}
+
+/**
+ * @brief Advances a splitmix64 generator and returns its next output.
+ *
+ * @param state The generator state, updated in place.
+ * @return 64 pseudo-random bits.
+ */
+uint64_t rngNext(uint64_t *state)
+{
+    uint64_t z = (*state += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+/** @brief Index of entry (i,j,k) of the order-n incidence cube. */
+#define CUBE_AT(n, i, j, k) (((i) * (n) + (j)) * (n) + (k))
+
+/**
+ * @brief Picks one of the (one or two) positions on a line of the cube holding a 1.
+ *
+ * @param cube The incidence cube.
+ * @param base Index of the line's first entry.
+ * @param stride Distance between consecutive entries of the line.
+ * @param n The order.
+ * @param rng The generator used to break the tie.
+ * @return The position along the line.
+ */
+static int cubePickOne(const int8_t *cube, int base, int stride, int n, uint64_t *rng)
+{
+    int found[2] = {0, 0}, count = 0;
+    for (int t = 0; t < n && count < 2; t++)
+    {
+        if (cube[base + t * stride] == 1)
+        {
+            found[count++] = t;
+        }
+    }
+    return (count == 2) ? found[rngNext(rng) & 1] : found[0];
+}
+
+/**
+ * @brief Fills a board with a uniformly random Latin square.
+ *
+ * Runs the Jacobson–Matthews Markov chain on the incidence cube of
+ * the square (entry (i,j,k) is 1 when cell (i,j) holds k+1), starting
+ * from the cyclic square. Every move rotates a 2x2x2 sub-cube; the
+ * chain may pass through "improper" squares with a single -1 entry and
+ * is only stopped on a proper one, after order^3 moves.
+ *
+ * @param board An empty board of the wanted order; filled and every cell marked as given.
+ * @param cube Scratch space for order^3 entries.
+ * @param rng The generator driving the chain.
+ * @return 0 on success.
+ */
+int randomLatinSquare(LatinBoard *board, int8_t *cube, uint64_t *rng)
+{
+    int n = board->size;
+    int bi = 0, bj = 0, bk = 0;  // the -1 entry while the square is improper
+    int improper = 0;
+    long long steps = (long long)n * n * n;
+
+    memset(cube, 0, (size_t)n * n * n);
+    for (int i = 0; i < n; i++)
+    {
+        for (int j = 0; j < n; j++)
+        {
+            cube[CUBE_AT(n, i, j, (i + j) % n)] = 1;
+        }
+    }
+
+    for (long long step = 0; n > 1 && (step < steps || improper); step++)
+    {
+        int i, j, k;
+        if (improper)
+        {
+            i = bi;
+            j = bj;
+            k = bk;
+        }
+        else
+        {
+            do
+            {
+                i = (int)(rngNext(rng) % (uint64_t)n);
+                j = (int)(rngNext(rng) % (uint64_t)n);
+                k = (int)(rngNext(rng) % (uint64_t)n);
+            } while (cube[CUBE_AT(n, i, j, k)] != 0);
+        }
+
+        int i2 = cubePickOne(cube, CUBE_AT(n, 0, j, k), n * n, n, rng);
+        int j2 = cubePickOne(cube, CUBE_AT(n, i, 0, k), n, n, rng);
+        int k2 = cubePickOne(cube, CUBE_AT(n, i, j, 0), 1, n, rng);
+
+        cube[CUBE_AT(n, i, j, k)]++;
+        cube[CUBE_AT(n, i, j2, k2)]++;
+        cube[CUBE_AT(n, i2, j, k2)]++;
+        cube[CUBE_AT(n, i2, j2, k)]++;
+        cube[CUBE_AT(n, i, j, k2)]--;
+        cube[CUBE_AT(n, i, j2, k)]--;
+        cube[CUBE_AT(n, i2, j, k)]--;
+        cube[CUBE_AT(n, i2, j2, k2)]--;
+
+        improper = cube[CUBE_AT(n, i2, j2, k2)] < 0;
+        bi = i2;
+        bj = j2;
+        bk = k2;
+    }
+
+    for (int i = 0; i < n; i++)
+    {
+        for (int j = 0; j < n; j++)
+        {
+            int k = 0;
+            while (cube[CUBE_AT(n, i, j, k)] != 1)
+            {
+                k++;
+            }
+            int c = i * n + j;
+            boardPlace(board, i, j, k + 1);
+            board->given[c >> 6] |= 1ull << (c & 63);
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Returns non-zero if the other cells force val into the empty cell (i,j).
+ *
+ * True when val is the cell's only candidate, or when no other empty
+ * cell of its row or column can take val. Removing a given that is
+ * forced this way cannot add a solution, so no search is needed.
+ */
+static int generateForced(const LatinBoard *board, int i, int j, int val)
+{
+    uint64_t bit = 1ull << (val - 1);
+    if (boardCandidates(board, i, j) == bit)
+    {
+        return 1;
+    }
+
+    int inRow = 0, inCol = 0;
+    for (int t = 0; t < board->size; t++)
+    {
+        inRow |= t != j && boardGet(board, i, t) == 0 && (boardCandidates(board, i, t) & bit);
+        inCol |= t != i && boardGet(board, t, j) == 0 && (boardCandidates(board, t, j) & bit);
+    }
+    return !inRow || !inCol;
+}
+
+/**
+ * @brief Removes the placement of val in cell from a dancing-links matrix.
+ *
+ * The matrix rows are never covered at this point, so unlinking the
+ * row's nodes from their columns takes it out of every search.
+ */
+static void generateDropPlacement(DlxMatrix *m, int cell, int val)
+{
+    for (int x = m->numCols + 1; x < m->nodeCount; x++)
+    {
+        int r = m->nodeRow[x];
+        if (m->rowCell[r] == cell && m->rowVal[r] == val)
+        {
+            m->down[m->up[x]] = m->down[x];
+            m->up[m->down[x]] = m->up[x];
+            m->colSize[m->column[x]]--;
+        }
+    }
+}
+
+/**
+ * @brief Turns a full square into a puzzle with a unique solution.
+ *
+ * Givens are removed in random order; a removal is kept if the value
+ * is forced by the remaining cells, or otherwise only if the
+ * dancing-links engine finds no completion with another value in the
+ * cell within GENERATE_NODE_BUDGET search nodes. The square itself is
+ * the one completion with val there, so that proves the solution is
+ * still unique. A check that runs out of budget keeps the given, and
+ * once the checks of the puzzle have used GENERATE_PUZZLE_BUDGET nodes
+ * only forced removals are made, which bounds the time of large orders.
+ * Stops once targetGivens are left or no further given can be removed.
+ *
+ * @param board A full board whose cells are all givens.
+ * @param targetGivens The number of givens to stop at.
+ * @param rng The generator that orders the removals.
+ * @return 0 on success, -1 on allocation failure.
+ */
+int makePuzzle(LatinBoard *board, int targetGivens, uint64_t *rng)
+{
+    int n = board->size;
+    int cells = n * n;
+    int order[MAX_ORDER * MAX_ORDER];
+
+    for (int c = 0; c < cells; c++)
+    {
+        order[c] = c;
+    }
+    for (int c = cells - 1; c > 0; c--)
+    {
+        int r = (int)(rngNext(rng) % (uint64_t)(c + 1));
+        int t = order[c];
+        order[c] = order[r];
+        order[r] = t;
+    }
+
+    unsigned long long budget = GENERATE_PUZZLE_BUDGET;
+    for (int c = 0; c < cells && board->filled > targetGivens; c++)
+    {
+        int unique = 1;
+        int i = order[c] / n, j = order[c] % n;
+        int val = boardGet(board, i, j);
+        boardClear(board, i, j);
+
+        if (!generateForced(board, i, j, val))
+        {
+            unique = 0;
+            if (budget > 0)
+            {
+                DlxMatrix m;
+                if (dlxBuild(&m, board) != 0)
+                {
+                    return -1;
+                }
+                generateDropPlacement(&m, order[c], val);
+                m.nodeLimit = (budget < GENERATE_NODE_BUDGET) ? budget : GENERATE_NODE_BUDGET;
+                unique = dlxCountSolutions(&m, 1, NULL) == 0 && m.nodes < m.nodeLimit;
+                budget -= (m.nodes < budget) ? m.nodes : budget;
+                dlxFree(&m);
+            }
+        }
+
+        if (unique)
+        {
+            board->given[order[c] >> 6] &= ~(1ull << (order[c] & 63));
+        }
+        else
+        {
+            boardPlace(board, i, j, val);
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Writes puzzle p to stdout in index order, holding it back while an earlier one is unfinished.
+ *
+ * A worker whose puzzle is more than the window ahead waits, so the
+ * held records stay bounded; the puzzle next in order never waits.
+ *
+ * @param run The run.
+ * @param p Index of the puzzle.
+ * @param text Its record, or NULL if it could not be generated.
+ * @param len Length of the record.
+ */
+static void generateEmit(GenerateRun *run, int p, const char *text, size_t len)
+{
+    pthread_mutex_lock(&run->outputLock);
+    while (p >= run->emittedCount + run->window)
+    {
+        pthread_cond_wait(&run->emitted, &run->outputLock);
+    }
+    int slot = p % run->window;
+    if (p != run->emittedCount)
+    {
+        if (text != NULL)
+        {
+            memcpy(run->held + (size_t)slot * SAVE_BUFFER_SIZE, text, len);
+        }
+        run->heldLength[slot] = (text != NULL) ? len : 0;
+        pthread_mutex_unlock(&run->outputLock);
+        return;
+    }
+
+    if (text != NULL)
+    {
+        fwrite(text, 1, len, stdout);
+    }
+    run->emittedCount++;
+    for (slot = run->emittedCount % run->window; run->heldLength[slot] != GENERATE_SLOT_EMPTY;
+         slot = run->emittedCount % run->window)
+    {
+        fwrite(run->held + (size_t)slot * SAVE_BUFFER_SIZE, 1, run->heldLength[slot], stdout);
+        run->heldLength[slot] = GENERATE_SLOT_EMPTY;
+        run->emittedCount++;
+    }
+    pthread_cond_broadcast(&run->emitted);
+    pthread_mutex_unlock(&run->outputLock);
+}
+
+/** @brief Thread body of --generate: builds puzzles until the run's count is reached. */
+static void *generateWorkerMain(void *arg)
+{
+    GenerateRun *run = arg;
+    int n = run->order;
+    int8_t *cube = malloc((size_t)n * n * n);
+    char *text = malloc(SAVE_BUFFER_SIZE);
+    BoardPool pool;
+    if (boardPoolInit(&pool, 0) == 0)
+    {
+        boardPoolUseForThread(&pool);
+    }
+
+    for (int p; cube != NULL && text != NULL && (p = atomic_fetch_add(&run->next, 1)) < run->count;)
+    {
+        // each puzzle has its own generator state so the output does not depend on the thread count
+        uint64_t rng = run->seed ^ ((uint64_t)(p + 1) * 0xD1B54A32D192ED03ull);
+        LatinBoard board;
+        if (boardInit(&board, n) != 0 || randomLatinSquare(&board, cube, &rng) != 0 ||
+            makePuzzle(&board, run->targetGivens, &rng) != 0)
+        {
+            boardFree(&board);
+            atomic_fetch_add(&run->failed, 1);
+            generateEmit(run, p, NULL, 0);
+            continue;
+        }
+
+        size_t len = formatLatinSquare(&board, text);
+        atomic_fetch_add(&run->givens, board.filled);
+        atomic_fetch_add(&run->made, 1);
+        generateEmit(run, p, text, len);
+        boardFree(&board);
+    }
+
+    if (cube == NULL || text == NULL)
+    {
+        atomic_fetch_add(&run->failed, 1);
+    }
+    free(cube);
+    free(text);
+    boardPoolDestroy(&pool);
+    return NULL;
+}
+
+/**
+ * @brief Runs --generate mode: writes random puzzles with unique solutions to stdout.
+ *
+ * The puzzles are written back to back in the input file format with
+ * givens stored as negative values, in index order: a puzzle finished
+ * early is held back until those before it are out, so the output is
+ * the same for any thread count.
+ * A one line summary goes to stderr so stdout stays a clean stream.
+ *
+ * @param order The order of the puzzles, [1..MAX_ORDER].
+ * @param difficulty "easy", "medium", "hard", "minimal" or the percentage of cells to keep as givens.
+ * @param count Number of puzzles.
+ * @param seed Seed of the run; the same seed gives the same puzzles.
+ * @param threads Number of worker threads.
+ * @return Exit status code: 0 on success, 1 on bad arguments or failures.
+ */
+int runGenerate(int order, const char *difficulty, int count, uint64_t seed, int threads)
+{
+    static const struct { const char *name; int percent; } levels[] = {
+        {"easy", 60}, {"medium", 45}, {"hard", 35}, {"minimal", 0}
+    };
+    int percent = -1;
+    char *end;
+
+    for (size_t l = 0; l < sizeof(levels) / sizeof(levels[0]); l++)
+    {
+        if (strcmp(difficulty, levels[l].name) == 0)
+        {
+            percent = levels[l].percent;
+        }
+    }
+    if (percent < 0)
+    {
+        long v = strtol(difficulty, &end, 10);
+        percent = (*end == '\0' && difficulty[0] != '\0' && v >= 0 && v <= 100) ? (int)v : -1;
+    }
+    if (order < 1 || order > MAX_ORDER || percent < 0 || count < 0)
+    {
+        printf("Error: --generate expects an order in [1..%d], a difficulty (easy, medium, hard, minimal "
+               "or a percentage of givens) and a count\n", MAX_ORDER);
+        return 1;
+    }
+
+    GenerateRun run;
+    run.order = order;
+    run.targetGivens = order * order * percent / 100;
+    run.count = count;
+    run.seed = seed;
+    atomic_init(&run.next, 0);
+    atomic_init(&run.made, 0);
+    atomic_init(&run.failed, 0);
+    atomic_init(&run.givens, 0);
+    pthread_mutex_init(&run.outputLock, NULL);
+    pthread_cond_init(&run.emitted, NULL);
+    run.emittedCount = 0;
+    run.window = 2 * (threads > 0 ? threads : 1);
+    run.held = malloc((size_t)run.window * SAVE_BUFFER_SIZE);
+    run.heldLength = malloc((size_t)run.window * sizeof(size_t));
+    if (run.held == NULL || run.heldLength == NULL)
+    {
+        printf("Error: Unable to allocate memory for the generated puzzles\n");
+        free(run.held);
+        free(run.heldLength);
+        pthread_mutex_destroy(&run.outputLock);
+        pthread_cond_destroy(&run.emitted);
+        return 1;
+    }
+    for (int slot = 0; slot < run.window; slot++)
+    {
+        run.heldLength[slot] = GENERATE_SLOT_EMPTY;
+    }
+
+    double start = monotonicMs();
+    pthread_t *pool = calloc((size_t)threads, sizeof(pthread_t));
+    int started = 0;
+    for (; pool != NULL && started < threads; started++)
+    {
+        if (pthread_create(&pool[started], NULL, generateWorkerMain, &run) != 0)
+        {
+            break;
+        }
+    }
+    if (started == 0)
+    {
+        // no pool at all: generate on this thread
+        generateWorkerMain(&run);
+    }
+    for (int t = 0; t < started; t++)
+    {
+        pthread_join(pool[t], NULL);
+    }
+    free(pool);
+    pthread_mutex_destroy(&run.outputLock);
+    pthread_cond_destroy(&run.emitted);
+    free(run.held);
+    free(run.heldLength);
+    fflush(stdout);
+
+    int made = atomic_load(&run.made);
+    fprintf(stderr, "Generated %d puzzles of order %d, %.1f givens on average, seed %llu (%.3f ms)\n",
+            made, order, made > 0 ? (double)atomic_load(&run.givens) / made : 0.0,
+            (unsigned long long)seed, monotonicMs() - start);
+    return (made == count && atomic_load(&run.failed) == 0) ? 0 : 1;
+}
+
+/**
+ * @brief Runs --validate mode on one loaded square and reports the verdict.
+ *
+ * @param square The loaded square.
+ * @param path The file it was loaded from; for an out-<name> file the
+ *             givens of <name> are checked as well, if it exists.
+ * @return Exit status code: 0 if valid, 2 otherwise.
+ */
+int runValidate(const LatinBoard *square, const char *path)
+{
+    static const char *messages[] = {
+        "Valid Latin square",
+        "Not a Latin square: some row or column does not hold every value once",
+        "Givens changed: a given of the puzzle was lost or altered"
+    };
+    char puzzlePath[4096];
+    char err[256];
+    LatinBoard puzzle;
+    int havePuzzle = batchPuzzlePath(path, puzzlePath, sizeof(puzzlePath)) &&
+                     loadLatinSquare(puzzlePath, &puzzle, err, sizeof(err)) != -1;
+
+    SquareVerdict verdict = validateLatinSquare(square, havePuzzle ? &puzzle : NULL);
+    printf("%s\n", messages[verdict]);
+    if (havePuzzle)
+    {
+        printf("Givens checked against %s\n", puzzlePath);
+        boardFree(&puzzle);
+    }
+    return verdict == SQUARE_VALID ? 0 : 2;
+}
+
+/** @brief Prepares an empty queue. */
+static void spscInit(SpscQueue *q)
+{
+    atomic_init(&q->head, 0);
+    atomic_init(&q->tail, 0);
+    atomic_init(&q->sleeping, 0);
+    pthread_mutex_init(&q->lock, NULL);
+    pthread_cond_init(&q->wake, NULL);
+}
+
+/** @brief Releases the lock and condition of a queue. */
+static void spscDestroy(SpscQueue *q)
+{
+    pthread_mutex_destroy(&q->lock);
+    pthread_cond_destroy(&q->wake);
+}
+
+/** @brief Returns non-zero once the counter a waiting side watches has moved on from stuck. */
+static int spscMoved(const _Atomic size_t *counter, size_t stuck)
+{
+    return atomic_load_explicit(counter, memory_order_acquire) != stuck;
+}
+
+/**
+ * @brief Waits until the counter moves on from stuck, polling a little before sleeping.
+ *
+ * The sleeper announces itself before its last look at the counter, and
+ * the other side advances the counter before it looks for a sleeper, so
+ * one of the two always sees the other and no wake-up is lost.
+ */
+static void spscWait(SpscQueue *q, const _Atomic size_t *counter, size_t stuck)
+{
+    for (int spin = 0; spin < SPSC_SPIN_LIMIT; spin++)
+    {
+        if (spscMoved(counter, stuck))
+        {
+            return;
+        }
+        sched_yield();
+    }
+
+    pthread_mutex_lock(&q->lock);
+    atomic_fetch_add(&q->sleeping, 1);
+    atomic_thread_fence(memory_order_seq_cst);
+    while (!spscMoved(counter, stuck))
+    {
+        pthread_cond_wait(&q->wake, &q->lock);
+    }
+    atomic_fetch_sub(&q->sleeping, 1);
+    pthread_mutex_unlock(&q->lock);
+}
+
+/** @brief Wakes the other side of a queue if it went to sleep waiting for this one. */
+static void spscWake(SpscQueue *q)
+{
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load_explicit(&q->sleeping, memory_order_relaxed) != 0)
+    {
+        pthread_mutex_lock(&q->lock);
+        pthread_cond_broadcast(&q->wake);
+        pthread_mutex_unlock(&q->lock);
+    }
+}
+
+/** @brief Adds an item to a queue, waiting while it is full; producer side only. */
+static void spscPush(SpscQueue *q, uint32_t item)
+{
+    size_t tail = atomic_load_explicit(&q->tail, memory_order_relaxed);
+    size_t head = atomic_load_explicit(&q->head, memory_order_acquire);
+    if (tail - head == STREAM_QUEUE_CAPACITY)
+    {
+        spscWait(q, &q->head, head);
+    }
+    q->items[tail & (STREAM_QUEUE_CAPACITY - 1)] = item;
+    atomic_store_explicit(&q->tail, tail + 1, memory_order_release);
+    spscWake(q);
+}
+
+/** @brief Takes the oldest item of a queue, waiting while it is empty; consumer side only. */
+static uint32_t spscPop(SpscQueue *q)
+{
+    size_t head = atomic_load_explicit(&q->head, memory_order_relaxed);
+    if (atomic_load_explicit(&q->tail, memory_order_acquire) == head)
+    {
+        spscWait(q, &q->tail, head);
+    }
+    uint32_t item = q->items[head & (STREAM_QUEUE_CAPACITY - 1)];
+    atomic_store_explicit(&q->head, head + 1, memory_order_release);
+    spscWake(q);
+    return item;
+}
+
+/**
+ * @brief Parse stage: reads the input in fixed chunks and parses one record per free slot.
+ *
+ * The parse window always ends at whitespace unless the input is over,
+ * so no number is cut in two; a record running past the window is
+ * parsed again once more input is in.
+ */
+static void *streamParseMain(void *arg)
+{
+    StreamPipeline *sp = arg;
+    size_t have = 0, start = 0;
+    int atEof = 0, line = 1;
+
+    // slots are parsed and freed on this thread only, so their storage can come from a private pool
+    if (boardPoolInit(&sp->parserPool, 0) == 0)
+    {
+        boardPoolUseForThread(&sp->parserPool);
+    }
+
+    for (;;)
+    {
+        // skip to the record's size so its line is known, then keep whole numbers only
+        while (start < have && strchr(" \t\n\r\v\f", sp->buffer[start]) != NULL)
+        {
+            line += sp->buffer[start++] == '\n';
+        }
+        size_t end = have;
+        while (!atEof && end > start && strchr(" \t\n\r\v\f", sp->buffer[end - 1]) == NULL)
+        {
+            end--;
+        }
+
+        ParseCursor cur = {sp->buffer + start, sp->buffer + end, line, sp->buffer + start};
+        LatinBoard board;
+        char err[sizeof(sp->error)];
+        int n = parseLatinSquare(&cur, &board, err, sizeof(err));
+
+        if (n > 0)
+        {
+            uint32_t id = spscPop(&sp->free);
+            StreamSlot *slot = &sp->slots[id];
+            boardFree(&slot->board);
+            slot->board = board;
+            slot->record = ++sp->records;
+            slot->line = line;
+            spscPush(&sp->parsed, id);
+            start = (size_t)(cur.pos - sp->buffer);
+            line = cur.line;
+            continue;
+        }
+        if (n < 0 && (atEof || cur.pos < cur.end))
+        {
+            // the problem lies inside data already read, more input will not fix it
+            snprintf(sp->error, sizeof(sp->error), "%s", err);
+            break;
+        }
+        if (atEof)
+        {
+            break;
+        }
+
+        // the record runs past the window: keep its start and read more
+        memmove(sp->buffer, sp->buffer + start, have - start);
+        have -= start;
+        start = 0;
+        if (have == STREAM_BUFFER_SIZE)
+        {
+            snprintf(sp->error, sizeof(sp->error), "line %d: record larger than %d bytes", line, STREAM_BUFFER_SIZE);
+            break;
+        }
+        ssize_t got = read(sp->fd, sp->buffer + have, STREAM_BUFFER_SIZE - have);
+        if (got < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (got <= 0)
+        {
+            atEof = 1;
+        }
+        else
+        {
+            have += (size_t)got;
+        }
+    }
+
+    spscPush(&sp->parsed, STREAM_END);
+    boardPoolUseForThread(NULL);
+    return NULL;
+}
+
+/** @brief Validate stage: classifies every record as conflict, complete (valid or not) or open. */
+static void *streamValidateMain(void *arg)
+{
+    StreamPipeline *sp = arg;
+    for (;;)
+    {
+        uint32_t id = spscPop(&sp->parsed);
+        if (id != STREAM_END)
+        {
+            StreamSlot *slot = &sp->slots[id];
+            int size = slot->board.size;
+            double begin = monotonicMs();
+            if (boardHasConflicts(&slot->board))
+            {
+                slot->status = STREAM_CONFLICT;
+            }
+            else if (slot->board.filled == size * size)
+            {
+                slot->status = (validateLatinSquare(&slot->board, NULL) == SQUARE_VALID) ? STREAM_COMPLETE
+                                                                                          : STREAM_CONFLICT;
+            }
+            else
+            {
+                slot->status = STREAM_OPEN;
+            }
+            slot->elapsed = monotonicMs() - begin;
+        }
+        spscPush(&sp->checked, id);
+        if (id == STREAM_END)
+        {
+            return NULL;
+        }
+    }
+}
+
+/** @brief Solve stage: counts the completions of every open record with the dancing-links engine. */
+static void *streamSolveMain(void *arg)
+{
+    StreamPipeline *sp = arg;
+    for (;;)
+    {
+        uint32_t id = spscPop(&sp->checked);
+        if (id != STREAM_END && sp->slots[id].status == STREAM_OPEN)
+        {
+            StreamSlot *slot = &sp->slots[id];
+            double begin = monotonicMs();
+            DlxMatrix m;
+            slot->solutions = 0;
+            slot->nodes = 0;
+            if (dlxBuild(&m, &slot->board) != 0)
+            {
+                slot->status = STREAM_ERROR;
+            }
+            else
+            {
+                slot->solutions = dlxCountSolutions(&m, sp->limit, &slot->board);
+                slot->nodes = m.nodes;
+                slot->status = slot->solutions > 0 ? STREAM_SOLVED : STREAM_UNSOLVABLE;
+                dlxFree(&m);
+            }
+            slot->elapsed += monotonicMs() - begin;
+        }
+        spscPush(&sp->solved, id);
+        if (id == STREAM_END)
+        {
+            return NULL;
+        }
+    }
+}
+
+/**
+ * @brief Runs --stream mode: checks and solves a stream of back-to-back records.
+ *
+ * Parsing, validation and solving run on three threads connected by
+ * bounded single-producer/single-consumer queues; this thread prints
+ * one tab separated line per record and hands the slot back to the
+ * parser. STREAM_SLOTS boards and one STREAM_BUFFER_SIZE input buffer
+ * are all the memory used, whatever the length of the input.
+ *
+ * @param path The input file, or "-" for standard input.
+ * @param limit Count completions of open records up to this many, 0 to stop at the first.
+ * @return Exit status code: 0 if the whole input was read, 1 otherwise.
+ */
+int runStream(const char *path, unsigned long long limit)
+{
+    static const char *statusNames[] = {"conflict", "complete", "open", "solved", "unsolvable", "error"};
+    StreamPipeline *sp = calloc(1, sizeof(StreamPipeline));
+    pthread_t stages[3];
+    void *(*bodies[3])(void *) = {streamParseMain, streamValidateMain, streamSolveMain};
+    int failed = -1;
+    unsigned long long totals[6] = {0};
+    double begin = monotonicMs();
+
+    if (sp == NULL || (sp->buffer = malloc(STREAM_BUFFER_SIZE)) == NULL)
+    {
+        printf("Error: Unable to allocate memory for the stream\n");
+        free(sp);
+        return 1;
+    }
+    sp->fd = (strcmp(path, "-") == 0) ? STDIN_FILENO : open(path, O_RDONLY);
+    if (sp->fd < 0)
+    {
+        printf("Error: Unable to access file %s\n", path);
+        free(sp->buffer);
+        free(sp);
+        return 1;
+    }
+    sp->limit = (limit == 0) ? 1 : limit;
+    SpscQueue *outputs[3] = {&sp->parsed, &sp->checked, &sp->solved};
+    spscInit(&sp->free);
+    for (int t = 0; t < 3; t++)
+    {
+        spscInit(outputs[t]);
+    }
+    for (uint32_t id = 0; id < STREAM_SLOTS; id++)
+    {
+        spscPush(&sp->free, id);
+    }
+
+    // start from the last stage, so a stage that fails to start has only later stages running
+    for (int t = 2; t >= 0; t--)
+    {
+        if (pthread_create(&stages[t], NULL, bodies[t], sp) != 0)
+        {
+            failed = t;
+            break;
+        }
+    }
+    if (failed >= 0)
+    {
+        // end the input in place of the missing stage so the running ones drain and stop
+        printf("Error: Unable to start the stream pipeline\n");
+        spscPush(outputs[failed], STREAM_END);
+    }
+    else
+    {
+        printf("# record\tline\torder\tstatus\tsolutions\tnodes\tms\n");
+    }
+    for (;;)
+    {
+        uint32_t id = spscPop(&sp->solved);
+        if (id == STREAM_END)
+        {
+            break;
+        }
+        StreamSlot *slot = &sp->slots[id];
+        totals[slot->status]++;
+        if (slot->status == STREAM_SOLVED || slot->status == STREAM_UNSOLVABLE)
+        {
+            printf("%llu\t%d\t%d\t%s\t%llu\t%llu\t%.3f\n", slot->record, slot->line, slot->board.size,
+                   statusNames[slot->status], slot->solutions, slot->nodes, slot->elapsed);
+        }
+        else
+        {
+            printf("%llu\t%d\t%d\t%s\t-\t-\t%.3f\n", slot->record, slot->line, slot->board.size,
+                   statusNames[slot->status], slot->elapsed);
+        }
+        spscPush(&sp->free, id);
+    }
+
+    for (int t = failed + 1; t < 3; t++)
+    {
+        pthread_join(stages[t], NULL);
+    }
+
+    int status = (failed >= 0);
+    if (sp->error[0] != '\0')
+    {
+        printf("# stopped after record %llu: %s\n", sp->records, sp->error);
+        status = 1;
+    }
+    printf("# %llu records: %llu with conflicts, %llu complete, %llu solved, %llu unsolvable (%.3f ms)\n",
+           sp->records, totals[STREAM_CONFLICT], totals[STREAM_COMPLETE], totals[STREAM_SOLVED],
+           totals[STREAM_UNSOLVABLE], monotonicMs() - begin);
+
+    for (int s = 0; s < STREAM_SLOTS; s++)
+    {
+        boardFree(&sp->slots[s].board);
+    }
+    spscDestroy(&sp->free);
+    for (int t = 0; t < 3; t++)
+    {
+        spscDestroy(outputs[t]);
+    }
+    boardPoolDestroy(&sp->parserPool);
+    if (sp->fd != STDIN_FILENO)
+    {
+        close(sp->fd);
+    }
+    free(sp->buffer);
+    free(sp);
+    return status;
+}
+
+/** @brief FNV-1a hash of a player name or puzzle path. */
+static uint64_t analyzeHash(const char *s, size_t len)
+{
+    uint64_t h = 0xCBF29CE484222325ull;
+    for (size_t k = 0; k < len; k++)
+    {
+        h = (h ^ (uint8_t)s[k]) * 0x100000001B3ull;
+    }
+    return h;
+}
+
+/**
+ * @brief Finds the totals of a player, adding an empty entry the first time.
+ *
+ * @return The entry, or NULL if the table could not grow.
+ */
+static PlayerStats *playerTableFind(PlayerTable *t, const char *name, uint32_t len, uint64_t hash)
+{
+    if ((t->count + 1) * 4 > t->capacity * 3)
+    {
+        size_t capacity = t->capacity ? t->capacity * 2 : 1024;
+        PlayerStats *slots = calloc(capacity, sizeof(PlayerStats));
+        if (slots == NULL)
+        {
+            return NULL;
+        }
+        for (size_t s = 0; s < t->capacity; s++)
+        {
+            if (t->slots[s].name != NULL)
+            {
+                size_t k = t->slots[s].hash & (capacity - 1);
+                while (slots[k].name != NULL)
+                {
+                    k = (k + 1) & (capacity - 1);
+                }
+                slots[k] = t->slots[s];
+            }
+        }
+        free(t->slots);
+        t->slots = slots;
+        t->capacity = capacity;
+    }
+
+    size_t k = hash & (t->capacity - 1);
+    while (t->slots[k].name != NULL)
+    {
+        PlayerStats *p = &t->slots[k];
+        if (p->hash == hash && p->nameLen == len && memcmp(p->name, name, len) == 0)
+        {
+            return p;
+        }
+        k = (k + 1) & (t->capacity - 1);
+    }
+    PlayerStats *p = &t->slots[k];
+    p->name = name;
+    p->nameLen = len;
+    p->hash = hash;
+    p->bestMs = UINT64_MAX;
+    t->count++;
+    return p;
+}
+
+/** @brief Returns where a chunk of the log starts: the first session header at or after its share of the bytes. */
+static size_t analyzeSessionStart(const AnalyzeRun *run, int chunk)
+{
+    if (chunk <= 0)
+    {
+        return 0;
+    }
+    size_t p = (chunk >= run->chunks) ? run->length : (size_t)((uint64_t)run->length * (uint64_t)chunk / (uint64_t)run->chunks);
+    p = (p > 0) ? p : 1;   // the log's first byte always belongs to chunk 0
+    while (p < run->length && !(run->data[p] == '@' && run->data[p - 1] == '\n'))
+    {
+        const char *nl = memchr(run->data + p, '\n', run->length - p);
+        p = (nl != NULL) ? (size_t)(nl - run->data) + 1 : run->length;
+    }
+    return p;
+}
+
+/** @brief Returns the loaded puzzle of a session, loading it on first use; NULL if unreadable. */
+static AnalyzePuzzle *analyzePuzzle(AnalyzeWorker *w, const char *path, size_t len)
+{
+    AnalyzePuzzle *ap = &w->puzzles[analyzeHash(path, len) % ANALYZE_PUZZLE_SLOTS];
+    if (ap->path != NULL && strlen(ap->path) == len && memcmp(ap->path, path, len) == 0)
+    {
+        return ap->loaded > 0 ? ap : NULL;
+    }
+
+    if (ap->loaded > 0)
+    {
+        boardFree(&ap->work);
+        boardFree(&ap->puzzle);
+    }
+    free(ap->path);
+    ap->loaded = -1;
+    ap->path = strndup(path, len);
+    char err[256];
+    if (ap->path == NULL)
+    {
+        w->failed = 1;
+        return NULL;
+    }
+    if (loadLatinSquare(ap->path, &ap->puzzle, err, sizeof(err)) == -1)
+    {
+        return NULL;
+    }
+    if (boardCopy(&ap->work, &ap->puzzle) != 0)
+    {
+        boardFree(&ap->puzzle);
+        w->failed = 1;
+        return NULL;
+    }
+    ap->loaded = 1;
+    return ap;
+}
+
+/**
+ * @brief Replays one session of a move log and adds it to its player's totals.
+ *
+ * @param w The worker.
+ * @param p The "@ <player> <puzzle>" header line of the session.
+ * @param end Start of the next session.
+ */
+static void analyzeSession(AnalyzeWorker *w, const char *p, const char *end)
+{
+    const char *eol = memchr(p, '\n', (size_t)(end - p));
+    eol = (eol != NULL) ? eol : end;
+
+    // header: player name and puzzle path, separated by blanks
+    const char *name = p + 1, *path, *pathEnd = eol;
+    while (name < eol && (*name == ' ' || *name == '\t'))
+    {
+        name++;
+    }
+    path = name;
+    while (path < eol && *path != ' ' && *path != '\t')
+    {
+        path++;
+    }
+    uint32_t nameLen = (uint32_t)(path - name);
+    while (path < eol && (*path == ' ' || *path == '\t'))
+    {
+        path++;
+    }
+    while (pathEnd > path && (pathEnd[-1] == ' ' || pathEnd[-1] == '\t' || pathEnd[-1] == '\r'))
+    {
+        pathEnd--;
+    }
+
+    AnalyzePuzzle *ap = NULL;
+    PlayerStats *stats = NULL;
+    if (nameLen == 0 || path == pathEnd || (ap = analyzePuzzle(w, path, (size_t)(pathEnd - path))) == NULL ||
+        (stats = playerTableFind(&w->players, name, nameLen, analyzeHash(name, nameLen))) == NULL)
+    {
+        w->failed |= (ap != NULL);
+        w->skipped++;
+        return;
+    }
+
+    LatinBoard *board = &ap->work;
+    int cells = board->size * board->size;
+    uint64_t last = 0;
+    int done = 0;
+    boardAssign(board, &ap->puzzle);
+    journalClear(&w->journal);
+    w->sessions++;
+    stats->sessions++;
+
+    for (p = (eol < end) ? eol + 1 : end; p < end; p = (eol < end) ? eol + 1 : end)
+    {
+        eol = memchr(p, '\n', (size_t)(end - p));
+        eol = (eol != NULL) ? eol : end;
+        const char *q = p;
+        while (q < eol && (*q == ' ' || *q == '\t' || *q == '\r'))
+        {
+            q++;
+        }
+        if (q == eol || *q == '#')
+        {
+            continue;
+        }
+
+        // "<ms> <command>", ms counted from the start of the session
+        uint64_t ms = 0;
+        const char *digits = q;
+        while (q < eol && (unsigned)(*q - '0') < 10)
+        {
+            ms = (ms < UINT64_MAX / 10 - 1) ? ms * 10 + (uint64_t)(*q - '0') : ms;
+            q++;
+        }
+        int i = 0, j = 0, val = 0, cell;
+        CommandStatus kind = CMD_END;
+        if (q > digits && q < eol && (*q == ' ' || *q == '\t'))
+        {
+            kind = parseCommand(&q, eol, 1, &i, &j, &val);
+        }
+        if (kind == CMD_END)
+        {
+            w->malformed++;
+            continue;
+        }
+        if (done)
+        {
+            continue; // the game ended, like play() the rest of the session is not read
+        }
+
+        MoveResult result = playCommand(board, &w->journal, kind, i, j, val, &cell);
+        stats->commands++;
+        stats->results[result]++;
+        last = ms;
+        if (result == MOVE_SAVE)
+        {
+            done = 1;
+        }
+        else if (cell >= 0 && board->filled == cells)
+        {
+            stats->solved++;
+            stats->solveMs += ms;
+            stats->bestMs = (ms < stats->bestMs) ? ms : stats->bestMs;
+            done = 1;
+        }
+    }
+    stats->activeMs += last;
+}
+
+/** @brief Thread body of --analyze: replays the sessions of one chunk after another. */
+static void *analyzeWorkerMain(void *arg)
+{
+    AnalyzeWorker *w = arg;
+    AnalyzeRun *run = w->run;
+    BoardPool pool;
+    if (boardPoolInit(&pool, 0) == 0)
+    {
+        boardPoolUseForThread(&pool);
+    }
+    if (journalInit(&w->journal, JOURNAL_CAPACITY) != 0)
+    {
+        w->failed = 1;
+    }
+
+    for (int c; !w->failed && (c = atomic_fetch_add(&run->next, 1)) < run->chunks;)
+    {
+        const char *p = run->data + analyzeSessionStart(run, c);
+        const char *end = run->data + analyzeSessionStart(run, c + 1);
+
+        // lines before the first header belong to no session
+        while (p < end && *p != '@')
+        {
+            const char *eol = memchr(p, '\n', (size_t)(end - p));
+            eol = (eol != NULL) ? eol : end;
+            const char *q = p;
+            while (q < eol && (*q == ' ' || *q == '\t' || *q == '\r'))
+            {
+                q++;
+            }
+            w->malformed += (q < eol && *q != '#');
+            p = (eol < end) ? eol + 1 : end;
+        }
+        while (p < end)
+        {
+            const char *next = p;
+            do
+            {
+                const char *nl = memchr(next, '\n', (size_t)(end - next));
+                next = (nl != NULL) ? nl + 1 : end;
+            } while (next < end && *next != '@');
+            analyzeSession(w, p, next);
+            p = next;
+        }
+    }
+
+    for (int s = 0; s < ANALYZE_PUZZLE_SLOTS; s++)
+    {
+        if (w->puzzles[s].loaded > 0)
+        {
+            boardFree(&w->puzzles[s].work);
+            boardFree(&w->puzzles[s].puzzle);
+        }
+        free(w->puzzles[s].path);
+    }
+    journalFree(&w->journal);
+    boardPoolDestroy(&pool);
+    return NULL;
+}
+
+/** @brief Leaderboard order: most solved first, then lowest mean time to solve, then by name. */
+static int comparePlayers(const void *a, const void *b)
+{
+    const PlayerStats *x = a, *y = b;
+    if (x->solved != y->solved)
+    {
+        return (x->solved > y->solved) ? -1 : 1;
+    }
+    // compare solveMs / solved without dividing
+    if (x->solved > 0 && x->solveMs * y->solved != y->solveMs * x->solved)
+    {
+        return (x->solveMs * y->solved < y->solveMs * x->solved) ? -1 : 1;
+    }
+    uint32_t len = (x->nameLen < y->nameLen) ? x->nameLen : y->nameLen;
+    int c = memcmp(x->name, y->name, len);
+    return (c != 0) ? c : (x->nameLen > y->nameLen) - (x->nameLen < y->nameLen);
+}
+
+/** @brief Columns of the player table: name, type (1 = u64, 2 = f64, 3 = string) and MoveResult counted, or -1. */
+static const struct { const char *name; int type; int result; } analyzeColumns[] = {
+    {"player", 3, -1},         {"sessions", 1, -1},       {"solved", 1, -1},
+    {"best_ms", 1, -1},        {"mean_solve_ms", 2, -1},  {"active_ms", 1, -1},
+    {"commands", 1, -1},       {"moves_per_s", 2, -1},    {"mistake_rate", 2, -1},
+    {"inserted", 1, MOVE_INSERTED},          {"cleared", 1, MOVE_CLEARED},
+    {"undone", 1, MOVE_UNDONE},              {"redone", 1, MOVE_REDONE},
+    {"hints", 1, MOVE_HINT},                 {"err_format", 1, MOVE_ERR_FORMAT},
+    {"err_range", 1, MOVE_ERR_RANGE},        {"err_occupied", 1, MOVE_ERR_OCCUPIED},
+    {"err_given", 1, MOVE_ERR_GIVEN},        {"err_rule", 1, MOVE_ERR_RULE},
+    {"err_no_undo", 1, MOVE_ERR_NO_UNDO},    {"err_no_redo", 1, MOVE_ERR_NO_REDO},
+};
+
+/** @brief Returns the value of a numeric column for one player; f64 columns as their bit pattern. */
+static uint64_t analyzeColumnValue(const PlayerStats *p, int c)
+{
+    double v = 0.0;
+    uint64_t rejected = p->results[MOVE_ERR_FORMAT] + p->results[MOVE_ERR_RANGE] + p->results[MOVE_ERR_OCCUPIED] +
+                        p->results[MOVE_ERR_GIVEN] + p->results[MOVE_ERR_RULE] + p->results[MOVE_ERR_NO_UNDO] +
+                        p->results[MOVE_ERR_NO_REDO];
+    if (analyzeColumns[c].result >= 0)
+    {
+        return p->results[analyzeColumns[c].result];
+    }
+    switch (c)
+    {
+    case 1: return p->sessions;
+    case 2: return p->solved;
+    case 3: return p->solved ? p->bestMs : 0;
+    case 4: v = p->solved ? (double)p->solveMs / (double)p->solved : 0.0; break;
+    case 5: return p->activeMs;
+    case 6: return p->commands;
+    case 7: v = p->activeMs ? (double)p->commands * 1000.0 / (double)p->activeMs : 0.0; break;
+    case 8: v = p->commands ? (double)rejected / (double)p->commands : 0.0; break;
+    default: break;
+    }
+    uint64_t bits;
+    memcpy(&bits, &v, sizeof(bits));
+    return bits;
+}
+
+/**
+ * @brief Writes the player table as one contiguous block per column.
+ *
+ * Layout (little-endian): a 32-byte header (magic, version, rows,
+ * columns), one 48-byte directory entry per column (name, type, offset,
+ * length), then the columns, each 8-byte aligned. Numeric columns are
+ * rows 8-byte values; the player column is rows + 1 offsets followed by
+ * the concatenated names.
+ *
+ * @return The bytes written, or 0 on error.
+ */
+static uint64_t analyzeWriteTable(const char *outPath, const PlayerStats *rows, size_t count)
+{
+    int columns = (int)(sizeof(analyzeColumns) / sizeof(analyzeColumns[0]));
+    uint8_t header[ANALYZE_HEADER_SIZE] = {0};
+    uint8_t entry[ANALYZE_COLUMN_ENTRY_SIZE];
+    uint64_t nameBytes = 0;
+    for (size_t r = 0; r < count; r++)
+    {
+        nameBytes += rows[r].nameLen;
+    }
+    uint64_t stringLength = 8 * ((uint64_t)count + 1) + nameBytes;
+    uint8_t *buf = malloc(8 * (count + 1));
+    FILE *fp = fopen(outPath, "wb");
+    if (buf == NULL || fp == NULL)
+    {
+        free(buf);
+        if (fp != NULL)
+        {
+            fclose(fp);
+        }
+        return 0;
+    }
+
+    memcpy(header, ANALYZE_MAGIC, 8);
+    packPutLE(header + 8, ANALYZE_VERSION, 4);
+    packPutLE(header + 12, (uint64_t)count, 4);
+    packPutLE(header + 16, (uint64_t)columns, 4);
+    fwrite(header, 1, sizeof(header), fp);
+
+    uint64_t offset = ANALYZE_HEADER_SIZE + (uint64_t)columns * ANALYZE_COLUMN_ENTRY_SIZE;
+    for (int c = 0; c < columns; c++)
+    {
+        uint64_t length = (analyzeColumns[c].type == 3) ? stringLength : 8 * (uint64_t)count;
+        memset(entry, 0, sizeof(entry));
+        memcpy(entry, analyzeColumns[c].name, strlen(analyzeColumns[c].name));
+        packPutLE(entry + 24, (uint64_t)analyzeColumns[c].type, 4);
+        packPutLE(entry + 32, offset, 8);
+        packPutLE(entry + 40, length, 8);
+        fwrite(entry, 1, sizeof(entry), fp);
+        offset += (length + 7) & ~(uint64_t)7;
+    }
+
+    static const uint8_t zeros[8] = {0};
+    for (int c = 0; c < columns; c++)
+    {
+        if (analyzeColumns[c].type == 3)
+        {
+            uint64_t at = 0;
+            for (size_t r = 0; r <= count; r++)
+            {
+                packPutLE(buf + 8 * r, at, 8);
+                at += (r < count) ? rows[r].nameLen : 0;
+            }
+            fwrite(buf, 8, count + 1, fp);
+            for (size_t r = 0; r < count; r++)
+            {
+                fwrite(rows[r].name, 1, rows[r].nameLen, fp);
+            }
+            fwrite(zeros, 1, (size_t)(-stringLength & 7), fp);
+            continue;
+        }
+        for (size_t r = 0; r < count; r++)
+        {
+            packPutLE(buf + 8 * r, analyzeColumnValue(&rows[r], c), 8);
+        }
+        fwrite(buf, 8, count, fp);
+    }
+    free(buf);
+
+    int failed = ferror(fp);
+    if ((fclose(fp) != 0) | failed)
+    {
+        return 0;
+    }
+    return offset;
+}
+
+/**
+ * @brief Runs --analyze mode: per-player metrics over a log of recorded sessions.
+ *
+ * The log holds sessions back to back. Each starts with a line
+ * "@ <player> <puzzle>" and continues with lines "<ms> <command>", ms
+ * counted from the start of the session and the command as typed in a
+ * game; lines starting with # are comments. Every session is replayed
+ * on its puzzle with the same rules as play() and ends, as a game does,
+ * on 0,0=0 or a completed square. The log is split into chunks at
+ * session headers and the chunks are shared out to worker threads, each
+ * adding into its own player table; the tables are merged at the end.
+ * The merged table is written in leaderboard order as a columnar file
+ * with times to solve, moves per second and each rejection reason.
+ *
+ * @param logPath The move log, "-" for stdin.
+ * @param outPath The player table to write.
+ * @param threads Number of worker threads.
+ * @return Exit status code: 0 on success, 1 on error.
+ */
+int runAnalyze(const char *logPath, const char *outPath, int threads)
+{
+    AnalyzeRun run = {0};
+    char *owned = NULL;
+    void *map = NULL;
+    struct stat st;
+    double start = monotonicMs();
+
+    int fd = (strcmp(logPath, "-") == 0) ? STDIN_FILENO : open(logPath, O_RDONLY);
+    if (fd < 0 || fstat(fd, &st) != 0)
+    {
+        printf("Error: Unable to read move log %s\n", logPath);
+        if (fd > STDIN_FILENO)
+        {
+            close(fd);
+        }
+        return 1;
+    }
+    if (S_ISREG(st.st_mode) && st.st_size > 0)
+    {
+        map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        map = (map == MAP_FAILED) ? NULL : map;
+        run.length = (map != NULL) ? (size_t)st.st_size : 0;
+    }
+    if (map == NULL)
+    {
+        // pipes (and files that cannot be mapped) are read whole
+        size_t capacity = 0;
+        for (;;)
+        {
+            if (run.length == capacity)
+            {
+                char *grown = realloc(owned, capacity = capacity ? capacity * 2 : STREAM_BUFFER_SIZE);
+                if (grown == NULL)
+                {
+                    printf("Error: Unable to allocate memory for the move log\n");
+                    free(owned);
+                    return 1;
+                }
+                owned = grown;
+            }
+            ssize_t got = read(fd, owned + run.length, capacity - run.length);
+            if (got <= 0)
+            {
+                break;
+            }
+            run.length += (size_t)got;
+        }
+    }
+    if (fd > STDIN_FILENO)
+    {
+        close(fd);
+    }
+    run.data = (map != NULL) ? map : owned;
+    run.chunks = (run.length > 0) ? threads * ANALYZE_CHUNKS_PER_THREAD : 0;
+    atomic_init(&run.next, 0);
+
+    AnalyzeWorker *workers = calloc((size_t)threads, sizeof(AnalyzeWorker));
+    int started = 0, failed = (workers == NULL);
+    for (; workers != NULL && started < threads; started++)
+    {
+        workers[started].run = &run;
+        if (pthread_create(&workers[started].thread, NULL, analyzeWorkerMain, &workers[started]) != 0)
+        {
+            break;
+        }
+    }
+    if (workers != NULL && started == 0)
+    {
+        // no pool at all: analyze on this thread
+        analyzeWorkerMain(&workers[started++]);
+    }
+    else
+    {
+        for (int t = 0; t < started; t++)
+        {
+            pthread_join(workers[t].thread, NULL);
+        }
+    }
+
+    // merge the per-thread tables
+    PlayerTable all = {0};
+    unsigned long long sessions = 0, skipped = 0, malformed = 0, solved = 0;
+    for (int t = 0; t < started; t++)
+    {
+        AnalyzeWorker *w = &workers[t];
+        failed |= w->failed;
+        sessions += w->sessions;
+        skipped += w->skipped;
+        malformed += w->malformed;
+        for (size_t s = 0; s < w->players.capacity; s++)
+        {
+            const PlayerStats *p = &w->players.slots[s];
+            PlayerStats *into = (p->name != NULL) ? playerTableFind(&all, p->name, p->nameLen, p->hash) : NULL;
+            if (p->name != NULL && into == NULL)
+            {
+                failed = 1;
+            }
+            if (into == NULL)
+            {
+                continue;
+            }
+            into->sessions += p->sessions;
+            into->solved += p->solved;
+            into->solveMs += p->solveMs;
+            into->bestMs = (p->bestMs < into->bestMs) ? p->bestMs : into->bestMs;
+            into->activeMs += p->activeMs;
+            into->commands += p->commands;
+            for (int r = 0; r < MOVE_RESULT_COUNT; r++)
+            {
+                into->results[r] += p->results[r];
+            }
+        }
+        free(w->players.slots);
+    }
+    free(workers);
+
+    // compact the table into leaderboard order
+    size_t count = 0;
+    for (size_t s = 0; s < all.capacity; s++)
+    {
+        if (all.slots[s].name != NULL)
+        {
+            solved += all.slots[s].solved;
+            all.slots[count++] = all.slots[s];
+        }
+    }
+    if (count > 0)
+    {
+        qsort(all.slots, count, sizeof(PlayerStats), comparePlayers);
+    }
+
+    uint64_t bytes = failed ? 0 : analyzeWriteTable(outPath, all.slots, count);
+    free(all.slots);
+    if (map != NULL)
+    {
+        munmap(map, run.length);
+    }
+    free(owned);
+
+    if (failed)
+    {
+        printf("Error: Unable to allocate memory for the analysis\n");
+        return 1;
+    }
+    if (bytes == 0)
+    {
+        printf("Error : Unable to generate file %s!\n", outPath);
+        return 1;
+    }
+    printf("Analyzed %llu sessions of %zu players: %llu solved, %llu skipped, %llu malformed lines (%.3f ms)\n",
+           sessions, count, solved, skipped, malformed, monotonicMs() - start);
+    printf("Wrote %zu rows x %d columns to %s (%llu bytes)\n", count,
+           (int)(sizeof(analyzeColumns) / sizeof(analyzeColumns[0])), outPath, (unsigned long long)bytes);
+    return 0;
+}
+
+/** @brief The --stress worker running on this thread, for the crash report. */
+static _Thread_local StressWorker *stressCurrent;
+
+/** @brief Seed of the --stress run in progress, for the crash report. */
+static uint64_t stressSeed;
+
+/** @brief Writes v in decimal at p and returns the end; usable from a signal handler. */
+static char *stressPutNumber(char *p, long long v)
+{
+    char digits[24];
+    int n = 0;
+    unsigned long long u = (v < 0) ? 0ull - (unsigned long long)v : (unsigned long long)v;
+    do
+    {
+        digits[n++] = (char)('0' + u % 10);
+        u /= 10;
+    } while (u != 0);
+    if (v < 0)
+    {
+        *p++ = '-';
+    }
+    while (n > 0)
+    {
+        *p++ = digits[--n];
+    }
+    return p;
+}
+
+/**
+ * @brief Reports which --stress batch crashed, then lets the signal kill the process.
+ *
+ * Only async-signal-safe calls are made: the message is formatted by
+ * hand and written with write().
+ */
+static void stressCrashHandler(int sig)
+{
+    static const char head[] = "Error: --stress crashed with signal ";
+    char msg[256], *p = msg;
+    memcpy(p, head, sizeof(head) - 1);
+    p = stressPutNumber(p + sizeof(head) - 1, sig);
+    if (stressCurrent != NULL)
+    {
+        memcpy(p, " in batch ", 10);
+        p = stressPutNumber(p + 10, (long long)stressCurrent->batches);
+        memcpy(p, " of worker ", 11);
+        p = stressPutNumber(p + 11, stressCurrent->index);
+    }
+    memcpy(p, ", rerun with --seed ", 20);
+    p = stressPutNumber(p + 20, (long long)stressSeed);
+    *p++ = '\n';
+    ssize_t ignored = write(STDOUT_FILENO, msg, (size_t)(p - msg));
+    (void)ignored;
+    signal(sig, SIG_DFL);
+    raise(sig);
+}
+
+/**
+ * @brief Writes count random commands for a board of order n, one per line.
+ *
+ * Most are moves inside the board, the rest are what a careless or
+ * hostile player types: numbers out of range or too large for an int,
+ * undo, redo and hint keywords, stray characters, and moves split over
+ * several lines. One of them is longer than a CommandReader holds:
+ * either a line of stray characters or a run of blank lines.
+ *
+ * Each counts as one command, which is what --stress reports, though the
+ * parser may split or join some: the long line comes after a short bad
+ * one, stray characters may leave a blank line or one that a following
+ * line continues.
+ *
+ * @param out Buffer of at least count * STRESS_COMMAND_MAX + STRESS_LONG_MAX bytes.
+ * @param count Number of commands.
+ * @param n Order of the board.
+ * @param rng The generator.
+ * @return The number of bytes written.
+ */
+static size_t stressGenerate(char *out, int count, int n, uint64_t *rng)
+{
+    static const char *const keywords[] = {"u\n", "r\n", "undo\n", "redo\n", "?\n", " u \n"};
+    static const char junk[] = "0123456789,=+- \tur?x";
+    static const char blanks[] = " \t\r\n";
+    char *p = out;
+    int longAt = (int)(rngNext(rng) % (uint64_t)count);
+
+    for (int c = 0; c < count; c++)
+    {
+        uint64_t r = rngNext(rng);
+        int kind = (int)(r % 100);
+        r /= 100;
+        if (c == longAt)
+        {
+            // a short bad line first ends whatever the line before left open, then the long
+            // one holds no digits, so it is malformed however much of it a reader holds
+            int len = COMMAND_READER_SIZE + (int)(r % (STRESS_LONG_MAX - COMMAND_READER_SIZE - 2));
+            int blank = (kind & 1);
+            *p++ = 'x';
+            *p++ = '\n';
+            *p++ = blank ? '\n' : 'x';
+            for (len -= 2; len > 0; len--)
+            {
+                r = (r >> 5) ^ (r << 59);
+                *p++ = blank ? blanks[(r >> 3) % (sizeof(blanks) - 1)] : junk[10 + (r >> 3) % (sizeof(junk) - 11)];
+            }
+        }
+        else if (kind < 60 || kind >= 90)
+        {
+            // a move inside the board, or one split over lines at kind >= 90
+            p = stressPutNumber(p, 1 + (long long)(r % (uint64_t)n));
+            *p++ = ',';
+            if (kind >= 90)
+            {
+                *p++ = '\n';
+            }
+            p = stressPutNumber(p, 1 + (long long)((r >> 8) % (uint64_t)n));
+            *p++ = '=';
+            if (kind >= 95)
+            {
+                *p++ = '\t';
+            }
+            p = stressPutNumber(p, (long long)((r >> 16) % (uint64_t)(n + 1)));
+        }
+        else if (kind < 70)
+        {
+            // out of range, sometimes far beyond an int
+            for (int f = 0; f < 3; f++)
+            {
+                long long v = (long long)((r >> (f * 10)) % (uint64_t)(6 * n + 1)) - 3 * n;
+                p = stressPutNumber(p, ((r >> 40) & 15) == (uint64_t)f ? v * 1000000000000ll : v);
+                if (f < 2)
+                {
+                    *p++ = (f == 0) ? ',' : '=';
+                }
+            }
+        }
+        else if (kind < 80)
+        {
+            const char *k = keywords[r % (sizeof(keywords) / sizeof(keywords[0]))];
+            size_t len = strlen(k);
+            memcpy(p, k, len);
+            p += len - 1; // the newline is added below
+        }
+        else
+        {
+            for (int len = 1 + (int)(r % 12); len > 0; len--)
+            {
+                r = (r >> 5) ^ (r << 59);
+                *p++ = junk[(r >> 3) % (sizeof(junk) - 1)];
+            }
+        }
+        *p++ = '\n';
+    }
+    return (size_t)(p - out);
+}
+
+/**
+ * @brief Checks what may change under any command: masks, givens and the journal.
+ *
+ * @return NULL if the board and journal are sound, or what is broken.
+ */
+static const char *stressCheck(const StressWorker *w, const LatinBoard *board, const MoveJournal *journal)
+{
+    const LatinBoard *puzzle = w->puzzle;
+    int cells = puzzle->size * puzzle->size;
+
+    if (boardCheckMasks(board) != 0)
+    {
+        return "the occupancy masks fell out of step with the cells";
+    }
+    if (memcmp(board->given, puzzle->given, (size_t)(cells + 63) / 64 * sizeof(uint64_t)) != 0)
+    {
+        return "the givens bitset changed";
+    }
+    for (int k = 0; k < cells; k++)
+    {
+        if (((puzzle->given[k >> 6] >> (k & 63)) & 1) && board->cells[k] != puzzle->cells[k])
+        {
+            return "a given cell changed";
+        }
+    }
+    if (journal->cursor > journal->count || journal->count > journal->capacity)
+    {
+        return "the journal cursor is past its entries";
+    }
+    return NULL;
+}
+
+/**
+ * @brief Reads a batch back through a CommandReader, as play() would, and compares.
+ *
+ * Every command of a batch fits the reader's buffer except the over-long
+ * line, which holds no digits: the reader must reject it as one
+ * malformed line, just as parseCommand() does with all of it in memory.
+ *
+ * @return NULL if the reader returned the same commands, or what went wrong.
+ */
+static const char *stressReplay(StressWorker *w, const char *text, size_t len)
+{
+    int fd = fileno(w->scratch);
+    size_t done = 0;
+    if (ftruncate(fd, 0) != 0 || lseek(fd, 0, SEEK_SET) != 0)
+    {
+        return "the batch could not be written back";
+    }
+    while (done < len)
+    {
+        ssize_t got = write(fd, text + done, len - done);
+        if (got <= 0)
+        {
+            return "the batch could not be written back";
+        }
+        done += (size_t)got;
+    }
+    lseek(fd, 0, SEEK_SET);
+
+    CommandReader reader;
+    commandReaderInit(&reader, fd);
+    const char *pos = text, *end = text + len;
+    for (;;)
+    {
+        int i = 0, j = 0, val = 0, ri = 0, rj = 0, rval = 0;
+        CommandStatus kind = parseCommand(&pos, end, 1, &i, &j, &val);
+        if (commandRead(&reader, &ri, &rj, &rval) != kind || (kind == CMD_MOVE && (ri != i || rj != j || rval != val)))
+        {
+            return "a command read through a CommandReader differed from the same command in memory";
+        }
+        if (kind == CMD_END)
+        {
+            return NULL;
+        }
+    }
+}
+
+/**
+ * @brief Mutates the text of the board and loads it back.
+ *
+ * Without mutations the record must load back as the same board.
+ *
+ * @return NULL if the loader behaved, or what went wrong.
+ */
+static const char *stressLoad(StressWorker *w, const LatinBoard *board, char *text, uint64_t *rng)
+{
+    static const char junk[] = "0123456789- \n+x";
+    size_t len = formatLatinSquare(board, text);
+    uint64_t r = rngNext(rng);
+    int mutations = (int)(r % 4);
+
+    for (int m = 0; m < mutations; m++)
+    {
+        r = rngNext(rng);
+        text[r % len] = junk[(r >> 32) % (sizeof(junk) - 1)];
+    }
+
+    ParseCursor cur = {text, text + len, 1, text};
+    LatinBoard loaded;
+    char err[256];
+    w->loads++;
+    if (parseLatinSquare(&cur, &loaded, err, sizeof(err)) <= 0)
+    {
+        return (mutations == 0) ? "a saved board did not load back" : NULL;
+    }
+    w->loadsParsed++;
+    int cells = loaded.size * loaded.size;
+    const char *problem = NULL;
+    if (boardCheckMasks(&loaded) != 0)
+    {
+        problem = "a loaded board fails its own masks";
+    }
+    else if (mutations == 0 && (loaded.size != board->size || memcmp(loaded.cells, board->cells, (size_t)cells) != 0 ||
+                                memcmp(loaded.given, board->given, (size_t)(cells + 63) / 64 * sizeof(uint64_t)) != 0))
+    {
+        problem = "a saved board loaded back different";
+    }
+    boardFree(&loaded);
+    return problem;
+}
+
+/** @brief Thread body of --stress: fires batches of random commands at its own board. */
+static void *stressWorkerMain(void *arg)
+{
+    StressWorker *w = arg;
+    const LatinBoard *puzzle = w->puzzle;
+    int n = puzzle->size;
+    uint64_t rng = w->seed ^ ((uint64_t)(w->index + 1) * 0xD1B54A32D192ED03ull);
+    char *text = malloc((size_t)STRESS_BATCH * STRESS_COMMAND_MAX + STRESS_LONG_MAX);
+    char *loadText = malloc(SAVE_BUFFER_SIZE);
+    LatinBoard board;
+    MoveJournal journal;
+    BoardPool pool;
+    int havePool = (boardPoolInit(&pool, 0) == 0);
+    if (havePool)
+    {
+        boardPoolUseForThread(&pool);
+    }
+    int haveBoard = (boardCopy(&board, puzzle) == 0);
+    int haveJournal = (journalInit(&journal, JOURNAL_CAPACITY) == 0);
+    w->scratch = tmpfile();
+    stressCurrent = w;
+
+    w->failed = text == NULL || loadText == NULL || !haveBoard || !haveJournal || w->scratch == NULL;
+    while (!w->failed && w->failure == NULL && w->commands < w->target)
+    {
+        unsigned long long left = w->target - w->commands;
+        int count = (left < STRESS_BATCH) ? (int)left : STRESS_BATCH;
+        size_t len = stressGenerate(text, count, n, &rng);
+        const char *pos = text, *end = text + len;
+        w->commands += (unsigned long long)count;
+
+        double t0 = monotonicMs();
+        for (;;)
+        {
+            int i = 0, j = 0, val = 0, cell;
+            CommandStatus kind = parseCommand(&pos, end, 1, &i, &j, &val);
+            if (kind == CMD_END)
+            {
+                break;
+            }
+            w->results[playCommand(&board, &journal, kind, i, j, val, &cell)]++;
+            if (board.filled == n * n)
+            {
+                // start the puzzle over, with an empty journal
+                w->completions++;
+                boardAssign(&board, puzzle);
+                journalClear(&journal);
+            }
+        }
+        double ms = monotonicMs() - t0;
+
+        if (w->batches >= STRESS_WARMUP_BATCHES && ms > STRESS_SLOW_FACTOR * (w->engineMs / (double)w->batches))
+        {
+            if (w->slowCount < STRESS_SLOW_KEEP)
+            {
+                w->slow[w->slowCount].batch = w->batches;
+                w->slow[w->slowCount].ms = ms;
+            }
+            w->slowCount++;
+        }
+        if (ms > w->slowestMs)
+        {
+            w->slowestMs = ms;
+            w->slowestBatch = w->batches;
+        }
+        w->engineMs += ms;
+
+        t0 = monotonicMs();
+        w->failure = stressCheck(w, &board, &journal);
+        if (w->failure == NULL)
+        {
+            w->failure = stressLoad(w, &board, loadText, &rng);
+        }
+        w->loadMs += monotonicMs() - t0;
+        if (w->failure == NULL)
+        {
+            w->failure = stressReplay(w, text, len);
+        }
+        if (w->failure != NULL)
+        {
+            w->failedBatch = w->batches;
+        }
+        w->batches++;
+    }
+
+    stressCurrent = NULL;
+    if (w->scratch != NULL)
+    {
+        fclose(w->scratch);
+    }
+    if (haveJournal)
+    {
+        journalFree(&journal);
+    }
+    if (haveBoard)
+    {
+        boardFree(&board);
+    }
+    free(text);
+    free(loadText);
+    if (havePool)
+    {
+        boardPoolDestroy(&pool);
+    }
+    return NULL;
+}
+
+/**
+ * @brief Runs --stress mode: fires random commands at the move engine and reports the rate.
+ *
+ * Each worker plays its own copy of the puzzle with batches of random
+ * commands (see stressGenerate()), parsed by parseCommand() and applied
+ * by playCommand() like a game with undo. After every batch the board
+ * is checked (stressCheck()), its saved text, randomly mutated, is
+ * loaded back (stressLoad()), and the batch is read again through a
+ * CommandReader as a game reads it (stressReplay()). Throughput is reported for the command
+ * path and the loader separately, with the slowest batches; a broken
+ * invariant or a crash names the worker and batch. The same seed and
+ * thread count repeat a run exactly.
+ *
+ * @param puzzle The puzzle to play.
+ * @param commands Number of commands to fire over all workers.
+ * @param threads Number of worker threads.
+ * @param seed Seed of the run.
+ * @return Exit status code: 0 if every check passed, 1 otherwise.
+ */
+int runStress(const LatinBoard *puzzle, unsigned long long commands, int threads, uint64_t seed)
+{
+    StressWorker *workers = calloc((size_t)threads, sizeof(StressWorker));
+    if (workers == NULL)
+    {
+        printf("Error: Unable to allocate memory for the stress run\n");
+        return 1;
+    }
+
+    for (int t = 0; t < threads; t++)
+    {
+        workers[t].puzzle = puzzle;
+        workers[t].index = t;
+        workers[t].seed = seed;
+        workers[t].target = commands / (unsigned long long)threads + ((unsigned long long)t < commands % (unsigned long long)threads);
+    }
+    printf("Stress: %llu commands on %d thread%s, %dx%d puzzle, seed %llu\n", commands, threads,
+           threads == 1 ? "" : "s", puzzle->size, puzzle->size, (unsigned long long)seed);
+    fflush(stdout);
+
+    static const int crashSignals[] = {SIGSEGV, SIGBUS, SIGFPE, SIGILL, SIGABRT};
+    struct sigaction crash, saved[sizeof(crashSignals) / sizeof(crashSignals[0])];
+    memset(&crash, 0, sizeof(crash));
+    crash.sa_handler = stressCrashHandler;
+    sigemptyset(&crash.sa_mask);
+    stressSeed = seed;
+    for (size_t s = 0; s < sizeof(crashSignals) / sizeof(crashSignals[0]); s++)
+    {
+        sigaction(crashSignals[s], &crash, &saved[s]);
+    }
+
+    double start = monotonicMs();
+    int started = 0;
+    for (; started < threads; started++)
+    {
+        if (pthread_create(&workers[started].thread, NULL, stressWorkerMain, &workers[started]) != 0)
+        {
+            break;
+        }
+    }
+    if (started == 0)
+    {
+        // no threads at all: run the first worker's share here
+        stressWorkerMain(&workers[0]);
+    }
+    for (int t = 0; t < started; t++)
+    {
+        pthread_join(workers[t].thread, NULL);
+    }
+    double elapsed = monotonicMs() - start;
+
+    for (size_t s = 0; s < sizeof(crashSignals) / sizeof(crashSignals[0]); s++)
+    {
+        sigaction(crashSignals[s], &saved[s], NULL);
+    }
+
+    StressWorker all;
+    memset(&all, 0, sizeof(all));
+    int status = 0;
+    for (int t = 0; t < threads; t++)
+    {
+        StressWorker *w = &workers[t];
+        all.commands += w->commands;
+        all.batches += w->batches;
+        all.completions += w->completions;
+        all.loads += w->loads;
+        all.loadsParsed += w->loadsParsed;
+        all.slowCount += w->slowCount;
+        all.engineMs += w->engineMs;
+        all.loadMs += w->loadMs;
+        for (int r = 0; r < MOVE_RESULT_COUNT; r++)
+        {
+            all.results[r] += w->results[r];
+        }
+        if (w->slowestMs > all.slowestMs)
+        {
+            all.slowestMs = w->slowestMs;
+            all.slowestBatch = w->slowestBatch;
+            all.index = t;
+        }
+        if (w->failed)
+        {
+            printf("Error: worker %d could not allocate its board or its scratch file\n", t);
+            status = 1;
+        }
+        if (w->failure != NULL)
+        {
+            printf("Error: worker %d, batch %llu: %s\n", t, w->failedBatch, w->failure);
+            status = 1;
+        }
+    }
+
+    unsigned long long rejected = all.results[MOVE_ERR_FORMAT] + all.results[MOVE_ERR_RANGE] +
+                                  all.results[MOVE_ERR_OCCUPIED] + all.results[MOVE_ERR_GIVEN] + all.results[MOVE_ERR_RULE];
+    printf("Commands: %llu (%llu inserted, %llu cleared, %llu rejected, %llu undone, %llu redone, %llu hints), "
+           "%llu completions\n", all.commands, all.results[MOVE_INSERTED], all.results[MOVE_CLEARED], rejected,
+           all.results[MOVE_UNDONE], all.results[MOVE_REDONE], all.results[MOVE_HINT], all.completions);
+    printf("Engine: %.0f commands/s per thread parsing and applying, %.0f commands/s over the run (%.3f ms)\n",
+           all.engineMs > 0 ? all.commands / (all.engineMs / 1000.0) : 0.0,
+           elapsed > 0 ? all.commands / (elapsed / 1000.0) : 0.0, elapsed);
+    printf("Loader: %llu mutated records, %llu accepted, %.0f loads/s\n", all.loads, all.loadsParsed,
+           all.loadMs > 0 ? all.loads / (all.loadMs / 1000.0) : 0.0);
+    printf("Batches: %llu of up to %d commands, mean %.1f us, slowest %.1f us (worker %d, batch %llu)\n",
+           all.batches, STRESS_BATCH, all.batches > 0 ? all.engineMs * 1000.0 / all.batches : 0.0,
+           all.slowestMs * 1000.0, all.index, all.slowestBatch);
+    if (all.slowCount > 0)
+    {
+        printf("Note: %llu batches took over %dx their worker's mean:", all.slowCount, STRESS_SLOW_FACTOR);
+        for (int t = 0; t < threads; t++)
+        {
+            for (unsigned long long s = 0; s < workers[t].slowCount && s < STRESS_SLOW_KEEP; s++)
+            {
+                printf(" worker %d batch %llu (%.1f us)", t, workers[t].slow[s].batch, workers[t].slow[s].ms * 1000.0);
+            }
+        }
+        printf("\n");
+    }
+    printf("Checks: %s\n", status == 0 ? "passed" : "FAILED");
+    free(workers);
+    return status;
+}
+
+/** @brief Scratch of one canonicalForm() search; vertices are rows, then columns, then values. */
+typedef struct
+{
+    int n, vertices, count;
+    int budget;
+    int haveBest;
+    uint16_t triple[MAX_ORDER * MAX_ORDER][3];  // row, column and value vertex of every filled cell
+    int degree[3 * MAX_ORDER];
+    uint64_t sig[3 * MAX_ORDER];
+    uint64_t key[3 * MAX_ORDER];
+    uint8_t leaf[MAX_ORDER * MAX_ORDER];
+    CanonicalForm *best;
+} CanonSearch;
+
+/** @brief Splitmix64 finaliser, used to spread small keys over 64 bits. */
+static inline uint64_t canonMix(uint64_t x)
+{
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+    return x ^ (x >> 31);
+}
+
+/** @brief qsort comparator for uint64_t keys. */
+static int canonCompareKeys(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief Refines a vertex colouring until it is stable.
+ *
+ * A colour is the position of its first vertex in colour order, so it
+ * only depends on the structure, never on the vertex numbers. Each round
+ * splits every colour by the multiset of colour pairs of the filled
+ * cells its vertices lie on.
+ */
+static void canonRefine(CanonSearch *cs, uint8_t *color)
+{
+    int classes = -1;
+
+    for (;;)
+    {
+        memset(cs->sig, 0, sizeof(cs->sig[0]) * (size_t)cs->vertices);
+        for (int t = 0; t < cs->count; t++)
+        {
+            int r = cs->triple[t][0], c = cs->triple[t][1], s = cs->triple[t][2];
+            cs->sig[r] += canonMix((uint64_t)color[c] << 8 | color[s]);
+            cs->sig[c] += canonMix((uint64_t)color[r] << 8 | color[s]);
+            cs->sig[s] += canonMix((uint64_t)color[r] << 8 | color[c]);
+        }
+        for (int v = 0; v < cs->vertices; v++)
+        {
+            cs->key[v] = (uint64_t)color[v] << 56 | (canonMix(cs->sig[v]) >> 16) << 8 | (uint64_t)v;
+        }
+        qsort(cs->key, (size_t)cs->vertices, sizeof(cs->key[0]), canonCompareKeys);
+
+        int count = 0, first = 0;
+        for (int p = 0; p < cs->vertices; p++)
+        {
+            if (p == 0 || (cs->key[p] >> 8) != (cs->key[p - 1] >> 8))
+            {
+                first = p;
+                count++;
+            }
+            color[cs->key[p] & 0xFF] = (uint8_t)first;
+        }
+        if (count == classes)
+        {
+            return;
+        }
+        classes = count;
+    }
+}
+
+/**
+ * @brief Searches the individualisation tree below a colouring for the smallest form.
+ *
+ * Every leaf is a relabelling of the board; the smallest over the whole
+ * tree is the canonical form. Vertices no filled cell touches are
+ * interchangeable, so only one of them is tried.
+ */
+static void canonSearch(CanonSearch *cs, const uint8_t *color)
+{
+    uint8_t refined[3 * MAX_ORDER];
+    int members[3 * MAX_ORDER] = {0};
+    int n = cs->n, target = -1;
+
+    memcpy(refined, color, (size_t)cs->vertices);
+    canonRefine(cs, refined);
+    cs->budget--;
+
+    for (int v = 0; v < cs->vertices; v++)
+    {
+        members[refined[v]]++;
+    }
+    for (int c = 0; c < cs->vertices && target < 0; c++)
+    {
+        target = members[c] > 1 ? c : -1;
+    }
+
+    if (target < 0)
+    {
+        // a discrete colouring orders rows, columns and values: write the board in that order
+        memset(cs->leaf, 0, (size_t)n * n);
+        for (int t = 0; t < cs->count; t++)
+        {
+            int r = refined[cs->triple[t][0]], c = refined[cs->triple[t][1]] - n;
+            cs->leaf[r * n + c] = (uint8_t)(refined[cs->triple[t][2]] - 2 * n + 1);
+        }
+        if (!cs->haveBest || memcmp(cs->leaf, cs->best->cells, (size_t)n * n) < 0)
+        {
+            CanonicalForm *f = cs->best;
+            memcpy(f->cells, cs->leaf, (size_t)n * n);
+            for (int k = 0; k < n; k++)
+            {
+                f->rowPos[k] = refined[k];
+                f->colPos[k] = (uint8_t)(refined[n + k] - n);
+                f->symbol[k + 1] = (uint8_t)(refined[2 * n + k] - 2 * n + 1);
+            }
+            cs->haveBest = 1;
+        }
+        return;
+    }
+
+    int tried = 0;
+    for (int v = 0; v < cs->vertices; v++)
+    {
+        if (refined[v] != target)
+        {
+            continue;
+        }
+        if (tried++ > 0 && cs->budget <= 0)
+        {
+            cs->best->exact = 0;
+            return;
+        }
+
+        // v keeps the colour, the rest of its class moves to the next one
+        uint8_t next[3 * MAX_ORDER];
+        memcpy(next, refined, (size_t)cs->vertices);
+        for (int u = 0; u < cs->vertices; u++)
+        {
+            next[u] += (u != v && refined[u] == target);
+        }
+        canonSearch(cs, next);
+        if (cs->degree[v] == 0)
+        {
+            break;
+        }
+    }
+}
+
+/**
+ * @brief Computes the canonical form and hash of a board under isotopy.
+ *
+ * The filled cells are a tripartite structure of rows, columns and
+ * values; colour refinement with individualisation, as in graph
+ * canonical labelling, orders all three. Givens and entered values are
+ * treated alike. Highly symmetric boards may exhaust CANON_NODE_BUDGET,
+ * in which case the form is still a relabelling of the board but
+ * equivalent boards may get different ones.
+ *
+ * @param board The board.
+ * @param form Receives the form, its hash and the relabelling.
+ * @return 0 on success, or -1 on error.
+ */
+int canonicalForm(const LatinBoard *board, CanonicalForm *form)
+{
+    CanonSearch *cs = malloc(sizeof(CanonSearch));
+    uint8_t color[3 * MAX_ORDER] = {0};
+    int n = board->size;
+    if (cs == NULL)
+    {
+        return -1;
+    }
+
+    cs->n = n;
+    cs->vertices = 3 * n;
+    cs->count = 0;
+    cs->budget = CANON_NODE_BUDGET;
+    cs->haveBest = 0;
+    cs->best = form;
+    memset(cs->degree, 0, sizeof(cs->degree));
+    for (int k = 0; k < n * n; k++)
+    {
+        if (board->cells[k] != 0)
+        {
+            uint16_t *t = cs->triple[cs->count++];
+            t[0] = (uint16_t)(k / n);
+            t[1] = (uint16_t)(n + k % n);
+            t[2] = (uint16_t)(2 * n + board->cells[k] - 1);
+            cs->degree[t[0]]++;
+            cs->degree[t[1]]++;
+            cs->degree[t[2]]++;
+        }
+    }
+    for (int v = 0; v < cs->vertices; v++)
+    {
+        color[v] = (uint8_t)(v / n * n);
+    }
+
+    form->size = n;
+    form->exact = 1;
+    form->symbol[0] = 0;
+    canonSearch(cs, color);
+    free(cs);
+
+    uint64_t h = 0xCBF29CE484222325ull ^ (uint64_t)n;
+    for (int k = 0; k < n * n; k++)
+    {
+        h = (h ^ form->cells[k]) * 0x100000001B3ull;
+    }
+    form->hash = canonMix(h);
+    return 0;
+}
+
+/** @brief Finds the table slot of a canonical puzzle: its entry, or the empty slot it would take. */
+static SolveCacheEntry *solveCacheSlot(const SolveCache *cache, uint64_t hash, int size, const uint8_t *cells)
+{
+    size_t mask = cache->capacity - 1;
+    for (size_t p = hash & mask;; p = (p + 1) & mask)
+    {
+        SolveCacheEntry *e = &cache->entries[p];
+        if (e->size == 0 ||
+            (e->hash == hash && e->size == size && memcmp(e->cells, cells, (size_t)size * size) == 0))
+        {
+            return e;
+        }
+    }
+}
+
+/** @brief Adds a result to the table, growing it to stay at most half full. */
+static int solveCacheInsert(SolveCache *cache, uint64_t hash, int size, const uint8_t *cells, const uint8_t *solution)
+{
+    if ((cache->count + 1) * 2 > cache->capacity)
+    {
+        SolveCache grown = *cache;
+        grown.capacity = cache->capacity ? cache->capacity * 2 : 1024;
+        grown.entries = calloc(grown.capacity, sizeof(SolveCacheEntry));
+        if (grown.entries == NULL)
+        {
+            return -1;
+        }
+        for (size_t p = 0; p < cache->capacity; p++)
+        {
+            SolveCacheEntry *e = &cache->entries[p];
+            if (e->size != 0)
+            {
+                *solveCacheSlot(&grown, e->hash, e->size, e->cells) = *e;
+            }
+        }
+        free(cache->entries);
+        *cache = grown;
+    }
+
+    SolveCacheEntry *e = solveCacheSlot(cache, hash, size, cells);
+    if (e->size != 0)
+    {
+        return 0;
+    }
+    size_t area = (size_t)size * size;
+    if ((e->cells = malloc(solution != NULL ? 2 * area : area)) == NULL)
+    {
+        return -1;
+    }
+    memcpy(e->cells, cells, area);
+    if (solution != NULL)
+    {
+        memcpy(e->cells + area, solution, area);
+    }
+    e->hash = hash;
+    e->size = size;
+    e->solved = solution != NULL;
+    cache->count++;
+    return 0;
+}
+
+/**
+ * @brief Loads a solve cache file, creating it when it does not exist.
+ *
+ * Records after the first damaged one are ignored.
+ *
+ * @param cache The cache to initialise.
+ * @param path The cache file.
+ * @return 0 on success, or -1 on error.
+ */
+int solveCacheOpen(SolveCache *cache, const char *path)
+{
+    memset(cache, 0, sizeof(*cache));
+    FILE *in = fopen(path, "rb");
+    long length = 0;
+    uint8_t *data = NULL;
+
+    if (in != NULL)
+    {
+        if (fseek(in, 0, SEEK_END) == 0 && (length = ftell(in)) > 0 && fseek(in, 0, SEEK_SET) == 0 &&
+            (data = malloc((size_t)length)) != NULL && fread(data, 1, (size_t)length, in) != (size_t)length)
+        {
+            length = 0;
+        }
+        fclose(in);
+    }
+
+    int ok = data == NULL || (length >= SOLVE_CACHE_HEADER_SIZE && memcmp(data, SOLVE_CACHE_MAGIC, 8) == 0 &&
+                              packGetLE(data + 8, 4) == SOLVE_CACHE_VERSION);
+    size_t pos = SOLVE_CACHE_HEADER_SIZE;
+    while (ok && data != NULL && pos + SOLVE_CACHE_RECORD_HEADER <= (size_t)length)
+    {
+        const uint8_t *r = data + pos;
+        int size = r[8], solved = r[9];
+        size_t area = (size_t)size * size;
+        size_t total = SOLVE_CACHE_RECORD_HEADER + (solved ? 2 * area : area);
+        if (size < 1 || size > MAX_ORDER || solved > 1 || pos + total > (size_t)length)
+        {
+            break;
+        }
+        if (solveCacheInsert(cache, packGetLE(r, 8), size, r + SOLVE_CACHE_RECORD_HEADER,
+                             solved ? r + SOLVE_CACHE_RECORD_HEADER + area : NULL) != 0)
+        {
+            ok = 0;
+        }
+        pos += total;
+    }
+    free(data);
+
+    if (ok && (cache->file = fopen(path, "ab")) != NULL && length < SOLVE_CACHE_HEADER_SIZE)
+    {
+        uint8_t header[SOLVE_CACHE_HEADER_SIZE] = {0};
+        memcpy(header, SOLVE_CACHE_MAGIC, 8);
+        packPutLE(header + 8, SOLVE_CACHE_VERSION, 4);
+        ok = fwrite(header, 1, sizeof(header), cache->file) == sizeof(header) && fflush(cache->file) == 0;
+    }
+    if (!ok || cache->file == NULL)
+    {
+        solveCacheClose(cache);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Closes the cache file and frees every entry.
+ *
+ * @param cache The cache.
+ */
+void solveCacheClose(SolveCache *cache)
+{
+    for (size_t p = 0; p < cache->capacity; p++)
+    {
+        free(cache->entries[p].cells);
+    }
+    free(cache->entries);
+    if (cache->file != NULL)
+    {
+        fclose(cache->file);
+    }
+    memset(cache, 0, sizeof(*cache));
+}
+
+/**
+ * @brief Looks up the result of a puzzle equivalent to board.
+ *
+ * A cached solution is mapped back through the form's relabelling and
+ * checked against the board before it is used.
+ *
+ * @param cache The cache.
+ * @param form The canonical form of board.
+ * @param board The puzzle; filled in with the solution on a hit.
+ * @return 1 if a solution was found, 0 if the puzzle is known to be
+ *         unsolvable, or -1 if it is not in the cache.
+ */
+int solveCacheLookup(SolveCache *cache, const CanonicalForm *form, LatinBoard *board)
+{
+    int n = board->size;
+    SolveCacheEntry *e = (cache->capacity == 0) ? NULL : solveCacheSlot(cache, form->hash, n, form->cells);
+    if (e == NULL || e->size == 0)
+    {
+        cache->misses++;
+        return -1;
+    }
+    if (!e->solved)
+    {
+        cache->hits++;
+        return 0;
+    }
+
+    uint8_t value[MAX_ORDER + 1], solution[MAX_ORDER * MAX_ORDER];
+    uint64_t rows[MAX_ORDER] = {0}, cols[MAX_ORDER] = {0};
+    for (int v = 1; v <= n; v++)
+    {
+        value[form->symbol[v]] = (uint8_t)v;
+    }
+    for (int i = 0; i < n; i++)
+    {
+        for (int j = 0; j < n; j++)
+        {
+            int v = value[e->cells[n * n + form->rowPos[i] * n + form->colPos[j]]];
+            int k = i * n + j;
+            if ((board->cells[k] != 0 && board->cells[k] != v) || ((rows[i] | cols[j]) >> (v - 1) & 1))
+            {
+                cache->misses++;
+                return -1;
+            }
+            rows[i] |= 1ull << (v - 1);
+            cols[j] |= 1ull << (v - 1);
+            solution[k] = (uint8_t)v;
+        }
+    }
+
+    for (int k = 0; k < n * n; k++)
+    {
+        if (board->cells[k] == 0)
+        {
+            boardPlace(board, k / n, k % n, solution[k]);
+        }
+    }
+    cache->hits++;
+    return 1;
+}
+
+/**
+ * @brief Records the result of a puzzle and appends it to the cache file.
+ *
+ * @param cache The cache.
+ * @param form The canonical form of the puzzle.
+ * @param solution The solved puzzle, or NULL if it has no solution.
+ * @return 0 on success, or -1 on error.
+ */
+int solveCacheStore(SolveCache *cache, const CanonicalForm *form, const LatinBoard *solution)
+{
+    int n = form->size;
+    size_t area = (size_t)n * n;
+    uint8_t record[SOLVE_CACHE_RECORD_HEADER + 2 * MAX_ORDER * MAX_ORDER] = {0};
+    uint8_t *canon = record + SOLVE_CACHE_RECORD_HEADER;
+
+    memcpy(canon, form->cells, area);
+    if (solution != NULL)
+    {
+        for (int k = 0; k < n * n; k++)
+        {
+            canon[area + form->rowPos[k / n] * n + form->colPos[k % n]] = form->symbol[solution->cells[k]];
+        }
+    }
+    packPutLE(record, form->hash, 8);
+    record[8] = (uint8_t)n;
+    record[9] = solution != NULL;
+
+    size_t total = SOLVE_CACHE_RECORD_HEADER + (solution != NULL ? 2 * area : area);
+    if (solveCacheInsert(cache, form->hash, n, canon, solution != NULL ? canon + area : NULL) != 0 ||
+        fwrite(record, 1, total, cache->file) != total || fflush(cache->file) != 0)
+    {
+        return -1;
+    }
+    return 0;
+}
+
+/** @brief Clause sink of the CNF encoder; with no file it only counts. */
+typedef struct
+{
+    FILE *out;
+    int nextVar;                    // next auxiliary variable
+    unsigned long long clauses;
+} CnfWriter;
+
+/** @brief Emits one clause of count literals. */
+static void cnfClause(CnfWriter *w, const int *lits, int count)
+{
+    w->clauses++;
+    if (w->out != NULL)
+    {
+        for (int l = 0; l < count; l++)
+        {
+            fprintf(w->out, "%d ", lits[l]);
+        }
+        fputs("0\n", w->out);
+    }
+}
+
+/**
+ * @brief Emits "exactly one of lits": one at-least-one clause plus an at-most-one constraint.
+ *
+ * Small groups get pairwise exclusions. Larger ones use Sinz's sequential
+ * counter: auxiliary s[i] means "one of lits[0..i] is true", which takes
+ * 3m - 4 clauses and m - 1 variables instead of m(m-1)/2 clauses.
+ */
+static void cnfExactlyOne(CnfWriter *w, const int *lits, int m)
+{
+    cnfClause(w, lits, m);
+    if (m <= CNF_PAIRWISE_MAX)
+    {
+        for (int a = 0; a < m; a++)
+        {
+            for (int b = a + 1; b < m; b++)
+            {
+                int c[2] = {-lits[a], -lits[b]};
+                cnfClause(w, c, 2);
+            }
+        }
+        return;
+    }
+
+    int s = w->nextVar;             // s + i is the counter of lits[0..i]
+    w->nextVar += m - 1;
+    int first[2] = {-lits[0], s};
+    cnfClause(w, first, 2);
+    for (int i = 1; i < m - 1; i++)
+    {
+        int c1[2] = {-lits[i], s + i};
+        int c2[2] = {-(s + i - 1), s + i};
+        int c3[2] = {-lits[i], -(s + i - 1)};
+        cnfClause(w, c1, 2);
+        cnfClause(w, c2, 2);
+        cnfClause(w, c3, 2);
+    }
+    int last[2] = {-lits[m - 1], -(s + m - 2)};
+    cnfClause(w, last, 2);
+}
+
+/** @brief Emits every constraint: one value per cell, and each value once per row and per column. */
+static void cnfEmit(const CnfEncoding *enc, CnfWriter *w)
+{
+    int n = enc->size;
+    int lits[MAX_ORDER];
+    w->nextVar = enc->placements + 1;
+    w->clauses = 0;
+
+    for (int k = 0; k < n * n; k++)
+    {
+        int m = 0;
+        for (int v = 0; v < n; v++)
+        {
+            if (enc->var[k * n + v] != 0)
+            {
+                lits[m++] = enc->var[k * n + v];
+            }
+        }
+        cnfExactlyOne(w, lits, m);
+    }
+    for (int line = 0; line < 2; line++)
+    {
+        for (int t = 0; t < n; t++)
+        {
+            for (int v = 0; v < n; v++)
+            {
+                int m = 0;
+                for (int u = 0; u < n; u++)
+                {
+                    int k = (line == 0) ? t * n + u : u * n + t;
+                    if (enc->var[k * n + v] != 0)
+                    {
+                        lits[m++] = enc->var[k * n + v];
+                    }
+                }
+                cnfExactlyOne(w, lits, m);
+            }
+        }
+    }
+}
+
+/**
+ * @brief Numbers the placements of a board and counts the clauses of its encoding.
+ *
+ * @param enc The encoding to initialise.
+ * @param board The puzzle.
+ * @return 0 on success, or -1 on error.
+ */
+int cnfEncode(CnfEncoding *enc, const LatinBoard *board)
+{
+    int n = board->size;
+    enc->size = n;
+    enc->placements = 0;
+    if ((enc->var = calloc((size_t)n * n * n, sizeof(int))) == NULL)
+    {
+        return -1;
+    }
+
+    for (int k = 0; k < n * n; k++)
+    {
+        uint64_t live = board->cells[k] != 0 ? 1ull << (board->cells[k] - 1) : boardCandidates(board, k / n, k % n);
+        for (; live != 0; live &= live - 1)
+        {
+            enc->var[k * n + __builtin_ctzll(live)] = ++enc->placements;
+        }
+    }
+
+    CnfWriter counter = {NULL, 0, 0};
+    cnfEmit(enc, &counter);
+    enc->vars = counter.nextVar - 1;
+    enc->clauses = counter.clauses;
+    return 0;
+}
+
+/**
+ * @brief Releases an encoding.
+ *
+ * @param enc The encoding.
+ */
+void cnfFree(CnfEncoding *enc)
+{
+    free(enc->var);
+    enc->var = NULL;
+}
+
+/**
+ * @brief Runs --export-cnf mode: writes the puzzle as a DIMACS CNF file for a SAT solver.
+ *
+ * Filled cells only keep their own value and empty cells their
+ * candidates, so the givens need no clauses of their own and hard
+ * instances start with the eliminations already done. The model the
+ * solver prints is turned back into a board by --import-model.
+ *
+ * Puzzles of one order share every clause but the placements their
+ * filled cells rule out. To solve many at once, encode the full order-n
+ * square once and pass each puzzle's filled cells as assumptions to an
+ * incremental solver, instead of writing one CNF per puzzle.
+ *
+ * @param board The puzzle.
+ * @param outPath The CNF file to write.
+ * @return Exit status code: 0 on success, 1 on error.
+ */
+int runExportCnf(const LatinBoard *board, const char *outPath)
+{
+    CnfEncoding enc;
+    if (cnfEncode(&enc, board) != 0)
+    {
+        printf("Error: Unable to allocate memory for the encoding\n");
+        return 1;
+    }
+
+    FILE *out = fopen(outPath, "w");
+    if (out == NULL)
+    {
+        printf("Error: Unable to create file %s\n", outPath);
+        cnfFree(&enc);
+        return 1;
+    }
+    int n = board->size;
+    fprintf(out, "c latinsquare order %d: placements numbered by cell, then value; read models back with --import-model\n", n);
+    fprintf(out, "c %d placement variables, %d counter variables\n", enc.placements, enc.vars - enc.placements);
+    fprintf(out, "p cnf %d %llu\n", enc.vars, enc.clauses);
+    CnfWriter writer = {out, 0, 0};
+    cnfEmit(&enc, &writer);
+    int failed = ferror(out) != 0;
+    failed |= fclose(out) != 0;
+    cnfFree(&enc);
+
+    if (failed)
+    {
+        printf("Error: Unable to write file %s\n", outPath);
+        return 1;
+    }
+    printf("Wrote %s: %d variables, %llu clauses\n", outPath, writer.nextVar - 1, writer.clauses);
+    return 0;
+}
+
+/**
+ * @brief Runs --import-model mode: completes the puzzle from a SAT solver's model and saves it.
+ *
+ * Reads the model of the CNF --export-cnf wrote for the same puzzle,
+ * either in the competition format ("s SATISFIABLE" and "v ..." lines)
+ * or as a bare list of literals, and saves the square like a finished game.
+ *
+ * @param board The puzzle the CNF was exported from.
+ * @param modelPath The solver output.
+ * @param outFileName Where to save the completed square.
+ * @return Exit status code: 0 if the square was saved, 2 if the solver
+ *         found no solution, 1 on error.
+ */
+int runImportModel(LatinBoard *board, const char *modelPath, char *outFileName)
+{
+    CnfEncoding enc;
+    FILE *in = fopen(modelPath, "r");
+    if (in == NULL)
+    {
+        printf("Error: Unable to access file %s\n", modelPath);
+        return 1;
+    }
+    if (cnfEncode(&enc, board) != 0)
+    {
+        printf("Error: Unable to allocate memory for the encoding\n");
+        fclose(in);
+        return 1;
+    }
+
+    uint8_t *truth = calloc((size_t)enc.placements + 1, 1);
+    char *line = NULL;
+    size_t lineSize = 0;
+    int unsat = 0;
+    while (truth != NULL && getline(&line, &lineSize, in) > 0)
+    {
+        if (strstr(line, "UNSAT") != NULL)
+        {
+            unsat = 1;
+        }
+        if (line[0] == 'c' || line[0] == 's' || strncmp(line, "SAT", 3) == 0 || unsat)
+        {
+            continue;
+        }
+        char *p = line + (line[0] == 'v');
+        for (;;)
+        {
+            char *end;
+            long lit = strtol(p, &end, 10);
+            if (end == p)
+            {
+                break;
+            }
+            if (lit > 0 && lit <= enc.placements)
+            {
+                truth[lit] = 1;
+            }
+            p = end;
+        }
+    }
+    free(line);
+    fclose(in);
+
+    int n = board->size, status = 1;
+    if (truth == NULL)
+    {
+        printf("Error: Unable to allocate memory for the model\n");
+    }
+    else if (unsat)
+    {
+        printf("The solver found no solution for this puzzle\n");
+        status = 2;
+    }
+    else
+    {
+        for (int x = 0; x < n * n * n; x++)
+        {
+            int k = x / n;
+            if (enc.var[x] != 0 && truth[enc.var[x]] && board->cells[k] == 0 &&
+                boardCanPlace(board, k / n, k % n, x % n + 1))
+            {
+                boardPlace(board, k / n, k % n, x % n + 1);
+            }
+        }
+        if (board->filled != n * n || boardHasConflicts(board))
+        {
+            printf("Error: the model in %s does not complete this puzzle\n", modelPath);
+        }
+        else
+        {
+            displayLatinSquare(board);
+            writeLatinSquare(board, outFileName);
+            status = 0;
+        }
+    }
+    free(truth);
+    cnfFree(&enc);
+    return status;
+}
+
+#if BENCH_COUNT_ALLOCS
+// glibc entry points behind malloc and friends; the wrappers below count every allocation of the process
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t count, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+extern void *__libc_memalign(size_t alignment, size_t size);
+
+static _Atomic unsigned long long benchAllocations;
+
+void *malloc(size_t size)
+{
+    atomic_fetch_add_explicit(&benchAllocations, 1, memory_order_relaxed);
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size)
+{
+    atomic_fetch_add_explicit(&benchAllocations, 1, memory_order_relaxed);
+    return __libc_calloc(count, size);
+}
+
+void *realloc(void *ptr, size_t size)
+{
+    atomic_fetch_add_explicit(&benchAllocations, 1, memory_order_relaxed);
+    return __libc_realloc(ptr, size);
+}
+
+void *aligned_alloc(size_t alignment, size_t size)
+{
+    atomic_fetch_add_explicit(&benchAllocations, 1, memory_order_relaxed);
+    return __libc_memalign(alignment, size);
+}
+
+void *memalign(size_t alignment, size_t size)
+{
+    atomic_fetch_add_explicit(&benchAllocations, 1, memory_order_relaxed);
+    return __libc_memalign(alignment, size);
+}
+
+int posix_memalign(void **ptr, size_t alignment, size_t size)
+{
+    if (alignment < sizeof(void *) || (alignment & (alignment - 1)) != 0)
+    {
+        return EINVAL;
+    }
+    atomic_fetch_add_explicit(&benchAllocations, 1, memory_order_relaxed);
+    void *p = __libc_memalign(alignment, size);
+    if (p == NULL && size != 0)
+    {
+        return ENOMEM;
+    }
+    *ptr = p;
+    return 0;
+}
+#endif
+
+/** @brief Returns the number of heap allocations made so far, or 0 where they are not counted. */
+static unsigned long long benchAllocationCount(void)
+{
+#if BENCH_COUNT_ALLOCS
+    return atomic_load_explicit(&benchAllocations, memory_order_relaxed);
+#else
+    return 0;
+#endif
+}
+
+/**
+ * @brief State shared by the timed loops of one --bench fixture.
+ */
+typedef struct
+{
+    const char *path;       // where the puzzle is stored on disk
+    const char *savePath;   // scratch file for the save path
+    const LatinBoard *puzzle;
+    LatinBoard work;        // scratch board of the same order
+    CompactBoard *compact;  // scratch compact board of the same order
+    const char *commands;   // move commands covering the whole board
+    size_t commandsLength;
+    int volatile sink;      // keeps results alive across iterations
+} BenchFixture;
+
+/** @brief Loads the fixture file and frees it again. */
+static long benchLoad(BenchFixture *f)
+{
+    LatinBoard board;
+    char err[256];
+    if (loadLatinSquare(f->path, &board, err, sizeof(err)) == -1)
+    {
+        return -1;
+    }
+    f->sink += board.filled;
+    boardFree(&board);
+    return 1;
+}
+
+/** @brief Parses the fixture's move commands; one op per command. */
+static long benchParse(BenchFixture *f)
+{
+    const char *pos = f->commands, *end = f->commands + f->commandsLength;
+    long ops = 0;
+    int i, j, val;
+    while (parseCommand(&pos, end, 1, &i, &j, &val) == CMD_MOVE)
+    {
+        f->sink += i + j + val;
+        ops++;
+    }
+    return ops;
+}
+
+/** @brief Tries every value in every empty cell through applyMove, clearing accepted ones; one op per call. */
+static long benchMoves(BenchFixture *f)
+{
+    int size = f->puzzle->size;
+    long ops = 0;
+    boardAssign(&f->work, f->puzzle);
+    for (int i = 1; i <= size; i++)
+    {
+        for (int j = 1; j <= size; j++)
+        {
+            for (int val = 1; val <= size; val++)
+            {
+                ops++;
+                if (applyMove(&f->work, i, j, val) == MOVE_INSERTED)
+                {
+                    applyMove(&f->work, i, j, 0);
+                    ops++;
+                }
+            }
+        }
+    }
+    return ops;
+}
+
+/** @brief benchMoves() on a compact board, through compactApplyMove(). */
+static long benchMovesCompact(BenchFixture *f)
+{
+    int size = f->puzzle->size;
+    long ops = 0;
+    compactFromBoard(f->compact, f->puzzle);
+    for (int i = 1; i <= size; i++)
+    {
+        for (int j = 1; j <= size; j++)
+        {
+            for (int val = 1; val <= size; val++)
+            {
+                ops++;
+                if (compactApplyMove(f->compact, i, j, val) == MOVE_INSERTED)
+                {
+                    compactApplyMove(f->compact, i, j, 0);
+                    ops++;
+                }
+            }
+        }
+    }
+    return ops;
+}
+
+/** @brief Solves a fresh copy of the puzzle. */
+static long benchSolve(BenchFixture *f)
+{
+    SolveStats stats;
+    boardAssign(&f->work, f->puzzle);
+    f->sink += solveLatinSquare(&f->work, &stats);
+    return 1;
+}
+
+/** @brief Solves a fresh copy of the puzzle with the dancing-links engine. */
+static long benchSolveDlx(BenchFixture *f)
+{
+    DlxMatrix m;
+    boardAssign(&f->work, f->puzzle);
+    if (dlxBuild(&m, &f->work) != 0)
+    {
+        return -1;
+    }
+    f->sink += (int)dlxCountSolutions(&m, 1, &f->work);
+    dlxFree(&m);
+    return 1;
+}
+
+/** @brief Validates the last solution found by benchSolveDlx(). */
+static long benchValidate(BenchFixture *f)
+{
+    f->sink += (int)validateLatinSquare(&f->work, f->puzzle);
+    return 1;
+}
+
+/** @brief Saves the puzzle through the atomic writer. */
+static long benchSave(BenchFixture *f)
+{
+    return saveLatinSquare(f->puzzle, f->savePath) == 0 ? 1 : -1;
+}
+
+/**
+ * @brief Benchmarks every path on one puzzle and prints a line (or JSON object) per path.
+ *
+ * Each path is repeated, doubling the repetitions, until a round takes
+ * at least BENCH_MIN_MS. A puzzle with clashing values has no solve or
+ * validate lines, and the backtracking solver is only timed up to
+ * BENCH_BACKTRACK_MAX_ORDER.
+ *
+ * @param name The fixture name printed in the report.
+ * @param path The puzzle file.
+ * @param puzzle The loaded puzzle.
+ * @param json Non-zero for JSON output.
+ * @param first Non-zero for the first fixture of a JSON report.
+ * @return 0 on success, -1 if some path failed.
+ */
+static int benchFixture(const char *name, const char *path, const LatinBoard *puzzle, int json, int first)
+{
+    static const struct { const char *name; long (*run)(BenchFixture *); int needsSolvable; } paths[] = {
+        {"load", benchLoad, 0}, {"parse", benchParse, 0}, {"move", benchMoves, 0}, {"move-compact", benchMovesCompact, 0},
+        {"solve", benchSolve, 1}, {"solve-dlx", benchSolveDlx, 1}, {"validate", benchValidate, 1},
+        {"save", benchSave, 0}
+    };
+    int size = puzzle->size;
+    char savePath[4096];
+    BenchFixture f;
+    int status = 0;
+
+    memset(&f, 0, sizeof(f));
+    snprintf(savePath, sizeof(savePath), "%s/latinsquare-bench-%ld.txt",
+             getenv("TMPDIR") != NULL ? getenv("TMPDIR") : "/tmp", (long)getpid());
+    f.path = path;
+    f.savePath = savePath;
+    f.puzzle = puzzle;
+
+    // one "i,j=val" command per cell, wrapping the value through 1..size
+    size_t cap = (size_t)size * size * 12 + 1;
+    char *commands = malloc(cap);
+    f.compact = malloc(compactBoardBytes(size));
+    if (commands == NULL || f.compact == NULL || boardCopy(&f.work, puzzle) != 0)
+    {
+        free(commands);
+        free(f.compact);
+        return -1;
+    }
+    size_t len = 0;
+    for (int k = 0; k < size * size; k++)
+    {
+        len += (size_t)snprintf(commands + len, cap - len, "%d,%d=%d\n", k / size + 1, k % size + 1, k % size + 1);
+    }
+    f.commands = commands;
+    f.commandsLength = len;
+
+    int clash = boardHasConflicts(puzzle);
+    for (size_t p = 0; p < sizeof(paths) / sizeof(paths[0]); p++)
+    {
+        if ((paths[p].needsSolvable && clash) || (paths[p].run == benchSolve && size > BENCH_BACKTRACK_MAX_ORDER))
+        {
+            continue;
+        }
+        long ops = 0;
+        double elapsed = 0;
+        unsigned long long allocs = 0;
+        for (long reps = 1; elapsed < BENCH_MIN_MS && status == 0; reps *= 2)
+        {
+            ops = 0;
+            unsigned long long allocStart = benchAllocationCount();
+            double start = monotonicMs();
+            for (long r = 0; r < reps; r++)
+            {
+                long done = paths[p].run(&f);
+                if (done < 0)
+                {
+                    status = -1;
+                    break;
+                }
+                ops += done;
+            }
+            elapsed = monotonicMs() - start;
+            allocs = benchAllocationCount() - allocStart;
+        }
+        if (status != 0 || ops == 0)
+        {
+            status = -1;
+            break;
+        }
+
+        double nsPerOp = elapsed * 1e6 / ops;
+        if (json)
+        {
+            printf("%s\n    {\"fixture\": \"%s\", \"order\": %d, \"path\": \"%s\", \"ops\": %ld, "
+                   "\"ns_per_op\": %.1f, \"allocs_per_op\": %.3f}",
+                   (first && p == 0) ? "" : ",", name, size, paths[p].name, ops, nsPerOp,
+                   BENCH_COUNT_ALLOCS ? (double)allocs / ops : -1.0);
+        }
+        else if (BENCH_COUNT_ALLOCS)
+        {
+            printf("%s\t%d\t%s\t%ld\t%.1f\t%.3f\n", name, size, paths[p].name, ops, nsPerOp, (double)allocs / ops);
+        }
+        else
+        {
+            printf("%s\t%d\t%s\t%ld\t%.1f\t-\n", name, size, paths[p].name, ops, nsPerOp);
+        }
+    }
+
+    unlink(savePath);
+    boardFree(&f.work);
+    free(f.compact);
+    free(commands);
+    return status;
+}
+
+/**
+ * @brief Runs --bench mode: times the load, parse, move, solve, validate and save paths.
+ *
+ * Runs over the given puzzle files (by default the fixtures shipped
+ * with the game) plus a 16x16 and a 25x25 puzzle made by the generator
+ * from a fixed seed. Reports ns/op and heap allocations per op as tab
+ * separated lines, or as one JSON document for regression tracking.
+ *
+ * @param files The puzzle files, or NULL for the default fixtures.
+ * @param fileCount Number of files.
+ * @param json Non-zero for JSON output.
+ * @return Exit status code: 0 on success, 1 if a fixture failed.
+ */
+int runBench(char **files, int fileCount, int json)
+{
+    static char *defaults[] = {"inputfile.txt", "inputfile8.txt", "file9.txt"};
+    static const int generatedOrders[] = {16, 25};
+    int status = 0, first = 1;
+    char err[256];
+
+    if (files == NULL || fileCount == 0)
+    {
+        files = defaults;
+        fileCount = (int)(sizeof(defaults) / sizeof(defaults[0]));
+    }
+
+    if (json)
+    {
+        printf("{\n  \"allocations_counted\": %s,\n  \"benchmarks\": [", BENCH_COUNT_ALLOCS ? "true" : "false");
+    }
+    else
+    {
+        printf("# fixture\torder\tpath\tops\tns/op\tallocs/op\n");
+    }
+
+    for (int f = 0; f < fileCount; f++)
+    {
+        LatinBoard puzzle;
+        if (loadLatinSquare(files[f], &puzzle, err, sizeof(err)) == -1)
+        {
+            fprintf(stderr, "Error: %s\n", err);
+            status = 1;
+            continue;
+        }
+        status |= benchFixture(files[f], files[f], &puzzle, json, first) != 0;
+        first = 0;
+        boardFree(&puzzle);
+    }
+
+    int8_t *cube = malloc((size_t)MAX_ORDER * MAX_ORDER * MAX_ORDER);
+    for (size_t g = 0; cube != NULL && g < sizeof(generatedOrders) / sizeof(generatedOrders[0]); g++)
+    {
+        int n = generatedOrders[g];
+        uint64_t rng = (uint64_t)n;
+        char name[32], path[4096];
+        LatinBoard puzzle;
+
+        snprintf(name, sizeof(name), "generated-%dx%d", n, n);
+        snprintf(path, sizeof(path), "%s/latinsquare-bench-%ld-%d.txt",
+                 getenv("TMPDIR") != NULL ? getenv("TMPDIR") : "/tmp", (long)getpid(), n);
+        if (boardInit(&puzzle, n) != 0 || randomLatinSquare(&puzzle, cube, &rng) != 0 ||
+            makePuzzle(&puzzle, n * n * 60 / 100, &rng) != 0 || saveLatinSquare(&puzzle, path) != 0)
+        {
+            boardFree(&puzzle);
+            status = 1;
+            continue;
+        }
+        status |= benchFixture(name, path, &puzzle, json, first) != 0;
+        first = 0;
+        unlink(path);
+        boardFree(&puzzle);
+    }
+    status |= cube == NULL;
+    free(cube);
+
+    if (json)
+    {
+        printf("\n  ]\n}\n");
+    }
+    return status;
+}
+
+/**
+ * @brief Queues bytes for a session, sending at once what the socket takes.
+ *
+ * Output that does not fit goes to a heap buffer owned by the session
+ * and EPOLLOUT is armed until it drains, so idle sessions hold no
+ * output buffer at all.
+ *
+ * @return 0 on success, -1 if the session must be closed.
+ */
+static int serverSend(ServerLoop *loop, ServerSession *s, const char *data, size_t len)
+{
+    if (s->out == NULL)
+    {
+        while (len > 0)
+        {
+            ssize_t sent = send(s->fd, data, len, MSG_NOSIGNAL);
+            if (sent < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            if (sent < 0 && errno != EAGAIN && errno != EWOULDBLOCK)
+            {
+                return -1;
+            }
+            if (sent < 0)
+            {
+                break;
+            }
+            data += sent;
+            len -= (size_t)sent;
+        }
+        if (len == 0)
+        {
+            return 0;
+        }
+    }
+
+    char *grown = realloc(s->out, s->outLen + len);
+    if (grown == NULL)
+    {
+        return -1;
+    }
+    memcpy(grown + s->outLen, data, len);
+    if (s->out == NULL)
+    {
+        struct epoll_event ev = {s->closing ? EPOLLOUT : EPOLLIN | EPOLLOUT, {.ptr = s}};
+        epoll_ctl(loop->epollFd, EPOLL_CTL_MOD, s->fd, &ev);
+    }
+    s->out = grown;
+    s->outLen += len;
+    return 0;
+}
+
+/**
+ * @brief Sends as much queued output as the socket takes.
+ *
+ * @return 0 on success, -1 if the session must be closed.
+ */
+static int serverFlush(ServerLoop *loop, ServerSession *s)
+{
+    while (s->outSent < s->outLen)
+    {
+        ssize_t sent = send(s->fd, s->out + s->outSent, s->outLen - s->outSent, MSG_NOSIGNAL);
+        if (sent < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (sent < 0)
+        {
+            return (errno == EAGAIN || errno == EWOULDBLOCK) ? 0 : -1;
+        }
+        s->outSent += (size_t)sent;
+    }
+
+    free(s->out);
+    s->out = NULL;
+    s->outLen = s->outSent = 0;
+    struct epoll_event ev = {s->closing ? 0 : EPOLLIN, {.ptr = s}};
+    epoll_ctl(loop->epollFd, EPOLL_CTL_MOD, s->fd, &ev);
+    return 0;
+}
+
+/**
+ * @brief Hands a session's board to the loop's writer for its own out-<id>-<puzzle> file.
+ *
+ * The player is told once the writer is done (serverSaveDone()).
+ *
+ * @return 0 if the save was queued, -1 on error.
+ */
+static int serverSave(ServerLoop *loop, ServerSession *s)
+{
+    ServerSaveJob *job = malloc(sizeof(ServerSaveJob));
+    if (job == NULL)
+    {
+        return -1;
+    }
+    const char *slash = strrchr(loop->server->puzzleName, '/');
+    snprintf(job->name, sizeof(job->name), "out-%u-%s", s->id, slash != NULL ? slash + 1 : loop->server->puzzleName);
+    job->len = formatLatinSquare(&s->board, job->text);
+    job->session = s;
+    job->failed = 0;
+    s->saving = job;
+
+    pthread_mutex_lock(&loop->saveLock);
+    job->next = loop->saveQueue;
+    loop->saveQueue = job;
+    pthread_cond_signal(&loop->saveWake);
+    pthread_mutex_unlock(&loop->saveLock);
+    return 0;
+}
+
+/** @brief Thread body: writes the saves of one event loop and hands them back. */
+static void *serverWriterMain(void *arg)
+{
+    ServerLoop *loop = arg;
+    pthread_mutex_lock(&loop->saveLock);
+    for (;;)
+    {
+        while (loop->saveQueue == NULL && !loop->saveStop)
+        {
+            pthread_cond_wait(&loop->saveWake, &loop->saveLock);
+        }
+        if (loop->saveQueue == NULL)
+        {
+            break;
+        }
+        ServerSaveJob *queued = loop->saveQueue, *batch = NULL;
+        loop->saveQueue = NULL;
+        pthread_mutex_unlock(&loop->saveLock);
+
+        // the queue is newest first: write the oldest save first
+        while (queued != NULL)
+        {
+            ServerSaveJob *next = queued->next;
+            queued->next = batch;
+            batch = queued;
+            queued = next;
+        }
+        ServerSaveJob *last = batch;
+        for (ServerSaveJob *job = batch; job != NULL; job = job->next)
+        {
+            job->failed = saveText(job->text, job->len, job->name) != 0;
+            last = job;
+        }
+
+        pthread_mutex_lock(&loop->saveLock);
+        last->next = loop->saveDone;
+        loop->saveDone = batch;
+        uint64_t one = 1;
+        ssize_t ignored = write(loop->saveFd, &one, sizeof(one));
+        (void)ignored;
+    }
+    pthread_mutex_unlock(&loop->saveLock);
+    return NULL;
+}
+
+/**
+ * @brief Hints the first empty cell from the puzzle's solution while the board still agrees with it.
+ *
+ * @return 0 if msg was written, -1 if some entered value is not the solution's.
+ */
+static int serverSolutionHint(const LatinBoard *solution, const LatinBoard *board, char *msg, size_t msgSize)
+{
+    int n = board->size, empty = -1;
+    for (int k = 0; k < n * n; k++)
+    {
+        if (board->cells[k] == 0)
+        {
+            empty = (empty < 0) ? k : empty;
+        }
+        else if (board->cells[k] != solution->cells[k])
+        {
+            return -1;
+        }
+    }
+    if (empty < 0)
+    {
+        return -1;
+    }
+    snprintf(msg, msgSize, "Hint: %d,%d=%d (from the solution)\n\n", empty / n + 1, empty % n + 1,
+             solution->cells[empty]);
+    return 0;
+}
+
+/**
+ * @brief Applies one command of a session and sends the reply.
+ *
+ * The reply is the same message play() prints, followed by the board
+ * after a change. A save request or a completed square saves the
+ * board and ends the session.
+ *
+ * @return 0 to keep the session, 1 once it is finished, -1 on error.
+ */
+static int serverCommand(ServerLoop *loop, ServerSession *s, CommandStatus kind, int i, int j, int val)
+{
+    int cell;
+    char *out = loop->scratch;
+    size_t len = 0;
+    MoveResult result = playCommand(&s->board, NULL, kind, i, j, val, &cell);
+    STAT_MOVE(result);
+
+    if (result == MOVE_SAVE)
+    {
+        return serverSave(loop, s) == 0 ? 1 : -1;
+    }
+
+    if (result == MOVE_HINT)
+    {
+        // hints are rare, so the candidate cache is built on demand instead of kept per session
+        CandidateCache cache;
+        Hint hint;
+        len = (size_t)snprintf(out, SERVER_SCRATCH_SIZE, "Hint: not available\n\n");
+        if (candidatesInit(&cache, &s->board) == 0)
+        {
+            formatHint(&cache, out, SERVER_SCRATCH_SIZE);
+            if (loop->server->solution != NULL && !findHint(&cache, &hint))
+            {
+                serverSolutionHint(loop->server->solution, &s->board, out, SERVER_SCRATCH_SIZE);
+            }
+            len = strlen(out);
+            candidatesFree(&cache);
+        }
+    }
+    else
+    {
+        len = (size_t)snprintf(out, SERVER_SCRATCH_SIZE, moveMessages[result], s->board.size);
+    }
+
+    if (cell >= 0)
+    {
+        int won = s->board.filled == s->board.size * s->board.size;
+        if (won)
+        {
+            len += (size_t)snprintf(out + len, SERVER_SCRATCH_SIZE - len, "Game completed!!!\n");
+        }
+        len += formatGrid(&s->board, out + len);
+        if (serverSend(loop, s, out, len) != 0)
+        {
+            return -1;
+        }
+        if (won)
+        {
+            return serverSave(loop, s) == 0 ? 1 : -1;
+        }
+        return 0;
+    }
+    return serverSend(loop, s, out, len);
+}
+
+/**
+ * @brief Reads what a session sent and runs every complete command in it.
+ *
+ * @return 0 to keep the session, 1 once it is finished, -1 on error or hang up.
+ */
+static int serverRead(ServerLoop *loop, ServerSession *s)
+{
+    for (;;)
+    {
+        ssize_t got = recv(s->fd, s->in + s->inLen, sizeof(s->in) - s->inLen, 0);
+        if (got < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (got < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+        {
+            return 0;
+        }
+        if (got <= 0)
+        {
+            return -1;
+        }
+        s->inLen += (uint16_t)got;
+
+        const char *pos = s->in, *end = s->in + s->inLen;
+        for (;;)
+        {
+            int i = 0, j = 0, val = 0;
+            CommandStatus status;
+            if (s->discarding)
+            {
+                if (!commandSkipLine(&pos, end))
+                {
+                    break;
+                }
+                s->discarding = 0;
+                status = CMD_BAD;
+            }
+            else
+            {
+                status = parseCommand(&pos, end, 0, &i, &j, &val);
+            }
+            if (status == CMD_NEED_MORE || status == CMD_END)
+            {
+                if (pos == s->in && s->inLen == sizeof(s->in))
+                {
+                    // a command as long as the whole buffer can only be garbage: drop it, reject it once
+                    s->discarding = 1;
+                    continue;
+                }
+                break;
+            }
+            int done = serverCommand(loop, s, status, i, j, val);
+            if (done != 0)
+            {
+                return done;
+            }
+        }
+
+        // keep the unparsed tail for the next read
+        s->inLen = (uint16_t)(end - pos);
+        memmove(s->in, pos, s->inLen);
+    }
+}
+
+/** @brief Closes a session and releases everything it holds; a save still in the writer goes on without it. */
+static void serverClose(ServerLoop *loop, ServerSession *s)
+{
+    if (s->saving != NULL)
+    {
+        s->saving->session = NULL;
+    }
+    epoll_ctl(loop->epollFd, EPOLL_CTL_DEL, s->fd, NULL);
+    close(s->fd);
+    boardFree(&s->board);
+    free(s->out);
+    free(s);
+    atomic_fetch_sub(&loop->server->sessions, 1);
+}
+
+/**
+ * @brief Tells each player whose save the writer finished, and closes the sessions that are done.
+ *
+ * Runs only after the session events of an epoll batch, since a session
+ * it closes may still have an event waiting in that batch.
+ */
+static void serverSaveDone(ServerLoop *loop)
+{
+    uint64_t ready;
+    ssize_t ignored = read(loop->saveFd, &ready, sizeof(ready));
+    (void)ignored;
+
+    pthread_mutex_lock(&loop->saveLock);
+    ServerSaveJob *job = loop->saveDone;
+    loop->saveDone = NULL;
+    pthread_mutex_unlock(&loop->saveLock);
+
+    while (job != NULL)
+    {
+        ServerSaveJob *next = job->next;
+        ServerSession *s = job->session;
+        if (s != NULL)
+        {
+            s->saving = NULL;
+            int len = job->failed
+                ? snprintf(loop->scratch, SERVER_SCRATCH_SIZE, "Error : Unable to generate file %s to save the game!\n", job->name)
+                : snprintf(loop->scratch, SERVER_SCRATCH_SIZE, "Saving to %s...\nDone\n", job->name);
+            if (serverSend(loop, s, loop->scratch, (size_t)len) != 0 || s->out == NULL)
+            {
+                serverClose(loop, s);
+            }
+        }
+        free(job);
+        job = next;
+    }
+}
+
+/** @brief Accepts every pending connection and greets it with the board. */
+static void serverAccept(ServerLoop *loop)
+{
+    for (;;)
+    {
+        int fd = accept(loop->listenFd, NULL, NULL);
+        if (fd < 0)
+        {
+            return;
+        }
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+
+        ServerSession *s = calloc(1, sizeof(ServerSession));
+        if (s == NULL || boardCopy(&s->board, loop->server->puzzle) != 0)
+        {
+            free(s);
+            close(fd);
+            continue;
+        }
+        s->fd = fd;
+        s->id = atomic_fetch_add(&loop->server->nextId, 1);
+
+        struct epoll_event ev = {EPOLLIN, {.ptr = s}};
+        if (epoll_ctl(loop->epollFd, EPOLL_CTL_ADD, fd, &ev) != 0)
+        {
+            boardFree(&s->board);
+            free(s);
+            close(fd);
+            continue;
+        }
+        atomic_fetch_add(&loop->server->sessions, 1);
+
+        size_t len = formatGrid(&s->board, loop->scratch);
+        if (serverSend(loop, s, loop->scratch, len) != 0)
+        {
+            serverClose(loop, s);
+        }
+    }
+}
+
+/** @brief Thread body: the epoll loop of one core. */
+static void *serverLoopMain(void *arg)
+{
+    ServerLoop *loop = arg;
+    struct epoll_event events[SERVER_EVENTS];
+    BoardPool pool;
+
+    // session boards come and go on this loop only, so its pool needs no lock
+    if (boardPoolInit(&pool, 0) == 0)
+    {
+        boardPoolUseForThread(&pool);
+    }
+
+    for (;;)
+    {
+        int n = epoll_wait(loop->epollFd, events, SERVER_EVENTS, -1);
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n < 0)
+        {
+            break;
+        }
+        int saved = 0;
+        for (int e = 0; e < n; e++)
+        {
+            ServerSession *s = events[e].data.ptr;
+            if (s == NULL)
+            {
+                serverAccept(loop);
+                continue;
+            }
+            if (events[e].data.ptr == &loop->saveFd)
+            {
+                // finished saves may close sessions that later events of this batch still point to
+                saved = 1;
+                continue;
+            }
+
+            int status = 0;
+            if (events[e].events & (EPOLLERR | EPOLLHUP))
+            {
+                status = -1;
+            }
+            if (status == 0 && (events[e].events & EPOLLOUT))
+            {
+                status = serverFlush(loop, s);
+            }
+            if (status == 0 && s->closing)
+            {
+                // the session is over and waits only for its save and its last output to drain
+                status = (s->out == NULL && s->saving == NULL) ? 1 : 0;
+            }
+            else if (status == 0 && (events[e].events & EPOLLIN))
+            {
+                status = serverRead(loop, s);
+            }
+
+            if (status == 1 && !s->closing && (s->out != NULL || s->saving != NULL))
+            {
+                s->closing = 1;
+                shutdown(s->fd, SHUT_RD);
+                struct epoll_event ev = {s->out != NULL ? EPOLLOUT : 0, {.ptr = s}};
+                epoll_ctl(loop->epollFd, EPOLL_CTL_MOD, s->fd, &ev);
+            }
+            else if (status != 0)
+            {
+                serverClose(loop, s);
+            }
+        }
+        if (saved)
+        {
+            serverSaveDone(loop);
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Opens a non-blocking listening socket on the port.
+ *
+ * SO_REUSEPORT lets every event loop own a socket on the same port, so
+ * the kernel spreads new connections over the loops.
+ *
+ * @return The socket, or -1 on error.
+ */
+static int serverListen(int port)
+{
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    int on = 1;
+    struct sockaddr_in addr;
+
+    if (fd < 0)
+    {
+        return -1;
+    }
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on));
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons((uint16_t)port);
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(fd, SOMAXCONN) != 0)
+    {
+        close(fd);
+        return -1;
+    }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    return fd;
+}
+
+/**
+ * @brief Finds the solution of the served puzzle, through the solve cache when there is one.
+ *
+ * @return 1 if solution holds the solution, 0 otherwise.
+ */
+static int serverSolve(const LatinBoard *puzzle, const char *cachePath, LatinBoard *solution)
+{
+    SolveCache cache;
+    CanonicalForm form;
+    DlxMatrix m;
+    int found = -1;
+    int useCache = cachePath != NULL && canonicalForm(puzzle, &form) == 0;
+
+    if (boardCopy(solution, puzzle) != 0)
+    {
+        return 0;
+    }
+    if (useCache && solveCacheOpen(&cache, cachePath) != 0)
+    {
+        printf("Note: unable to open the solve cache %s\n", cachePath);
+        useCache = 0;
+    }
+    if (useCache)
+    {
+        found = solveCacheLookup(&cache, &form, solution);
+    }
+    if (found < 0 && !boardHasConflicts(puzzle) && dlxBuild(&m, puzzle) == 0)
+    {
+        found = dlxCountSolutions(&m, 1, solution) == 1;
+        dlxFree(&m);
+        if (useCache && solveCacheStore(&cache, &form, found ? solution : NULL) != 0)
+        {
+            printf("Note: unable to write the solve cache %s\n", cachePath);
+        }
+    }
+    if (useCache)
+    {
+        solveCacheClose(&cache);
+    }
+    if (found <= 0)
+    {
+        boardFree(solution);
+        return 0;
+    }
+    return 1;
+}
+
+/**
+ * @brief Runs --serve mode: plays the puzzle with many players over TCP.
+ *
+ * Every connection is a separate game of the same puzzle with its own
+ * board. Players send the usual i,j=val commands (u/r are
+ * refused: sessions keep no journal), get play()'s messages back and
+ * see the board after every change. 0,0=0 or a completed square saves
+ * the session to out-<id>-<puzzle> and closes it; the file is written
+ * by a writer thread of the session's loop, and the player told when it
+ * is on disk. One epoll loop runs per thread; the server runs until it
+ * is killed. The puzzle is solved
+ * once at startup, or its solution taken from the solve cache, so a
+ * '?' with no forced cell can still be answered.
+ *
+ * @param puzzle The loaded puzzle.
+ * @param puzzleName The puzzle's file name, used in the save file names.
+ * @param port The TCP port.
+ * @param threads Number of event loops.
+ * @param cachePath The solve cache file, or NULL for none.
+ * @return Exit status code: 1 if the server could not start.
+ */
+int runServer(const LatinBoard *puzzle, const char *puzzleName, int port, int threads, const char *cachePath)
+{
+    GameServer server;
+    LatinBoard solution;
+    server.puzzle = puzzle;
+    server.puzzleName = puzzleName;
+    server.solution = serverSolve(puzzle, cachePath, &solution) ? &solution : NULL;
+    atomic_init(&server.nextId, 1);
+    atomic_init(&server.sessions, 0);
+
+    ServerLoop *loops = calloc((size_t)threads, sizeof(ServerLoop));
+    int started = 0;
+    for (; loops != NULL && started < threads; started++)
+    {
+        ServerLoop *loop = &loops[started];
+        struct epoll_event ev = {EPOLLIN, {.ptr = NULL}};
+        struct epoll_event saveEv = {EPOLLIN, {.ptr = &loop->saveFd}};
+        loop->server = &server;
+        loop->scratch = malloc(SERVER_SCRATCH_SIZE);
+        loop->listenFd = serverListen(port);
+        loop->epollFd = epoll_create1(0);
+        loop->saveFd = eventfd(0, EFD_NONBLOCK);
+        pthread_mutex_init(&loop->saveLock, NULL);
+        pthread_cond_init(&loop->saveWake, NULL);
+        int haveWriter = 0;
+        if (loop->scratch == NULL || loop->listenFd < 0 || loop->epollFd < 0 || loop->saveFd < 0 ||
+            epoll_ctl(loop->epollFd, EPOLL_CTL_ADD, loop->listenFd, &ev) != 0 ||
+            epoll_ctl(loop->epollFd, EPOLL_CTL_ADD, loop->saveFd, &saveEv) != 0 ||
+            !(haveWriter = (pthread_create(&loop->writer, NULL, serverWriterMain, loop) == 0)) ||
+            pthread_create(&loop->thread, NULL, serverLoopMain, loop) != 0)
+        {
+            if (haveWriter)
+            {
+                pthread_mutex_lock(&loop->saveLock);
+                loop->saveStop = 1;
+                pthread_cond_signal(&loop->saveWake);
+                pthread_mutex_unlock(&loop->saveLock);
+                pthread_join(loop->writer, NULL);
+            }
+            pthread_mutex_destroy(&loop->saveLock);
+            pthread_cond_destroy(&loop->saveWake);
+            free(loop->scratch);
+            if (loop->listenFd >= 0)
+            {
+                close(loop->listenFd);
+            }
+            if (loop->epollFd >= 0)
+            {
+                close(loop->epollFd);
+            }
+            if (loop->saveFd >= 0)
+            {
+                close(loop->saveFd);
+            }
+            break;
+        }
+    }
+
+    if (started == 0)
+    {
+        printf("Error: Unable to serve on port %d\n", port);
+        free(loops);
+        if (server.solution != NULL)
+        {
+            boardFree(&solution);
+        }
+        return 1;
+    }
+    printf("Serving %s on port %d with %d event loops\n", puzzleName, port, started);
+    fflush(stdout);
+
+    for (int t = 0; t < started; t++)
+    {
+        pthread_join(loops[t].thread, NULL);
+    }
+    free(loops);
+    return 1;
+}
+
+/**
+ * @brief Prints the session counters to stderr, for --stats.
+ *
+ * Without -DLATINSQUARE_STATS there is nothing to report and a note
+ * says how to turn the counters on.
+ */
+void statsReport(void)
+{
+    fflush(stdout);
+#ifdef LATINSQUARE_STATS
+    static const char *counterNames[STAT_COUNTER_COUNT] = {
+        "moves attempted", "rejected format", "rejected range", "rejected occupied",
+        "rejected given-clear", "rejected rule"
+    };
+    static const char *timerNames[STAT_TIMER_COUNT] = {"parse", "validation", "render", "read", "write"};
+
+    fprintf(stderr, "Statistics:\n");
+    for (int c = 0; c < STAT_COUNTER_COUNT; c++)
+    {
+        fprintf(stderr, "  %-22s %llu\n", counterNames[c],
+                atomic_load_explicit(&sessionStats.count[c], memory_order_relaxed));
+    }
+    for (int t = 0; t < STAT_TIMER_COUNT; t++)
+    {
+        fprintf(stderr, "  %-22s %.3f ms in %llu calls\n", timerNames[t],
+                atomic_load_explicit(&sessionStats.ns[t], memory_order_relaxed) / 1e6,
+                atomic_load_explicit(&sessionStats.calls[t], memory_order_relaxed));
+    }
+#else
+    fprintf(stderr, "Note: statistics are compiled out, rebuild with -DLATINSQUARE_STATS to collect them\n");
+#endif
+}
+
+#ifdef LATINSQUARE_FUZZ
+/** @brief Stops the fuzzer on a broken invariant; it records the input that did it. */
+static void fuzzCheck(int ok, const char *what)
+{
+    if (!ok)
+    {
+        printf("Error: %s\n", what);
+        fflush(stdout);
+        abort();
+    }
+}
+
+/**
+ * @brief Checks that a compact board formats and unpacks exactly like the board it plays along with.
+ *
+ * @param board The board.
+ * @param cb The compact board holding the same cells and givens.
+ */
+static void fuzzCheckCompact(const LatinBoard *board, const CompactBoard *cb)
+{
+    int n = board->size;
+    char *text = malloc(2 * (size_t)SAVE_BUFFER_SIZE);
+    char *grid = malloc(2 * (size_t)GRID_BUFFER_SIZE);
+    LatinBoard back;
+
+    if (text != NULL && grid != NULL)
+    {
+        size_t len = formatLatinSquare(board, text);
+        fuzzCheck(formatCompactSquare(cb, text + SAVE_BUFFER_SIZE) == len &&
+                  memcmp(text, text + SAVE_BUFFER_SIZE, len) == 0,
+                  "the compact board saved different text");
+        len = formatGrid(board, grid);
+        fuzzCheck(formatCompactGrid(cb, grid + GRID_BUFFER_SIZE) == len && memcmp(grid, grid + GRID_BUFFER_SIZE, len) == 0,
+                  "the compact board drew a different grid");
+    }
+    free(text);
+    free(grid);
+
+    if (compactToBoard(&back, cb) == 0)
+    {
+        fuzzCheck(memcmp(back.cells, board->cells, (size_t)n * n) == 0 &&
+                  memcmp(back.given, board->given, (size_t)(n * n + 63) / 64 * sizeof(uint64_t)) == 0 &&
+                  back.filled == board->filled &&
+                  memcmp(back.rowMask, board->rowMask, (size_t)n * sizeof(uint64_t)) == 0 &&
+                  memcmp(back.colMask, board->colMask, (size_t)n * sizeof(uint64_t)) == 0,
+                  "the compact board unpacked to a different board");
+        boardFree(&back);
+    }
+}
+
+/**
+ * @brief Reads the commands through a CommandReader, as play() does, and checks it agrees.
+ *
+ * A command longer than the reader's buffer is rejected by the reader as
+ * one malformed line. That is what parseCommand() makes of a long line
+ * that is bad anyway; past any other long command (a move, a keyword, a
+ * command spread over lines) the two no longer line up and the check ends.
+ *
+ * @param pos Start of the commands.
+ * @param end End of the input.
+ */
+static void fuzzCheckReader(const char *pos, const char *end)
+{
+    static FILE *scratch;
+    if (scratch == NULL && (scratch = tmpfile()) == NULL)
+    {
+        return;
+    }
+    int fd = fileno(scratch);
+    size_t len = (size_t)(end - pos);
+    if (ftruncate(fd, 0) != 0 || pwrite(fd, pos, len, 0) != (ssize_t)len || lseek(fd, 0, SEEK_SET) != 0)
+    {
+        return;
+    }
+
+    CommandReader reader;
+    commandReaderInit(&reader, fd);
+    for (;;)
+    {
+        int i = 0, j = 0, val = 0, ri = 0, rj = 0, rval = 0;
+        while (pos < end && (*pos == ' ' || *pos == '\t' || *pos == '\n' || *pos == '\r' || *pos == '\v' || *pos == '\f'))
+        {
+            pos++;
+        }
+        const char *start = pos;
+        CommandStatus kind = parseCommand(&pos, end, 1, &i, &j, &val);
+        CommandStatus read = commandRead(&reader, &ri, &rj, &rval);
+        if ((size_t)(pos - start) >= COMMAND_READER_SIZE)
+        {
+            const char *newline = memchr(start, '\n', (size_t)(pos - start));
+            if (kind != CMD_BAD || (newline != NULL && newline + 1 != pos))
+            {
+                return;
+            }
+        }
+        fuzzCheck(read == kind && (kind != CMD_MOVE || (ri == i && rj == j && rval == val)),
+                  "a command read through a CommandReader differed from the same command in memory");
+        if (kind == CMD_END)
+        {
+            return;
+        }
+    }
+}
+
+/**
+ * @brief libFuzzer and AFL++ entry point: loads a puzzle and replays commands on it.
+ *
+ * The input is a puzzle record as in a puzzle file, followed by
+ * commands as typed in a game; input that does not start with a valid
+ * record is replayed on an empty FUZZ_DEFAULT_ORDER board. Parsing and
+ * the move rules are checked against each other on the way: the same
+ * commands arriving in small pieces and through a CommandReader
+ * (fuzzCheckReader()), a compact board playing along and at the end
+ * saving, drawing and unpacking like the board (fuzzCheckCompact()),
+ * masks that match the cells, givens that never change and, when the
+ * whole history fits in the journal, undo leading back to the puzzle.
+ * Build with -DLATINSQUARE_FUZZ, adding -fsanitize=fuzzer for libFuzzer
+ * or -DLATINSQUARE_FUZZ_MAIN for a stand-alone driver.
+ *
+ * @param data The input.
+ * @param size Bytes of input.
+ * @return 0; a failed check aborts.
+ */
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    const char *text = (const char *)data, *end = text + size;
+    ParseCursor cur = {text, end, 1, text};
+    LatinBoard board, start;
+    MoveJournal journal;
+    char err[256];
+
+    int n = parseLatinSquare(&cur, &board, err, sizeof(err));
+    const char *pos = (n > 0) ? cur.pos : text;
+    if (n <= 0 && boardInit(&board, FUZZ_DEFAULT_ORDER) != 0)
+    {
+        return 0;
+    }
+    n = board.size;
+    fuzzCheck(boardCheckMasks(&board) == 0, "a loaded board fails its own masks");
+
+    CompactBoard *cb = malloc(compactBoardBytes(n));
+    int ready = (cb != NULL);
+    ready = ready && boardCopy(&start, &board) == 0;
+    if (!ready || journalInit(&journal, FUZZ_JOURNAL_CAPACITY) != 0)
+    {
+        if (ready)
+        {
+            boardFree(&start);
+        }
+        free(cb);
+        boardFree(&board);
+        return 0;
+    }
+    compactFromBoard(cb, &board);
+    int clean = !boardHasConflicts(&board);
+    fuzzCheckReader(pos, end);
+
+    // the same commands again, handed over a few bytes at a time like a socket or a pipe does
+    size_t step = 1 + size % 13;
+    const char *piecePos = pos, *pieceEnd = pos;
+    unsigned long long records = 0;
+    for (;;)
+    {
+        int i = 0, j = 0, val = 0, pi = 0, pj = 0, pval = 0, cell;
+        CommandStatus kind = parseCommand(&pos, end, 1, &i, &j, &val);
+        CommandStatus piece;
+        while ((piece = parseCommand(&piecePos, pieceEnd, pieceEnd == end, &pi, &pj, &pval)) == CMD_NEED_MORE)
+        {
+            pieceEnd = ((size_t)(end - pieceEnd) > step) ? pieceEnd + step : end;
+        }
+        fuzzCheck(piece == kind && piecePos == pos && (kind != CMD_MOVE || (pi == i && pj == j && pval == val)),
+                  "a command parsed differently when its input arrived in pieces");
+        if (kind == CMD_END)
+        {
+            break;
+        }
+
+        int inside = (kind == CMD_MOVE) && i >= 1 && i <= n && j >= 1 && j <= n;
+        int before = inside ? boardGet(&board, i - 1, j - 1) : 0;
+        MoveResult result = playCommand(&board, &journal, kind, i, j, val, &cell);
+        if (kind == CMD_MOVE)
+        {
+            fuzzCheck(compactApplyMove(cb, i, j, val) == result, "the compact board judged a move differently");
+            records += (result == MOVE_INSERTED || result == MOVE_CLEARED) && before != val;
+        }
+        else if (cell >= 0)
+        {
+            compactFromBoard(cb, &board); // undo and redo only go through the journal
+        }
+        if (inside)
+        {
+            fuzzCheck(compactGet(cb, i - 1, j - 1) == boardGet(&board, i - 1, j - 1),
+                      "the compact board holds a different value");
+        }
+        fuzzCheck(boardCheckMasks(&board) == 0, "the occupancy masks fell out of step with the cells");
+    }
+
+    int cells = n * n;
+    fuzzCheck(memcmp(board.given, start.given, (size_t)(cells + 63) / 64 * sizeof(uint64_t)) == 0,
+              "the givens bitset changed");
+    for (int k = 0; k < cells; k++)
+    {
+        fuzzCheck(!((start.given[k >> 6] >> (k & 63)) & 1) || board.cells[k] == start.cells[k], "a given cell changed");
+    }
+    fuzzCheckCompact(&board, cb);
+    if (clean && records < FUZZ_JOURNAL_CAPACITY)
+    {
+        // nothing fell out of the journal, so undoing everything gives the puzzle back
+        while (journalUndo(&journal, &board) >= 0)
+        {
+        }
+        fuzzCheck(memcmp(board.cells, start.cells, (size_t)cells) == 0, "undoing every move did not restore the puzzle");
+    }
+
+    journalFree(&journal);
+    boardFree(&start);
+    free(cb);
+    boardFree(&board);
+    return 0;
+}
+
+#ifdef LATINSQUARE_FUZZ_MAIN
+/** @brief Reads all of fd into a new buffer; NULL on failure. */
+static uint8_t *fuzzReadAll(int fd, size_t *size)
+{
+    size_t capacity = 4096, len = 0;
+    uint8_t *buf = malloc(capacity);
+    ssize_t got;
+    while (buf != NULL && (got = read(fd, buf + len, capacity - len)) > 0)
+    {
+        len += (size_t)got;
+        if (len == capacity)
+        {
+            uint8_t *grown = realloc(buf, capacity * 2);
+            if (grown == NULL)
+            {
+                free(buf);
+                return NULL;
+            }
+            buf = grown;
+            capacity *= 2;
+        }
+    }
+    *size = len;
+    return buf;
+}
+
+/**
+ * @brief Stand-alone fuzz driver: runs LLVMFuzzerTestOneInput() on each named file, or on stdin.
+ *
+ * This is the harness for AFL (stdin, in persistent mode under
+ * afl-clang-fast) and for replaying a crash or a corpus. Inputs slower
+ * than FUZZ_SLOW_MS are reported.
+ *
+ * @param argc The number of command-line arguments.
+ * @param argv The input files; none to read stdin.
+ * @return Exit status code: 0 on success, 1 if an input could not be read.
+ */
+int main(int argc, char *argv[])
+{
+#ifdef __AFL_HAVE_MANUAL_CONTROL
+    if (argc < 2)
+    {
+        while (__AFL_LOOP(10000))
+        {
+            size_t size;
+            uint8_t *data = fuzzReadAll(STDIN_FILENO, &size);
+            if (data != NULL)
+            {
+                LLVMFuzzerTestOneInput(data, size);
+            }
+            free(data);
+        }
+        return 0;
+    }
+#endif
+    int status = 0, slow = 0;
+    double slowest = 0;
+    const char *slowestName = "-";
+    for (int a = (argc < 2) ? 0 : 1; a < argc; a++)
+    {
+        const char *name = (argc < 2) ? "-" : argv[a];
+        int fd = (argc < 2) ? STDIN_FILENO : open(name, O_RDONLY);
+        size_t size = 0;
+        uint8_t *data = (fd >= 0) ? fuzzReadAll(fd, &size) : NULL;
+        if (fd > STDIN_FILENO)
+        {
+            close(fd);
+        }
+        if (data == NULL)
+        {
+            printf("Error: Unable to access file %s\n", name);
+            status = 1;
+            continue;
+        }
+
+        double t0 = monotonicMs();
+        LLVMFuzzerTestOneInput(data, size);
+        double ms = monotonicMs() - t0;
+        free(data);
+        if (ms > FUZZ_SLOW_MS)
+        {
+            printf("Note: %s is slow (%.3f ms)\n", name, ms);
+            slow++;
+        }
+        if (ms >= slowest)
+        {
+            slowest = ms;
+            slowestName = name;
+        }
+    }
+    printf("Fuzz: %d inputs, %d slow, slowest %.3f ms (%s)\n", (argc < 2) ? 1 : argc - 1, slow, slowest, slowestName);
+    return status;
+}
+#endif
+#else
+/**
+ * @brief Main function to run the Latin square game.
+ * 
+ * This function serves as the entry point of the program. It 
+ * processes command-line arguments to obtain the input file name, 
+ * reads the Latin square from the file, and starts the gameplay 
+ * loop.
+ * 
+ * @see readLatinSquare(const char *filename, LatinBoard *board)
+ * @see play(LatinBoard *board, int isDispNeeded, int incremental, char *outFileName)
+ * @param argc The number of command-line arguments.
+ * @param argv An array of command-line argument strings.
+ * @return Exit status code: 0 on success, non-zero on error.
+ */
+int main(int argc, char *argv[])
+{
+    int solveMode = 0;            // --solve: solve the puzzle instead of playing it
+    int countMode = 0;            // --count-solutions: count completions with DLX
+    unsigned long long limit = 0; // --limit K: stop counting after K solutions
+    int threads = 1;              // --threads N: worker threads, 0 = one per core
+    const char *batchPath = NULL; // --batch PATH: process a packed corpus, directory or list of puzzles
+    const char *streamPath = NULL; // --stream PATH: check and solve back-to-back records from a file or stdin
+    const char *cachePath = NULL; // --cache FILE: persistent solve results for --batch --solve and --serve
+    const char *cnfOut = NULL;    // --export-cnf OUT: write the puzzle as DIMACS CNF
+    const char *modelIn = NULL;   // --import-model MODEL: complete the puzzle from a SAT solver's model
+    const char *packOut = NULL;   // --pack OUT SRC: convert text puzzles into a packed corpus
+    const char *unpackIn = NULL;  // --unpack IN DIR: convert a packed corpus into text puzzles
+    const char *modeArg = NULL;   // second argument of --pack / --unpack
+    const char *analyzeLog = NULL; // --analyze LOG OUT: per-player metrics of recorded sessions
+    const char *analyzeOut = NULL;
+    int plainMode = 0;            // --plain: reprint the whole board after every move, even on a tty
+    int rateMode = 0;             // --rate: rate the difficulty of every --batch puzzle
+    int autosaveMode = 0;         // --autosave: save in the background after every move
+    int scriptMode = 0;           // --script: replay commands from stdin and print only a summary
+    int resumeMode = 0;           // --resume: continue from out-<file> and its journal
+    int statsMode = 0;            // --stats: print the session counters on exit
+    int servePort = 0;            // --serve PORT: play the puzzle with many players over TCP
+    int validateMode = 0;         // --validate: check for a complete Latin square that keeps its givens
+    int benchMode = 0;            // --bench [--json] [files]: time the load, move, solve and save paths
+    int stressMode = 0;           // --stress: fire random commands at the move engine and the loader
+    int jsonMode = 0;             // --json: machine readable --bench report
+    char **benchFiles = NULL;     // files named on a --bench command line
+    int benchFileCount = 0;
+    char **generateArgs = NULL;   // --generate ORDER DIFFICULTY COUNT: write random puzzles to stdout
+    uint64_t seed = (uint64_t)time(NULL) ^ ((uint64_t)getpid() << 32); // --seed S: seed of --generate
+    const char *fileName = NULL;
+
+    for (int a = 1; a < argc; a++)
+    {
+        if (strcmp(argv[a], "--solve") == 0)
+        {
+            solveMode = 1;
+        }
+        else if (strcmp(argv[a], "--resume") == 0)
+        {
+            resumeMode = 1;
+        }
+        else if (strcmp(argv[a], "--validate") == 0)
+        {
+            validateMode = 1;
+        }
+        else if (strcmp(argv[a], "--bench") == 0)
+        {
+            benchMode = 1;
+        }
+        else if (strcmp(argv[a], "--json") == 0)
+        {
+            jsonMode = 1;
+        }
+        else if (strcmp(argv[a], "--stats") == 0)
+        {
+            statsMode = 1;
+        }
+        else if (strcmp(argv[a], "--serve") == 0)
+        {
+            char *end;
+            long port = (a + 1 < argc) ? strtol(argv[a + 1], &end, 10) : -1;
+            if (a + 1 >= argc || *end != '\0' || port < 1 || port > 65535)
+            {
+                printf("Error: --serve expects a port in [1..65535]\n");
+                return 1;
+            }
+            servePort = (int)port;
+            a++;
+        }
+        else if (strcmp(argv[a], "--script") == 0)
+        {
+            scriptMode = 1;
+        }
+        else if (strcmp(argv[a], "--plain") == 0)
+        {
+            plainMode = 1;
+        }
+        else if (strcmp(argv[a], "--autosave") == 0)
+        {
+            autosaveMode = 1;
+        }
+        else if (strcmp(argv[a], "--stress") == 0)
+        {
+            stressMode = 1;
+        }
+        else if (strcmp(argv[a], "--rate") == 0)
+        {
+            rateMode = 1;
+        }
+        else if (strcmp(argv[a], "--count-solutions") == 0)
+        {
+            countMode = 1;
+        }
+        else if (strcmp(argv[a], "--limit") == 0)
+        {
+            char *end;
+            if (a + 1 >= argc || (limit = strtoull(argv[a + 1], &end, 10), *end != '\0' || argv[a + 1][0] == '-'))
+            {
+                printf("Error: --limit expects a non-negative number\n");
+                return 1;
+            }
+            a++;
+        }
+        else if (strcmp(argv[a], "--batch") == 0)
+        {
+            if (a + 1 >= argc)
+            {
+                printf("Error: --batch expects a directory or a list file\n");
+                return 1;
+            }
+            batchPath = argv[++a];
+        }
+        else if (strcmp(argv[a], "--export-cnf") == 0 || strcmp(argv[a], "--import-model") == 0)
+        {
+            if (a + 1 >= argc)
+            {
+                printf("Error: %s expects a file name\n", argv[a]);
+                return 1;
+            }
+            if (argv[a][2] == 'e')
+            {
+                cnfOut = argv[a + 1];
+            }
+            else
+            {
+                modelIn = argv[a + 1];
+            }
+            a++;
+        }
+        else if (strcmp(argv[a], "--analyze") == 0)
+        {
+            if (a + 2 >= argc)
+            {
+                printf("Error: --analyze expects a move log and an output file\n");
+                return 1;
+            }
+            analyzeLog = argv[a + 1];
+            analyzeOut = argv[a + 2];
+            a += 2;
+        }
+        else if (strcmp(argv[a], "--cache") == 0)
+        {
+            if (a + 1 >= argc)
+            {
+                printf("Error: --cache expects a file name\n");
+                return 1;
+            }
+            cachePath = argv[++a];
+        }
+        else if (strcmp(argv[a], "--stream") == 0)
+        {
+            if (a + 1 >= argc)
+            {
+                printf("Error: --stream expects a file name or -\n");
+                return 1;
+            }
+            streamPath = argv[++a];
+        }
+        else if (strcmp(argv[a], "--pack") == 0 || strcmp(argv[a], "--unpack") == 0)
+        {
+            if (a + 2 >= argc)
+            {
+                printf("Error: %s expects two arguments\n", argv[a]);
+                return 1;
+            }
+            if (argv[a][2] == 'p')
+            {
+                packOut = argv[a + 1];
+            }
+            else
+            {
+                unpackIn = argv[a + 1];
+            }
+            modeArg = argv[a + 2];
+            a += 2;
+        }
+        else if (strcmp(argv[a], "--generate") == 0)
+        {
+            if (a + 3 >= argc)
+            {
+                printf("Error: --generate expects an order, a difficulty and a count\n");
+                return 1;
+            }
+            generateArgs = &argv[a + 1];
+            a += 3;
+        }
+        else if (strcmp(argv[a], "--seed") == 0)
+        {
+            char *end;
+            if (a + 1 >= argc || (seed = strtoull(argv[a + 1], &end, 10), *end != '\0' || argv[a + 1][0] == '-'))
+            {
+                printf("Error: --seed expects a non-negative number\n");
+                return 1;
+            }
+            a++;
+        }
+        else if (strcmp(argv[a], "--threads") == 0)
+        {
+            char *end;
+            long t = (a + 1 < argc) ? strtol(argv[a + 1], &end, 10) : -1;
+            if (a + 1 >= argc || *end != '\0' || t < 0 || t > 1024)
+            {
+                printf("Error: --threads expects a number in [0..1024]\n");
+                return 1;
+            }
+            threads = (t == 0) ? (int)sysconf(_SC_NPROCESSORS_ONLN) : (int)t;
+            if (threads < 1)
+            {
+                threads = 1;
+            }
+            a++;
+        }
+        else if (strncmp(argv[a], "--", 2) == 0)
+        {
+            printf("Error: unknown option %s\n", argv[a]);
+            return 1;
+        }
+        else if (benchMode)
+        {
+            // every file named with --bench is a fixture
+            if (benchFiles == NULL && (benchFiles = calloc((size_t)argc, sizeof(char *))) == NULL)
+            {
+                printf("Error: Unable to allocate memory for the benchmark\n");
+                return 1;
+            }
+            benchFiles[benchFileCount++] = argv[a];
+        }
+        else
+        {
+            fileName = argv[a];
+        }
+    }
+
+    if (benchMode)
+    {
+        int status = runBench(benchFiles, benchFileCount, jsonMode);
+        free(benchFiles);
+        return status;
+    }
+
+    if (generateArgs != NULL)
+    {
+        char *end1, *end2;
+        long order = strtol(generateArgs[0], &end1, 10);
+        long count = strtol(generateArgs[2], &end2, 10);
+        if (*end1 != '\0' || *end2 != '\0' || count < 0 || count > 100000000)
+        {
+            order = 0;
+        }
+        return runGenerate((int)order, generateArgs[1], (int)count, seed, threads);
+    }
+
+    if (packOut != NULL)
+    {
+        return runPack(packOut, modeArg);
+    }
+
+    if (unpackIn != NULL)
+    {
+        return runUnpack(unpackIn, modeArg);
+    }
+
+    if (streamPath != NULL)
+    {
+        return runStream(streamPath, limit);
+    }
+
+    if (analyzeLog != NULL)
+    {
+        return runAnalyze(analyzeLog, analyzeOut, threads);
+    }
+
+    if (batchPath != NULL)
+    {
+        BatchAction action = validateMode ? BATCH_VALIDATE : countMode ? BATCH_COUNT
+                           : solveMode ? BATCH_SOLVE : BATCH_CHECK;
+        return runBatch(batchPath, action, limit, threads, cachePath, rateMode);
+    }
+
+    //check if no input file was provided
+    if (fileName == NULL)
+    {
+        printf("Usage: %s [--resume] [--stats] [--autosave] [--plain | --script | --solve | --validate | --count-solutions [--limit K]] [--threads N] <filename>\n"
+               "       %s --export-cnf <out.cnf> <filename>  |  --import-model <model> <filename>\n"
+               "       %s --batch <corpus|dir|listfile|-> [--rate] [--solve [--cache FILE] | --validate | --count-solutions [--limit K]] [--threads N]\n"
+               "       %s --stream <file|-> [--limit K]\n"
+               "       %s --analyze <movelog|-> <out.lsqs> [--threads N]\n"
+               "       %s --pack <corpus> <dir|listfile|->  |  --unpack <corpus> <dir>\n"
+               "       %s --generate <order> <easy|medium|hard|minimal|percent> <count> [--seed S] [--threads N]\n"
+               "       %s --bench [--json] [files...]\n"
+               "       %s --stress [--limit K] [--threads N] [--seed S] <filename>\n"
+               "       %s --serve <port> [--threads N] [--cache FILE] <filename>\n"
+               "Error code: 1 => FileName not provided \n", argv[0], argv[0], argv[0], argv[0], argv[0], argv[0], argv[0], argv[0], argv[0], argv[0]);
+        return 1;
+    }
+
+     // Generate the output file name dynamically
+    char outFileName[4096 - sizeof(".journal") + 1]; // the journal names beside it take 4096 bytes
+    if ((size_t)snprintf(outFileName, sizeof(outFileName), "out-%s", fileName) >= sizeof(outFileName))
+    {
+        printf("Error: the file name %s is too long\n", fileName);
+        return 1;
+    }
+
+    // a resumed game continues from the last save instead of the puzzle
+    const char *loadName = resumeMode ? outFileName : fileName;
+
+    LatinBoard latinSquare;
+
+    //call function to read latin square date from file 
+    int n = readLatinSquare(loadName, &latinSquare);
+
+    //if -1 is returned, print message saying something went wrong while reading the file
+    if (n == -1)
+    {
+        printf("Error: Something went wrong while reading the file %s\n", loadName);
+        return 0;
+    }
+
+    if (servePort != 0)
+    {
+        int status = runServer(&latinSquare, fileName, servePort, threads, cachePath);
+        boardFree(&latinSquare);
+        return status;
+    }
+
+    if (cnfOut != NULL || modelIn != NULL)
+    {
+        int status = cnfOut != NULL ? runExportCnf(&latinSquare, cnfOut)
+                                    : runImportModel(&latinSquare, modelIn, outFileName);
+        boardFree(&latinSquare);
+        return status;
+    }
+
+    if (stressMode)
+    {
+        int status = runStress(&latinSquare, limit != 0 ? limit : STRESS_DEFAULT_COMMANDS, threads, seed);
+        boardFree(&latinSquare);
+        return status;
+    }
+
+    if (validateMode)
+    {
+        int status = runValidate(&latinSquare, loadName);
+        boardFree(&latinSquare);
+        return status;
+    }
+
+    if (countMode)
+    {
+        int status = runCountSolutions(&latinSquare, limit, threads);
+        boardFree(&latinSquare);
+        return status;
+    }
+
+    if (solveMode)
+    {
+        int status = runSolve(&latinSquare, threads);
+        boardFree(&latinSquare);
+        return status;
+    }
+
+    // the undo/redo journal is allocated once for the whole game
+    MoveJournal journal;
+    MoveJournal *journalPtr = (journalInit(&journal, JOURNAL_CAPACITY) == 0) ? &journal : NULL;
+    if (resumeMode && journalPtr != NULL)
+    {
+        char journalName[4096];
+        snprintf(journalName, sizeof(journalName), "%s.journal", outFileName);
+        if (journalLoad(journalPtr, &latinSquare, journalName) != 0)
+        {
+            printf("Note: no usable journal %s, undo history starts empty\n", journalName);
+        }
+    }
+
+    if (scriptMode)
+    {
+        int status = runScript(&latinSquare, journalPtr, outFileName);
+        journalFree(&journal);
+        boardFree(&latinSquare);
+        if (statsMode)
+        {
+            statsReport();
+        }
+        return status;
+    }
+
+    // start the gameplay loop
+    int incremental = !plainMode && isatty(STDIN_FILENO) && isatty(STDOUT_FILENO) &&
+                      getenv("TERM") != NULL && strcmp(getenv("TERM"), "dumb") != 0;
+    Autosave autosave;
+    Autosave *autosavePtr = NULL;
+    if (autosaveMode)
+    {
+        if (autosaveStart(&autosave, &latinSquare, journalPtr, outFileName) == 0)
+        {
+            autosavePtr = &autosave;
+        }
+        else
+        {
+            printf("Note: autosave could not be started, save with 0,0=0\n");
+        }
+    }
+    play(&latinSquare, journalPtr, autosavePtr, 1, incremental, outFileName);
+    if (autosavePtr != NULL && autosaveStop(autosavePtr) != 0)
+    {
+        printf("Note: some autosaves of %s failed\n", outFileName);
+    }
+
+    journalFree(&journal);
+    boardFree(&latinSquare);
+    if (statsMode)
+    {
+        statsReport();
+    }
 
     //successdfull execution code
     return 0;
 }
+#endif // LATINSQUARE_FUZZ